@@ -0,0 +1,92 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BYTECOMPARE_H_
+#define BYTECOMPARE_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Unsigned lexicographic comparison of byte strings. Comparisons are
+ * vectorized with AVX2 or SSE2, selected at runtime by the capabilities
+ * of the processor, and fall back to comparing eight bytes at a time.
+ */
+class ByteCompare
+{
+public:
+
+    /**
+     Compares two byte strings as unsigned bytes; a string that is a
+     prefix of the other sorts first.
+     @return negative, zero or positive if b1 sorts before, with or
+     after b2.
+     **/
+    static inline int
+    compare (const char *b1, size_t l1, const char *b2, size_t l2)
+    {
+        size_t len = l1 < l2 ? l1 : l2;
+        size_t index = mismatch (b1, b2, len);
+        if (index < len)
+            return (int) (uint8_t) b1[index] - (int) (uint8_t) b2[index];
+        return l1 < l2 ? -1 : (l1 > l2 ? 1 : 0);
+    }
+
+    static inline bool
+    equals (const char *b1, size_t l1, const char *b2, size_t l2)
+    {
+        return l1 == l2 && mismatch (b1, b2, l1) == l1;
+    }
+
+    /**
+     Locates the first byte at which two strings differ.
+     @param len number of bytes to compare
+     @return index of the first differing byte, or len if none differ.
+     **/
+    static inline size_t
+    mismatch (const char *b1, const char *b2, size_t len)
+    {
+        return __atomic_load_n (&mismatchImpl, __ATOMIC_RELAXED) (b1, b2, len);
+    }
+
+    /**
+     Returns the name of the implementation selected for this processor.
+     **/
+    static std::string
+    getImplementation ();
+
+    typedef size_t (*MismatchFunction) (const char*, const char*, size_t);
+
+protected:
+
+    /**
+     Selects the implementation on first use, so that comparisons made
+     during static initialization are safe.
+     **/
+    static size_t
+    resolve (const char *b1, const char *b2, size_t len);
+
+    static MismatchFunction mismatchImpl;
+};
+
+}
+}
+
+#endif /* BYTECOMPARE_H_ */
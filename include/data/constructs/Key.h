@@ -15,6 +15,9 @@
 #define KEY 1
 
 #include "../streaming/Streams.h"
+#include "ByteCompare.h"
+#include "../streaming/input/BufferedReader.h"
+#include "ScanArena.h"
 
 #include <stdint.h>
 #include <ostream>
@@ -41,36 +44,66 @@ public:
     /**
      * Constructor that deep copies another key. Does not subsume ownership.
      **/
-    explicit Key (std::shared_ptr<Key> other) : Key()
+    explicit Key (std::shared_ptr<Key> other) : Key (*other)
     {
-        std::pair<char*, size_t> row = other->getRow ();
-
-        setRow (row.first, row.second);
-
-        std::pair<char*, size_t> cf = other->getColFamily ();
-
-        setColFamily (cf.first, cf.second);
-
-        std::pair<char*, size_t> cq = other->getColQualifier ();
+    }
 
-        setColQualifier (cq.first, cq.second);
+    /**
+     * Copy constructor. The fields of a key are held contiguously, so they
+     * are copied at once.
+     **/
+    Key (const Key &other);
 
-        std::pair<char*, size_t> cv = other->getColVisibility ();
+    /**
+     * Move constructor, which takes the fields of another key without
+     * copying them unless they are held inline.
+     **/
+    Key (Key &&other);
 
-        setColVisibility (cv.first, cv.second);
+    Key &
+    operator= (const Key &other);
 
-        setTimeStamp (other->getTimeStamp ());
+    Key &
+    operator= (Key &&other);
 
-        setDeleted (other->isDeleted ());
-    }
+    /**
+     * Constructor that refers to fields held elsewhere, such as in a
+     * ScanArena, without copying them. The fields must outlive the key;
+     * they are copied into the key's own storage should it be modified.
+     **/
+    Key (const char *row, uint32_t rowLen, const char *cf, uint32_t cfLen,
+         const char *cq, uint32_t cqLen, const char *cv, uint32_t cvLen,
+         uint64_t timestamp, bool deleted, FieldView);
 
     virtual
     ~Key ();
 
+    /**
+     * Sets every field of the key at once, resizing its storage no more
+     * than once.
+     **/
+    void
+    setFields (const char *r, uint32_t rowLen, const char *cf, uint32_t cfLen,
+               const char *cq, uint32_t cqLen, const char *cv, uint32_t cvLen);
+
+    /**
+     * Takes ownership of a buffer holding every field of the key, packed
+     * contiguously from row to visibility, rather than copying them.
+     * @param buffer buffer allocated with new[]
+     * @param capacity size of the buffer
+     * @param rowLen length of the row
+     * @param cfLen length of the column family
+     * @param cqLen length of the column qualifier
+     * @param cvLen length of the column visibility
+     **/
+    void
+    adoptFields (char *buffer, uint32_t capacity, uint32_t rowLen,
+                 uint32_t cfLen, uint32_t cqLen, uint32_t cvLen);
+
     void
     setRow (const char *r, uint32_t size);
 
-    void setRow(std::string row )
+    void setRow(const std::string &row )
     {
         setRow(row.c_str(),row.length());
     }
@@ -92,7 +125,7 @@ public:
     setColFamily (const char *r, uint32_t size);
 
     void
-    setColFamily (std::string st)
+    setColFamily (const std::string &st)
     {
         setColFamily (st.c_str (), st.size ());
     }
@@ -113,7 +146,7 @@ public:
     setColQualifier (const char *r, uint32_t size, uint32_t offset = 0);
 
     void
-    setColQualifier (std::string st)
+    setColQualifier (const std::string &st)
     {
         setColQualifier (st.c_str (), st.size (), 0);
     }
@@ -134,7 +167,7 @@ public:
     setColVisibility (const char *r, uint32_t size);
 
     void
-    setColVisibility (std::string st)
+    setColVisibility (const std::string &st)
     {
         setColVisibility (st.c_str (), st.size ());
     }
@@ -249,13 +282,78 @@ public:
 
     uint64_t
     read (cclient::data::streams::InputStream *in);
+
+    /**
+     * Reads the key from a decompressed block.
+     */
+    uint64_t
+    read (cclient::data::streams::BufferedReader *in);
+
+    /**
+     * Compares this key against another following Accumulo's ordering: row,
+     * column family, column qualifier, column visibility, descending
+     * timestamp, then deletes first.
+     * @param rhs key to compare against
+     * @returns negative, zero or positive if this key sorts before, with,
+     * or after rhs
+     */
+    int
+    compare (const Key &rhs) const;
+
+    /**
+     * Compares this key against a key in its serialized form, following
+     * Accumulo's ordering: row, column family, column qualifier, column
+     * visibility, descending timestamp, then deletes first. The serialized
+     * key is not materialized, therefore no allocations are made.
+     * @param serialized beginning of the serialized key
+     * @param len maximum number of bytes that may be consumed
+     * @returns negative, zero or positive if this key sorts before,
+     * with, or after the serialized key
+     */
+    int
+    compareSerialized (const uint8_t *serialized, size_t len) const;
+
 protected:
 
+    template<typename Reader>
+    void
+    readFields (Reader *in);
+
+    /**
+     * Ensures the key owns storage for fields of a given total size. The
+     * contents of the fields are not preserved.
+     */
+    void
+    reserveFields (uint32_t size);
+
+    /**
+     * Replaces a field, shifting the fields that follow it.
+     * @param index index of the field, from row to visibility
+     * @param data bytes to place after the preserved bytes
+     * @param size number of bytes
+     * @param keep number of bytes of the field that are preserved
+     */
+    void
+    setField (uint32_t index, const char *data, uint32_t size, uint32_t keep);
+
+    /**
+     * Points each field at its place within the key's storage.
+     */
+    void
+    layoutFields ();
+
+    /**
+     * Releases heap storage, returning to the inline buffer.
+     */
+    void
+    releaseFields ();
+
+    static const uint32_t INLINE_FIELD_SIZE = 64;
+
     /**
      * Row part of key
      */
     char *row;
-    uint32_t rowMaxSize;
     uint32_t rowLength;
 
     /**
@@ -263,18 +361,27 @@ protected:
      */
     uint32_t columnFamilyLength;
     char *colFamily;
-    uint32_t columnFamilySize;
 
     /**
      * Column qualifier.
      */
     char *colQualifier;
-    uint32_t colQualSize;
     uint32_t colQualLen;
     char *keyVisibility;
     uint32_t colVisSize;
     uint64_t timestamp;
     bool deleted;
+    // the fields are held elsewhere and are not freed by the key
+    bool viewing;
+
+    /**
+     * Storage of fields owned by the key, which are packed contiguously
+     * from row to visibility. Storage is the inline buffer unless the
+     * fields exceed it.
+     */
+    char *fields;
+    uint32_t fieldCapacity;
+    char inlineFields[INLINE_FIELD_SIZE];
 
     /**
      * copied from writable comparable utils
@@ -283,18 +390,7 @@ protected:
     compareBytes (const char *b1, int s1, int l1, const char *b2, int s2,
                   int l2)
     {
-        int end1 = s1 + l1;
-        int end2 = s2 + l2;
-        for (int i = s1, j = s2; i < end1 && j < end2; i++, j++)
-        {
-            int a = (b1[i] & 0xff);
-            int b = (b2[j] & 0xff);
-            if (a != b)
-            {
-                return a - b;
-            }
-        }
-        return l1 - l2;
+        return ByteCompare::compare (b1 + s1, l1, b2 + s2, l2);
     }
 };
 
@@ -40,6 +40,15 @@ public:
 	 **/
 	KeyValue();
 	
+	/**
+	 * Key value constructor that refers to a key and value rather than
+	 * copying the value.
+	 **/
+	KeyValue(std::shared_ptr<Key> k, std::shared_ptr<Value> v) :
+		key(k), value(v)
+	{
+	}
+
 	/**
 	 * Key value constructor.
 	 **/
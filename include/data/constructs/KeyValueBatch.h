@@ -0,0 +1,253 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KEYVALUEBATCH_H_
+#define KEYVALUEBATCH_H_
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "Key.h"
+#include "value.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Column of variable length byte strings, stored contiguously.
+ * Entry i spans offsets[i] to offsets[i + 1].
+ */
+class BatchColumn
+{
+public:
+    BatchColumn () :
+        offsets (1, 0)
+    {
+
+    }
+
+    void
+    append (const char *data, size_t len)
+    {
+        bytes.insert (bytes.end (), data, data + len);
+        offsets.push_back (bytes.size ());
+    }
+
+    void
+    append (const std::pair<char*, size_t> &field)
+    {
+        append (field.first, field.second);
+    }
+
+    /**
+     Returns the bytes of an entry, which remain valid until the
+     column is cleared or appended to.
+     **/
+    std::pair<const char*, size_t>
+    get (size_t index) const
+    {
+        return std::make_pair (bytes.data () + offsets.at (index),
+                               offsets.at (index + 1) - offsets.at (index));
+    }
+
+    std::string
+    getString (size_t index) const
+    {
+        std::pair<const char*, size_t> field = get (index);
+        return std::string (field.first, field.second);
+    }
+
+    const std::vector<char> &
+    getBytes () const
+    {
+        return bytes;
+    }
+
+    const std::vector<uint32_t> &
+    getOffsets () const
+    {
+        return offsets;
+    }
+
+    /**
+     Removes every entry, retaining the allocated storage.
+     **/
+    void
+    clear ()
+    {
+        bytes.clear ();
+        offsets.resize (1);
+    }
+
+protected:
+    std::vector<char> bytes;
+    std::vector<uint32_t> offsets;
+};
+
+/**
+ * Columnar batch of key value pairs. Each field of the key, and the
+ * value, is kept in its own column so that consumers interested in a
+ * few fields may iterate over them directly. A batch is meant to be
+ * reused; clearing it retains its storage.
+ */
+class KeyValueBatch
+{
+public:
+    KeyValueBatch ()
+    {
+
+    }
+
+    /**
+     Appends an entry, copying the fields of the key and the value.
+     @param key key of the entry
+     @param value value of the entry, may be null.
+     **/
+    void
+    append (Key *key, Value *value)
+    {
+        append (key->getRow (), key->getColFamily (), key->getColQualifier (),
+                key->getColVisibility (), key->getTimeStamp (), key->isDeleted (),
+                value);
+    }
+
+    /**
+     Appends an entry from the fields of a key, copying them.
+     **/
+    void
+    append (const std::pair<char*, size_t> &row,
+            const std::pair<char*, size_t> &columnFamily,
+            const std::pair<char*, size_t> &columnQualifier,
+            const std::pair<char*, size_t> &columnVisibility, int64_t timestamp,
+            bool isDeleted, Value *value)
+    {
+        rows.append (row);
+        columnFamilies.append (columnFamily);
+        columnQualifiers.append (columnQualifier);
+        columnVisibilities.append (columnVisibility);
+        timestamps.push_back (timestamp);
+        deleted.push_back (isDeleted ? 1 : 0);
+        if (NULL != value)
+            values.append ((const char*) value->data (), value->size ());
+        else
+            values.append (NULL, 0);
+    }
+
+    size_t
+    size () const
+    {
+        return timestamps.size ();
+    }
+
+    bool
+    empty () const
+    {
+        return timestamps.empty ();
+    }
+
+    void
+    clear ()
+    {
+        rows.clear ();
+        columnFamilies.clear ();
+        columnQualifiers.clear ();
+        columnVisibilities.clear ();
+        values.clear ();
+        timestamps.clear ();
+        deleted.clear ();
+    }
+
+    const BatchColumn &
+    getRows () const
+    {
+        return rows;
+    }
+
+    const BatchColumn &
+    getColumnFamilies () const
+    {
+        return columnFamilies;
+    }
+
+    const BatchColumn &
+    getColumnQualifiers () const
+    {
+        return columnQualifiers;
+    }
+
+    const BatchColumn &
+    getColumnVisibilities () const
+    {
+        return columnVisibilities;
+    }
+
+    const BatchColumn &
+    getValues () const
+    {
+        return values;
+    }
+
+    const std::vector<int64_t> &
+    getTimestamps () const
+    {
+        return timestamps;
+    }
+
+    /**
+     Returns the delete flags, one byte per entry.
+     **/
+    const std::vector<uint8_t> &
+    getDeleted () const
+    {
+        return deleted;
+    }
+
+    /**
+     Creates a key from an entry of the batch.
+     @param index entry index
+     @return newly allocated key.
+     **/
+    std::shared_ptr<Key>
+    getKey (size_t index) const
+    {
+        std::shared_ptr<Key> key = std::make_shared<Key> ();
+        std::pair<const char*, size_t> row = rows.get (index);
+        std::pair<const char*, size_t> cf = columnFamilies.get (index);
+        std::pair<const char*, size_t> cq = columnQualifiers.get (index);
+        std::pair<const char*, size_t> cv = columnVisibilities.get (index);
+        key->setFields (row.first, row.second, cf.first, cf.second, cq.first,
+                        cq.second, cv.first, cv.second);
+        key->setTimeStamp (timestamps.at (index));
+        key->setDeleted (deleted.at (index) != 0);
+        return key;
+    }
+
+protected:
+    BatchColumn rows;
+    BatchColumn columnFamilies;
+    BatchColumn columnQualifiers;
+    BatchColumn columnVisibilities;
+    BatchColumn values;
+    std::vector<int64_t> timestamps;
+    std::vector<uint8_t> deleted;
+};
+
+}
+}
+
+#endif /* KEYVALUEBATCH_H_ */
@@ -19,24 +19,54 @@
 #include <sys/types.h>
 #include <stdint.h>
 #include <vector>
+#include <string>
+#include <mutex>
 #include <stdio.h>
 #include <string.h>
 
-#include "../streaming/ByteOutputStream.h"
-#include "../streaming/EndianTranslation.h"
-#include "../streaming/DataOutputStream.h"
-
-# define BSWAP_32(x)  ((((x) & 0x000000ff) << 24) |      \
-                      (((x) & 0x0000ff00) << 8)  |      \
-                      (((x) & 0x00ff0000) >> 8)  |      \
-                      (((x) & 0xff000000) >> 24))
-#define	BSWAP_64(x)     (((uint64_t)(x) << 56) | (((uint64_t)(x) << 40) & 0xff000000000000ULL) | (((uint64_t)(x) << 24) & 0xff0000000000ULL) | (((uint64_t)(x) << 8)  & 0xff00000000ULL) | (((uint64_t)(x) >> 8)  & 0xff000000ULL) | (((uint64_t)(x) >> 24) & 0xff0000ULL) | (((uint64_t)(x) >> 40) & 0xff00ULL) | ((uint64_t)(x)  >> 56))
+#include "../streaming/VLongEncoder.h"
 
 namespace cclient {
 
 namespace data {
 
 
+/**
+ * Recycles the buffers of mutations so that writing many small mutations
+ * does not allocate a buffer for each. Buffers are kept in power of two
+ * size classes. The pool is thread safe and must outlive the mutations
+ * that use it.
+ **/
+class MutationBufferPool {
+public:
+    /**
+     * Constructor
+     * @param maxBuffers number of buffers kept in each size class
+     **/
+    explicit MutationBufferPool(size_t maxBuffers = 1024) :
+            maxBuffers(maxBuffers) {
+    }
+
+    /**
+     * Returns a buffer of at least size bytes.
+     **/
+    std::string acquire(size_t size);
+
+    /**
+     * Returns a buffer to the pool, which keeps it if its size class is
+     * not full.
+     **/
+    void release(std::string &&buffer);
+
+protected:
+    static const uint8_t MIN_CLASS = 8;
+    static const uint8_t SIZE_CLASSES = 10;
+
+    std::mutex poolLock;
+    std::vector<std::string> buffers[SIZE_CLASSES];
+    size_t maxBuffers;
+};
+
 /**
  * Key/Value Mutation
  **/
@@ -45,16 +75,35 @@ public:
     /**
      * Constructor
      * @param row row for the mutation
+     * @param pool pool supplying the mutation's buffer, if any
      **/
-    explicit Mutation(std::string row);
+    explicit Mutation(std::string row, MutationBufferPool *pool = NULL);
 
-    void put(std::string cf, std::string cq, std::string cv, int64_t ts,bool deleted);
+    void put(const std::string &cf, const std::string &cq, const std::string &cv, int64_t ts,bool deleted);
     
-    void put(std::string cf, std::string cq, std::string cv, int64_t ts,bool deleted, uint8_t *value,
+    void put(const std::string &cf, const std::string &cq, const std::string &cv, int64_t ts,bool deleted, uint8_t *value,
              uint64_t value_len);
-    void put(std::string cf, std::string cq = "", std::string cv = "", unsigned long ts = 0);
+    void put(const std::string &cf, const std::string &cq = "", const std::string &cv = "", unsigned long ts = 0);
+
+    /**
+     * Adds an update from fields that are written directly into the
+     * mutation, without first being copied into strings.
+     * @param cf column family
+     * @param cfLen length of the column family
+     * @param cq column qualifier
+     * @param cqLen length of the column qualifier
+     * @param cv column visibility
+     * @param cvLen length of the column visibility
+     * @param ts timestamp
+     * @param deleted whether the update is a delete
+     * @param value value, which may be null if value_len is zero
+     * @param value_len length of the value
+     **/
+    void put(const char *cf, size_t cfLen, const char *cq, size_t cqLen, const char *cv, size_t cvLen,
+             int64_t ts, bool deleted, const uint8_t *value = NULL, uint64_t value_len = 0);
+
     virtual ~Mutation();
-    std::string getRow() {
+    const std::string &getRow() const {
         return mut_row;
     }
 
@@ -63,60 +112,48 @@ public:
     }
 
     std::pair<uint8_t*, size_t> getData() {
-        return std::make_pair((uint8_t*)outStream->getByteArray(), outStream->getPos());
+        return std::make_pair((uint8_t*) &data[0], length);
     }
 
     std::string getDataStr() {
-        return std::string(outStream->getByteArray(), outStream->getPos());
-    }
-protected:
-
-    void write(const uint8_t *b, uint32_t length) {
-        reserve(length);
-        memcpy(&data.at(ptr), b, length);
-        ptr += length;
+        return std::string(data.data(), length);
     }
 
-    void write(bool b) {
-        reserve(1);
-        if (b == true)
-            data.at(ptr) = 1;
-        else
-            data.at(ptr) = 0;
-        ptr++;
-    }
-
-    void writeLong(int64_t l) {
-        reserve(8);
+    /**
+     * Moves the serialized updates out of the mutation, such as into a
+     * TMutation, rather than copying them. The mutation has no data until
+     * the buffer is restored.
+     **/
+    std::string releaseData();
 
-        int64_t v = BSWAP_64(l);
-        write((uint8_t*) &v, sizeof(int64_t));
-    }
+    /**
+     * Returns a buffer previously taken by releaseData.
+     **/
+    void restoreData(std::string &&buffer);
 
-    void writeInt(int32_t i) {
-        reserve(4);
-        int32_t v = BSWAP_32(i);
-        write((uint8_t*) &v, sizeof(int32_t));
-    }
+protected:
 
-    void reserve(uint32_t reserveSize) {
-        data.resize(data.size() + reserveSize);
+    /**
+     * Ensures that size bytes may be written after the serialized
+     * updates.
+     **/
+    void reserve(size_t size) {
+        if (length + size > data.size())
+            grow(size);
     }
 
-    cclient::data::streams::ByteOutputStream *outStream;
-    cclient::data::streams::EndianTranslationStream *endianStream;
-    cclient::data::streams::DataOutputStream *baseStream;
+    void grow(size_t size);
 
     std::string mut_row;
 
-    uint32_t ptr;
-    std::vector<uint8_t> data;
+    // the buffer's size is its capacity; length bytes are in use
+    std::string data;
+    size_t length;
 
     int32_t entries;
-    std::vector<uint8_t> values;
+    MutationBufferPool *pool;
 
 };
 }
 }
 #endif /* MUTATION_H_ */
-
@@ -0,0 +1,160 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCANARENA_H_
+#define SCANARENA_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include <memory>
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Tag selecting the constructors of Key and Value that refer to fields
+ * held elsewhere, such as in a ScanArena, rather than copying them.
+ */
+struct FieldView
+{
+};
+
+/**
+ * Bump allocator holding the objects and field bytes of a batch of scan
+ * results. Memory is carved from large chunks and is never freed
+ * individually; every chunk is released with the arena.
+ *
+ * The arena is not thread safe while it is being filled.
+ */
+class ScanArena
+{
+public:
+
+    /**
+     Constructor
+     @param chunkSize size of the first chunk. Later chunks double in
+     size, up to a megabyte, unless a larger allocation requires more.
+     **/
+    explicit ScanArena (size_t chunkSize = 64 * 1024);
+
+    ~ScanArena ();
+
+    /**
+     Allocates memory within the arena.
+     @param size number of bytes
+     @param alignment alignment of the memory, a power of two
+     @return memory that remains valid until the arena is destroyed.
+     **/
+    void *
+    allocate (size_t size, size_t alignment = alignof (std::max_align_t));
+
+    /**
+     Copies bytes into the arena.
+     @param data bytes to copy
+     @param len number of bytes
+     @return the copy, which is never null.
+     **/
+    char *
+    copy (const char *data, size_t len);
+
+    /**
+     Returns the number of bytes reserved by the arena's chunks.
+     **/
+    size_t
+    getCapacity () const
+    {
+        return capacity;
+    }
+
+protected:
+
+    std::vector<char*> chunks;
+    char *position;
+    size_t remaining;
+    size_t nextChunkSize;
+    size_t capacity;
+};
+
+/**
+ * Allocator placing objects within a ScanArena, for use with
+ * std::allocate_shared. Every copy of the allocator holds the arena,
+ * so the arena is released once the last object allocated from it is
+ * destroyed.
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator (std::shared_ptr<ScanArena> arena) :
+        arena (arena)
+    {
+    }
+
+    template<typename U>
+    ArenaAllocator (const ArenaAllocator<U> &other) :
+        arena (other.getArena ())
+    {
+    }
+
+    T *
+    allocate (size_t n)
+    {
+        return static_cast<T*> (arena->allocate (n * sizeof (T), alignof (T)));
+    }
+
+    void
+    deallocate (T *p, size_t n)
+    {
+        // released with the arena
+    }
+
+    const std::shared_ptr<ScanArena> &
+    getArena () const
+    {
+        return arena;
+    }
+
+    template<typename U>
+    struct rebind
+    {
+        typedef ArenaAllocator<U> other;
+    };
+
+protected:
+    std::shared_ptr<ScanArena> arena;
+};
+
+template<typename T, typename U>
+inline bool
+operator == (const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs)
+{
+    return lhs.getArena () == rhs.getArena ();
+}
+
+template<typename T, typename U>
+inline bool
+operator != (const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs)
+{
+    return !(lhs == rhs);
+}
+
+}
+}
+
+#endif /* SCANARENA_H_ */
@@ -16,9 +16,11 @@
 
 #include "Key.h"
 #include "rkey.h"
+#include "ByteCompare.h"
 #include <stdint.h>
 
 #include "../streaming/Streams.h"
+#include "../streaming/input/BufferedReader.h"
 
 #include <stdint.h>
 #include <cstdio>
@@ -42,8 +44,9 @@ protected:
     int skipped;
 
     void
-    fastSkip (cclient::data::streams::InputStream *stream, std::shared_ptr<Key>  seekKey, std::vector<char> *valCopy,
-              std::shared_ptr<Key>  prevKey, std::shared_ptr<Key>  currKey)
+    fastSkip (cclient::data::streams::BufferedReader *stream, std::shared_ptr<Key>  seekKey,
+              std::pair<const char*, uint32_t> *value, std::shared_ptr<Key>  prevKey,
+              std::shared_ptr<Key>  currKey)
     {
 
         std::vector<char> row, cf, cq, cv;
@@ -92,26 +95,27 @@ protected:
             prevTimestamp = currKey->getTimeStamp ();
 
             std::pair<char*, size_t> scratch = currKey->getRow ();
-            row.insert (prevRow.end (), scratch.first,
+            row.insert (row.end (), scratch.first,
                         scratch.first + scratch.second);
 
             scratch = currKey->getColFamily ();
-            cf.insert (prevCf.end (), scratch.first,
+            cf.insert (cf.end (), scratch.first,
                        scratch.first + scratch.second);
 
             scratch = currKey->getColQualifier ();
-            cq.insert (prevCq.end (), scratch.first,
+            cq.insert (cq.end (), scratch.first,
                        scratch.first + scratch.second);
 
             scratch = currKey->getColVisibility ();
-            cv.insert (prevVis.end (), scratch.first,
+            cv.insert (cv.end (), scratch.first,
                        scratch.first + scratch.second);
 
             timestamp = currKey->getTimeStamp ();
 
-            if (row >= stopRow)
+            int rowCompare = compareField (row, stopRow);
+            if (rowCompare >= 0)
             {
-                if (row > stopRow)
+                if (rowCompare > 0)
                 {
                     rkey = new RelativeKey (std::make_shared<Key> (currKey),
                                             std::make_shared<Key> (currKey));
@@ -121,9 +125,10 @@ protected:
                     return;
                 }
 
-                if (cf >= stopCf)
+                int cfCompare = compareField (cf, stopCf);
+                if (cfCompare >= 0)
                 {
-                    if (cf > stopCf)
+                    if (cfCompare > 0)
                     {
                         rkey = new RelativeKey (std::make_shared<Key> (currKey),
                                                 std::make_shared<Key> (currKey));
@@ -133,7 +138,7 @@ protected:
                         return;
                     }
 
-                    if (cq > stopCq)
+                    if (compareField (cq, stopCq) > 0)
                     {
                         rkey = new RelativeKey (std::make_shared<Key> (currKey),
                                                 std::make_shared<Key> (currKey));
@@ -160,36 +165,36 @@ protected:
 
                 fieldsSame = stream->readByte ();
 
+                char fieldsPrefixed = 0;
                 if ((fieldsSame & RelativeKey::PREFIX_COMPRESSION_ENABLED)
                         == RelativeKey::PREFIX_COMPRESSION_ENABLED)
                 {
-                    stream->readByte ();
+                    fieldsPrefixed = stream->readByte ();
 
                 }
-                		
 
                 bool changed = false;
 
                 changed = readPrefix (stream, &rowCmp, RelativeKey::ROW_SAME,
-                                      RelativeKey::ROW_PREFIX, fieldsSame, &row,
+                                      RelativeKey::ROW_PREFIX, fieldsSame, fieldsPrefixed, &row,
                                       &prevRow, &stopRow);
 
                 if (readPrefix (stream, &cfCmp, RelativeKey::CF_SAME,
-                                RelativeKey::CF_PREFIX, fieldsSame, &cf,
+                                RelativeKey::CF_PREFIX, fieldsSame, fieldsPrefixed, &cf,
                                 &prevCf, &stopCf))
                 {
                     changed = true;
                 }
 
                 if (readPrefix (stream, &cqCmp, RelativeKey::CQ_SAME,
-                                RelativeKey::CQ_PREFIX, fieldsSame, &cq,
+                                RelativeKey::CQ_PREFIX, fieldsSame, fieldsPrefixed, &cq,
                                 &prevCq, &stopCq))
                 {
                     changed = true;
                 }
 
                 if (readPrefix (stream, &cvCmp, RelativeKey::CV_SAME,
-                                RelativeKey::CV_PREFIX, fieldsSame, &cv,
+                                RelativeKey::CV_PREFIX, fieldsSame, fieldsPrefixed, &cv,
                                 &prevVis, &stopCv))
                 {
                     changed = true;
@@ -200,14 +205,14 @@ protected:
                     prevTimestamp = timestamp;
 
                     timestamp = stream->readEncodedLong();
-                    if ((fieldsSame & RelativeKey::TS_DIFF)
-                            != RelativeKey::TS_DIFF)
+                    if ((fieldsPrefixed & RelativeKey::TS_DIFF)
+                            == RelativeKey::TS_DIFF)
                     {
                         timestamp += prevTimestamp;
                     }
                 }
 
-                readValue (stream, valCopy);
+                readValue (stream, value);
 
                 count++;
 
@@ -286,77 +291,79 @@ protected:
     }
 
     bool
-    readPrefix (cclient::data::streams::InputStream *stream, int *comparison, uint8_t SAME_FIELD,
-                uint8_t PREFIX, char fieldsSame, std::vector<char> *field,
+    readPrefix (cclient::data::streams::BufferedReader *stream, int *comparison,
+                uint8_t SAME_FIELD, uint8_t PREFIX, char fieldsSame,
+                char fieldsPrefixed, std::vector<char> *field,
                 std::vector<char> *prevField, std::vector<char> *stopField)
     {
-        std::vector<char> tmp;
-
+        // prevField becomes the field of the previous key
         field->swap (*prevField);
 
-
-        if ((fieldsSame & SAME_FIELD) != SAME_FIELD)
+        if ((fieldsSame & SAME_FIELD) == SAME_FIELD)
         {
-            if ((fieldsSame & PREFIX) == PREFIX)
-            {
-                readPrefix (stream, field, prevField);
-            }
-            else
-                read (stream, field);
+            field->assign (prevField->begin (), prevField->end ());
+            return false;
+        }
 
-            if (*field >= *stopField)
-            {
-                if (*field > *stopField)
-                {
-                    *comparison = 1;
-                }
-                else
-                    *comparison = 1;
-            }
-            else
-            {
-                *comparison = -1;
-            }
-            return true;
+        if ((fieldsPrefixed & PREFIX) == PREFIX)
+        {
+            readPrefix (stream, field, prevField);
         }
-        return false;
+        else
+            read (stream, field);
+
+        *comparison = compareField (*field, *stopField) >= 0 ? 1 : -1;
+        return true;
     }
 
     void
-    readPrefix (cclient::data::streams::InputStream *stream, std::vector<char> *row, std::vector<char> *prevRow)
+    readPrefix (cclient::data::streams::BufferedReader *stream, std::vector<char> *row,
+                std::vector<char> *prevRow)
     {
-        uint32_t prefixLen = stream->readHadoopLong ();
-        uint32_t remainingLen = stream->readHadoopLong ();
-        row->insert (row->begin (), prevRow->data (),
-                     prevRow->data () + prefixLen);
-        char *array = new char[remainingLen];
-        stream->readBytes (array, remainingLen);
-        row->insert (row->end (), array, array + remainingLen);
-        delete[] array;
+        uint32_t prefixLen = stream->readEncodedLong ();
+        uint32_t remainingLen = stream->readEncodedLong ();
+        if (prefixLen > prevRow->size ())
+            throw std::runtime_error ("Prefix exceeds the previous key");
+        row->assign (prevRow->begin (), prevRow->begin () + prefixLen);
+        const char *remaining = stream->read (remainingLen);
+        row->insert (row->end (), remaining, remaining + remainingLen);
     }
 
+    /**
+     Compares fields as unsigned bytes.
+     **/
+    static int
+    compareField (const std::vector<char> &field, const std::vector<char> &other)
+    {
+        return ByteCompare::compare (field.data (), field.size (), other.data (),
+                                     other.size ());
+    }
+
+    /**
+     * Records where a value lies within the block rather than copying
+     * it, as only the value of the final entry is kept.
+     */
     void
-    readValue (cclient::data::streams::InputStream *stream, std::vector<char> *val)
+    readValue (cclient::data::streams::BufferedReader *stream,
+               std::pair<const char*, uint32_t> *value)
     {
-        uint32_t len = stream->readInt ();
-        read (stream, val, len);
+        value->second = stream->readInt ();
+        value->first = stream->read (value->second);
     }
 
     void
-    read (cclient::data::streams::InputStream *stream, std::vector<char> *row)
+    read (cclient::data::streams::BufferedReader *stream, std::vector<char> *row)
     {
-        uint32_t len = stream->readHadoopLong ();
+        uint32_t len = stream->readEncodedLong ();
         read (stream, row, len);
     }
 
     void
-    read (cclient::data::streams::InputStream *stream, std::vector<char> *input, uint32_t len)
+    read (cclient::data::streams::BufferedReader *stream, std::vector<char> *input,
+          uint32_t len)
     {
-        char *array = new char[len];
-        stream->readBytes (array, len);
-
-        input->insert (input->begin (), array, array + len);
-        delete[] array;
+        const char *bytes = stream->read (len);
+        input->assign (bytes, bytes + len);
     }
 
 public:
@@ -366,11 +373,17 @@ public:
 
     }
 
-    SkippedRelativeKey (cclient::data::streams::InputStream *stream, std::shared_ptr<Key>  seekKey,
-                        std::vector<char> *valCopy, std::shared_ptr<Key>  prevKey, std::shared_ptr<Key>  currKey) :
+    /**
+     * Skips to the first entry of a block at or after the seek key.
+     * @param value set to the value of that entry, which lies within
+     * the block being read
+     */
+    SkippedRelativeKey (cclient::data::streams::BufferedReader *stream, std::shared_ptr<Key>  seekKey,
+                        std::pair<const char*, uint32_t> *value, std::shared_ptr<Key>  prevKey,
+                        std::shared_ptr<Key>  currKey) :
         SkippedRelativeKey (NULL, 0, NULL)
     {
-        fastSkip (stream, seekKey, valCopy, prevKey, currKey);
+        fastSkip (stream, seekKey, value, prevKey, currKey);
 
     }
 
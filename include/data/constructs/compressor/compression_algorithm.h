@@ -20,6 +20,10 @@
 #include "algorithm.h"
 #include "compressor.h"
 #include "zlibCompressor.h"
+#include "noneCompressor.h"
+#include "snappyCompressor.h"
+#include "lz4Compressor.h"
+#include "zstdCompressor.h"
 
 namespace cclient
 {
@@ -49,6 +53,13 @@ public:
 
     }
 
+    /**
+     * Creates a compressor for this algorithm. Codecs other than gz
+     * and none are available when sharkbite is built with their
+     * libraries.
+     * @returns new compressor, or NULL if no algorithm is set.
+     * @throws runtime_error if the algorithm is not supported.
+     */
     Compressor *
     create ()
     {
@@ -56,9 +67,38 @@ public:
         {
             return new ZLibCompressor ();
         }
-        else
+        else if (compressionAlgo == "none")
         {
-            std::runtime_error ("Unsupported compression algorithm");
+            return new NoneCompressor ();
+        }
+        else if (compressionAlgo == "snappy")
+        {
+#ifdef HAVE_SNAPPY
+            return new SnappyCompressor ();
+#else
+            throw std::runtime_error ("Snappy compression is not available");
+#endif
+        }
+        else if (compressionAlgo == "lz4")
+        {
+#ifdef HAVE_LZ4
+            return new Lz4Compressor ();
+#else
+            throw std::runtime_error ("LZ4 compression is not available");
+#endif
+        }
+        else if (compressionAlgo == "zstd")
+        {
+#ifdef HAVE_ZSTD
+            return new ZstdCompressor ();
+#else
+            throw std::runtime_error ("Zstandard compression is not available");
+#endif
+        }
+        else if (!compressionAlgo.empty ())
+        {
+            throw std::runtime_error ("Unsupported compression algorithm "
+                                      + compressionAlgo);
         }
         return 0;
     }
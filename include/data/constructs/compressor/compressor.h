@@ -43,14 +43,12 @@ public:
     ~Compressor ()
     {
 
-        if (buffer != NULL)
-            delete[] buffer;
-        buffer=NULL;
     }
 
     virtual Compressor *newInstance() = 0;
     /**
-     Set the input.
+     Set the input. The input is not copied, so it must remain valid
+     until it is compressed or decompressed.
      @param b input buffer.
      @param offset offset within this buffer.
      @param length input length.
@@ -98,6 +96,17 @@ public:
         throw std::runtime_error ("Decompression not supported");
     }
 
+    /**
+     * Decompresses the input into a caller's buffer.
+     * It is intended to be used following setInput
+     * @param out destination
+     * @param capacity size of out
+     * @returns decompressed size.
+     * @throws runtime_error if the data does not fit.
+     */
+    virtual size_t
+    decompress (char *out, size_t capacity);
+
     /**
      Retrieves the buffer size.
      @return buffer size.
@@ -161,8 +170,8 @@ protected:
     uint32_t off;
     // stream offset.
     uint32_t stream_offset;
-    // input buffer.
-    char *buffer;
+    // input buffer, owned by the caller.
+    const char *buffer;
     Algorithm algorithm;
     
     
@@ -0,0 +1,125 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FRAMED_COMPRESSOR_H
+#define FRAMED_COMPRESSOR_H
+
+#include <stdexcept>
+#include <string>
+#include "compressor.h"
+#include "../../streaming/DataOutputStream.h"
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+/**
+ * Base for codecs that hadoop writes with its BlockCompressorStream.
+ * Each block of raw data is preceded by its length, and is split into
+ * compressed chunks that are each preceded by their length. Lengths
+ * are four byte integers in network order.
+ */
+class FramedCompressor: public Compressor {
+public:
+	/**
+	 * @param name algorithm name
+	 * @param bufferSize hadoop's buffer size for the codec
+	 */
+	FramedCompressor(const std::string &name, uint32_t bufferSize) :
+			Compressor(), rawSize(0), total_out(0), bufferSize(bufferSize) {
+		Compressor::algorithm.setAlgorithm(name);
+	}
+
+	virtual ~FramedCompressor() {
+	}
+
+	uint32_t getBufferSize() {
+		return bufferSize;
+	}
+
+	/**
+	 * Returns the number of bytes written
+	 * @returns raw, uncompressed size, of the data
+	 */
+	uint32_t bytesWritten() {
+		return rawSize;
+	}
+
+	/**
+	 * Returns the compressed size of the data, including the framing
+	 * @returns total_out
+	 */
+	uint32_t getCompressedSize() {
+		return total_out;
+	}
+
+	std::string getName() {
+		return Compressor::algorithm.getName();
+	}
+
+	void compress(cclient::data::streams::OutputStream *out_stream);
+
+	void decompress(cclient::data::streams::OutputStream *out_stream);
+
+	size_t decompress(char *out, size_t capacity);
+
+protected:
+
+	/**
+	 * Returns the largest compressed size of a chunk.
+	 * @param length raw length of the chunk
+	 */
+	virtual size_t maxCompressedLength(size_t length) = 0;
+
+	/**
+	 * Compresses a chunk.
+	 * @param in raw chunk
+	 * @param length raw length
+	 * @param out destination, of maxCompressedLength bytes
+	 * @returns compressed length.
+	 */
+	virtual size_t compressChunk(const char *in, size_t length, char *out) = 0;
+
+	/**
+	 * Decompresses a chunk.
+	 * @param in compressed chunk
+	 * @param length compressed length
+	 * @param out destination
+	 * @param capacity size of out
+	 * @returns decompressed length.
+	 * @throws runtime_error if the chunk is corrupt or does not fit.
+	 */
+	virtual size_t decompressChunk(const char *in, size_t length, char *out,
+			size_t capacity) = 0;
+
+	/**
+	 * Decompresses the chunks of one raw block.
+	 * @param in position within the input, advanced past the chunks
+	 * @param end end of the input
+	 * @param out destination
+	 * @param raw raw length of the block
+	 */
+	void decompressBlock(const char *&in, const char *end, char *out,
+			uint32_t raw);
+
+	// raw size of the uncompressed data.
+	uint32_t rawSize;
+	// total output size.
+	uint32_t total_out;
+	// buffer size.
+	uint32_t bufferSize;
+};
+}
+}
+}
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LZ4_COMPRESSOR_H
+#define LZ4_COMPRESSOR_H
+
+#ifdef HAVE_LZ4
+
+#include "framedCompressor.h"
+#define LZ4_NAME "lz4"
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+/**
+ * LZ4, framed as hadoop's Lz4Codec writes it.
+ */
+class Lz4Compressor: public FramedCompressor {
+public:
+	Lz4Compressor() :
+			FramedCompressor(LZ4_NAME, 256 * 1024) {
+	}
+
+	virtual ~Lz4Compressor() {
+	}
+
+	virtual Compressor *newInstance() {
+		return new Lz4Compressor();
+	}
+
+	/**
+	 * Returns the compression overhead, as hadoop defines it
+	 * @returns compression overhead
+	 */
+	uint32_t getCompressionOverHead() {
+		return (bufferSize / 255) + 16;
+	}
+
+protected:
+
+	size_t maxCompressedLength(size_t length);
+
+	size_t compressChunk(const char *in, size_t length, char *out);
+
+	size_t decompressChunk(const char *in, size_t length, char *out,
+			size_t capacity);
+};
+}
+}
+}
+#endif
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef NONE_COMPRESSOR_H
+#define NONE_COMPRESSOR_H
+
+#include <stdexcept>
+#include <cstring>
+#include "compressor.h"
+#include "../../streaming/DataOutputStream.h"
+#define NONE_NAME "none"
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+/**
+ * Stores blocks uncompressed.
+ */
+class NoneCompressor: public Compressor {
+public:
+	NoneCompressor() :
+			Compressor(), rawSize(0), total_out(0) {
+		Compressor::algorithm.setAlgorithm(NONE_NAME);
+	}
+
+	virtual ~NoneCompressor() {
+	}
+
+	virtual Compressor *newInstance() {
+		return new NoneCompressor();
+	}
+
+	uint32_t getBufferSize() {
+		return 64 * 1024;
+	}
+
+	uint32_t getCompressionOverHead() {
+		return 0;
+	}
+
+	uint32_t bytesWritten() {
+		return rawSize;
+	}
+
+	uint32_t getCompressedSize() {
+		return total_out;
+	}
+
+	std::string getName() {
+		return NONE_NAME;
+	}
+
+	void compress(cclient::data::streams::OutputStream *out_stream) {
+		if (len == 0)
+			return;
+		out_stream->write(buffer + off, len);
+		rawSize += len;
+		total_out = len;
+		buffer = NULL;
+		len = 0;
+	}
+
+	void decompress(cclient::data::streams::OutputStream *out_stream) {
+		if (len == 0)
+			return;
+		out_stream->write(buffer + off, len);
+		rawSize += len;
+		total_out += len;
+		buffer = NULL;
+		len = 0;
+	}
+
+	size_t decompress(char *out, size_t capacity) {
+		if (len > capacity)
+			throw std::runtime_error("Decompressed data exceeds its expected size");
+		size_t copied = len;
+		memcpy(out, buffer + off, copied);
+		rawSize += copied;
+		total_out += copied;
+		buffer = NULL;
+		len = 0;
+		return copied;
+	}
+
+protected:
+	// raw size of the data.
+	uint32_t rawSize;
+	// total output size.
+	uint32_t total_out;
+};
+}
+}
+}
+#endif
@@ -16,6 +16,10 @@
 
 #include <exception>
 #include <stdexcept>
+#include <vector>
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
 #include "compressor.h"
 #include "../../streaming/DataOutputStream.h"
 #define GZ_NAME "gz"
@@ -24,10 +28,70 @@ namespace cclient {
 namespace data {
 namespace compression {
 
+/**
+ * zlib streams and scratch space kept by each thread, so that
+ * compressors reset a live stream for each block rather than
+ * initializing a new one.
+ */
+class ZLibContext {
+public:
+	ZLibContext();
+
+	~ZLibContext();
+
+	/**
+	 * Returns the thread's deflate stream, ready for a new block.
+	 * @returns deflate stream
+	 */
+	z_stream *getDeflater();
+
+	/**
+	 * Returns the thread's inflate stream, ready for a new block.
+	 * @returns inflate stream
+	 */
+	z_stream *getInflater();
+
+#ifdef HAVE_LIBDEFLATE
+	/**
+	 * Returns the thread's whole buffer decompressor, used when
+	 * a block is inflated into a buffer of its known raw size.
+	 * @returns libdeflate decompressor
+	 */
+	struct libdeflate_decompressor *getBlockInflater();
+#endif
+
+	/**
+	 * Returns scratch space of at least size bytes. The space only
+	 * grows, and is valid until the next call.
+	 * @param size required size
+	 * @returns scratch space
+	 */
+	Bytef *getScratch(size_t size) {
+		if (scratch.size() < size)
+			scratch.resize(size);
+		return scratch.data();
+	}
+
+	/**
+	 * Returns the context of the calling thread.
+	 */
+	static ZLibContext &local();
+
+protected:
+	z_stream deflater;
+	z_stream inflater;
+	bool deflaterInitialized;
+	bool inflaterInitialized;
+	std::vector<Bytef> scratch;
+#ifdef HAVE_LIBDEFLATE
+	struct libdeflate_decompressor *blockInflater;
+#endif
+};
+
 class ZLibCompressor: public Compressor {
 public:
 	ZLibCompressor() :
-			Compressor(), rawSize(0), total_out(0), in_buf(NULL) {
+			Compressor(), rawSize(0), total_out(0) {
 		init = false;
 		// initialize with the defautl buffer size.
 		initialize(64 * 1024);
@@ -38,7 +102,7 @@ public:
 	 * @param in_len input length
 	 */
 	explicit ZLibCompressor(uint32_t in_len) :
-			Compressor(), rawSize(0), total_out(0), in_buf(NULL) {
+			Compressor(), rawSize(0), total_out(0) {
 		init = false;
 		initialize(in_len);
 		buffer = NULL;
@@ -48,7 +112,7 @@ public:
 	}
 
 	virtual Compressor *newInstance() {
-		return new ZLibCompressor();
+		return new ZLibCompressor(input_length);
 	}
 
 	/**
@@ -97,6 +161,15 @@ public:
 	 */
 	void decompress(cclient::data::streams::OutputStream *out_stream);
 
+	/**
+	 * Inflates the input directly into out. Built with libdeflate,
+	 * the block is inflated in a single call; otherwise zlib is used.
+	 * @param out destination
+	 * @param capacity size of out
+	 * @returns decompressed size.
+	 */
+	size_t decompress(char *out, size_t capacity);
+
 protected:
 
 	/**
@@ -121,17 +194,11 @@ protected:
 	}
 
 	bool init;
-	// z lib stream
-	z_stream c_stream;
 	// raw size of the uncompressed data.
 	uint32_t rawSize;
-	// input buffer.
-	Bytef *in_buf;
 	// total output size.
 	uint32_t total_out;
 
-	// output buffer.
-	Bytef *out_buf;
 	// input length.
 	uint32_t input_length;
 	// output length
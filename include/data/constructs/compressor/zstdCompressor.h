@@ -0,0 +1,93 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ZSTD_COMPRESSOR_H
+#define ZSTD_COMPRESSOR_H
+
+#ifdef HAVE_ZSTD
+
+#include <stdexcept>
+#include "compressor.h"
+#include "../../streaming/DataOutputStream.h"
+#define ZSTD_NAME "zstd"
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+/**
+ * Zstandard. Blocks are zstd frames, as written by hadoop's
+ * ZStandardCodec. The compression and decompression contexts are
+ * kept by each thread.
+ */
+class ZstdCompressor: public Compressor {
+public:
+	ZstdCompressor() :
+			Compressor(), rawSize(0), total_out(0), level(3) {
+		Compressor::algorithm.setAlgorithm(ZSTD_NAME);
+	}
+
+	/**
+	 * @param level compression level
+	 */
+	explicit ZstdCompressor(int level) :
+			Compressor(), rawSize(0), total_out(0), level(level) {
+		Compressor::algorithm.setAlgorithm(ZSTD_NAME);
+	}
+
+	virtual ~ZstdCompressor() {
+	}
+
+	virtual Compressor *newInstance() {
+		return new ZstdCompressor(level);
+	}
+
+	uint32_t getBufferSize() {
+		return 256 * 1024;
+	}
+
+	uint32_t getCompressionOverHead() {
+		return 0;
+	}
+
+	uint32_t bytesWritten() {
+		return rawSize;
+	}
+
+	uint32_t getCompressedSize() {
+		return total_out;
+	}
+
+	std::string getName() {
+		return ZSTD_NAME;
+	}
+
+	void compress(cclient::data::streams::OutputStream *out_stream);
+
+	void decompress(cclient::data::streams::OutputStream *out_stream);
+
+	size_t decompress(char *out, size_t capacity);
+
+protected:
+	// raw size of the uncompressed data.
+	uint32_t rawSize;
+	// total output size.
+	uint32_t total_out;
+	// compression level.
+	int level;
+};
+}
+}
+}
+#endif
+#endif
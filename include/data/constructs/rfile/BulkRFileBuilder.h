@@ -0,0 +1,206 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BULKRFILEBUILDER_H_
+#define BULKRFILEBUILDER_H_
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include "../KeyValue.h"
+#include "../compressor/compressor.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Builds sorted RFiles from key values appended in any order. Entries
+ * are buffered up to a memory budget; each full buffer is sorted on a
+ * worker thread and spilled to a compressed run in a temporary
+ * directory while the next buffer fills. Closing the builder merges the
+ * runs into RFiles, starting a new file between rows once the current
+ * file reaches the target size.
+ */
+class BulkRFileBuilder
+{
+public:
+
+    /**
+     Constructor
+     @param outputPrefix prefix of the RFiles written, to which a
+     sequence number and the .rf extension are appended
+     @param tempDirectory directory in which runs are spilled
+     @param compressor compressor of the RFiles, from which each
+     thread spilling or merging runs creates its own
+     @param memoryBudget bytes of buffered entries, shared by the buffer
+     being filled and the buffers being sorted
+     @param threads number of threads sorting and spilling runs
+     **/
+    BulkRFileBuilder (const std::string &outputPrefix,
+                      const std::string &tempDirectory,
+                      cclient::data::compression::Compressor *compressor,
+                      uint64_t memoryBudget, uint16_t threads);
+
+    /**
+     Stops the workers and removes any remaining runs. Errors are only
+     reported through append and close.
+     **/
+    ~BulkRFileBuilder ();
+
+    /**
+     Sets the size at which a new RFile is started. A row is never split
+     across files, so files may exceed it by up to a row.
+     @param size target file size.
+     **/
+    void
+    setTargetFileSize (uint64_t size)
+    {
+        targetFileSize = size;
+    }
+
+    /**
+     Sets the number of runs merged at once. Larger sets of runs are
+     first merged into intermediate runs.
+     @param fanIn maximum number of runs open while merging.
+     **/
+    void
+    setMergeFanIn (uint32_t fanIn)
+    {
+        if (fanIn < 2)
+            throw std::runtime_error ("Merge fan in must be at least two");
+        mergeFanIn = fanIn;
+    }
+
+    /**
+     Appends an entry, waiting while every worker is busy with a full
+     buffer.
+     @param kv key value
+     @throws an error raised while spilling an earlier run.
+     **/
+    void
+    append (std::shared_ptr<KeyValue> kv);
+
+    /**
+     Merges the runs into RFiles. No entries may be appended afterward.
+     @return names of the RFiles written, in key order.
+     **/
+    std::vector<std::string>
+    close ();
+
+    /**
+     Estimates the memory held by a buffered entry.
+     @param kv key value
+     @return bytes held by the entry's fields and objects.
+     **/
+    static uint64_t
+    getEntrySize (KeyValue *kv);
+
+    /**
+     Returns the number of buffers spilled to runs so far.
+     **/
+    uint32_t
+    getRunCount ()
+    {
+        return spilledRuns;
+    }
+
+protected:
+
+    class RunWriter;
+    class RunReader;
+
+    /**
+     Hands the buffered entries to a worker.
+     **/
+    void
+    spill ();
+
+    void
+    run ();
+
+    /**
+     Sorts entries and writes them to a new run.
+     @return name of the run.
+     **/
+    std::string
+    writeRun (std::vector<std::shared_ptr<KeyValue>> &entries,
+              cclient::data::compression::Compressor *runCompressor);
+
+    /**
+     Merges runs in key order, passing each entry to the consumer.
+     **/
+    void
+    merge (const std::vector<std::string> &runs,
+           const std::function<void (std::shared_ptr<KeyValue>)> &consumer);
+
+    /**
+     Writes sorted entries to RFiles.
+     @param source function providing entries in key order to its argument
+     **/
+    void
+    writeFiles (
+        const std::function<void (const std::function<void (std::shared_ptr<KeyValue>)>&)> &source);
+
+    /**
+     Waits for the workers to spill every buffer, then stops them.
+     **/
+    void
+    stopWorkers ();
+
+    std::string
+    createRunFile ();
+
+    void
+    removeRuns ();
+
+    std::string outputPrefix;
+    std::string tempDirectory;
+    cclient::data::compression::Compressor *compressor;
+    uint64_t runBudget;
+    uint64_t targetFileSize;
+    uint32_t mergeFanIn;
+    uint16_t threadCount;
+    bool closed;
+
+    // entries of the buffer being filled
+    std::vector<std::shared_ptr<KeyValue>> buffer;
+    uint64_t bufferedBytes;
+    uint32_t spilledRuns;
+
+    std::mutex runLock;
+    std::condition_variable runsChanged;
+    // buffers awaiting a worker, with the index of their run
+    std::deque<std::pair<size_t, std::vector<std::shared_ptr<KeyValue>>>> pending;
+    // number of buffers being sorted or spilled
+    uint16_t active;
+    bool stopped;
+    std::exception_ptr error;
+    std::vector<std::string> runFiles;
+    std::vector<std::string> outputFiles;
+    std::vector<std::thread> workers;
+};
+
+}
+}
+
+#endif /* BULKRFILEBUILDER_H_ */
@@ -0,0 +1,103 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOCALRFILE_H_
+#define LOCALRFILE_H_
+
+#include <string>
+#include <memory>
+#include <fstream>
+
+#include "RFile.h"
+#include "../../streaming/ByteOutputStream.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * An RFile written to the local file system, with a single default
+ * locality group. Blocks are written to the file as the buffer holding
+ * them fills, so that only the buffer is held in memory.
+ */
+class LocalRFile
+{
+public:
+
+    /**
+     Constructor
+     @param name name of the file, which is truncated
+     @param compressor compressor of the file's blocks
+     @param bufferSize bytes buffered before they are written to the file
+     **/
+    LocalRFile (const std::string &name,
+                cclient::data::compression::Compressor *compressor,
+                size_t bufferSize = 1024 * 1024);
+
+    /**
+     Discards the file if it was not closed.
+     **/
+    ~LocalRFile ();
+
+    bool
+    append (std::shared_ptr<KeyValue> kv)
+    {
+        return rfile->append (kv);
+    }
+
+    /**
+     Returns the size of the data written so far, or the size of the
+     file once it is closed.
+     **/
+    uint64_t
+    getSize ();
+
+    const std::string &
+    getName ()
+    {
+        return name;
+    }
+
+    RFile *
+    getRFile ()
+    {
+        return rfile.get ();
+    }
+
+    /**
+     Closes the RFile and writes it to the file system.
+     @throws runtime_error if the file could not be written.
+     **/
+    void
+    close ();
+
+protected:
+
+    class FileStream;
+
+    std::string name;
+    std::ofstream file;
+    std::unique_ptr<cclient::data::streams::OutputStream> fileStream;
+    std::unique_ptr<FileStream> outStream;
+    std::unique_ptr<BlockCompressedFile> bcFile;
+    std::unique_ptr<RFile> rfile;
+    bool closed;
+    uint64_t size;
+};
+
+}
+}
+
+#endif /* LOCALRFILE_H_ */
@@ -0,0 +1,142 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PARALLELSCAN_H_
+#define PARALLELSCAN_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+#include "RFile.h"
+#include "../../streaming/input/MappedInputStream.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Scans a single RFile with several threads. The file is split into key
+ * ranges of roughly equal entry counts using its index, and each range is
+ * read by an independent cursor. Cursors share the file's mapping, the
+ * block cache and the parsed index blocks.
+ */
+class ParallelScan
+{
+public:
+
+    /**
+     Callback receiving the entries of the file.
+     @param partition partition from which the entry was read
+     @param key key of the entry
+     @param value copy of the entry's value
+     **/
+    typedef std::function<
+    void (uint32_t partition, std::shared_ptr<Key> key,
+          std::shared_ptr<Value> value)> EntryCallback;
+
+    /**
+     Constructor
+     @param file RFile to scan
+     @param partitions number of key ranges into which the file is split
+     @param threads number of threads reading partitions
+     **/
+    ParallelScan (const std::string &file, uint32_t partitions, uint16_t threads);
+
+    ~ParallelScan ();
+
+    /**
+     Restricts the scan to, or excludes, column families.
+     @param families column families
+     @param inclusive true if only the column families are returned.
+     **/
+    void
+    setColumnFamilies (std::vector<std::string> families, bool inclusive)
+    {
+        columnFamilies = families;
+        inclusiveFamilies = inclusive;
+    }
+
+    /**
+     Returns the keys at which the file is split. Partition i contains
+     the keys after split i - 1 up to, and including, split i.
+     @return split keys.
+     **/
+    const std::vector<std::shared_ptr<Key>> &
+    getSplits ()
+    {
+        return splits;
+    }
+
+    /**
+     Returns the number of partitions, which may be fewer than requested
+     if the file has too few index entries.
+     **/
+    uint32_t
+    getPartitionCount ()
+    {
+        return splits.size () + 1;
+    }
+
+    /**
+     Scans the file, returning once every partition has been read.
+     @param callback callback receiving every entry
+     @param ordered if true, entries are delivered in key order from the
+     calling thread, and each partition being read may queue a bounded
+     number of entries before its thread waits for the caller. Otherwise
+     entries are delivered from the scanning threads as they are read, in
+     which case the callback must be thread safe.
+     @return number of entries delivered.
+     **/
+    uint64_t
+    scan (EntryCallback callback, bool ordered);
+
+protected:
+
+    /**
+     Computes the split keys from the index of each locality group.
+     **/
+    void
+    computeSplits (RFile *file, uint32_t partitions);
+
+    /**
+     Reads a single partition.
+     @param partition partition to read
+     @param emit function receiving each entry; returns false to stop
+     **/
+    void
+    scanPartition (uint32_t partition,
+                   const std::function<bool (std::shared_ptr<Key>, Value*)> &emit);
+
+    // entries handed from a scanning thread to the caller at once
+    static const size_t BATCH_SIZE = 256;
+    // batches a partition may have queued before its thread blocks
+    static const size_t QUEUED_BATCHES = 4;
+
+    // mapping shared by every cursor
+    std::shared_ptr<cclient::data::streams::MappedRegion> region;
+    // parsed index blocks shared by every cursor
+    std::shared_ptr<IndexBlockCache> indexBlockCache;
+    std::vector<std::shared_ptr<Key>> splits;
+    std::vector<std::string> columnFamilies;
+    bool inclusiveFamilies;
+    uint16_t threadCount;
+};
+
+}
+}
+
+#endif /* PARALLELSCAN_H_ */
@@ -18,6 +18,8 @@
 #include <vector>
 #include <iterator>
 #include <memory>
+#include <set>
+#include <string>
 
 #include "../compressor/compressor.h"
 #include "../../streaming/Streams.h"
@@ -28,6 +30,7 @@
 // meta
 #include "meta/MetaBlock.h"
 #include "meta/LocalityGroupReader.h"
+#include "meta/LocalityGroupMerger.h"
 
 // bcfile
 #include "bcfile/meta_index.h"
@@ -91,7 +94,7 @@ public:
     createStream ()
     {
         return (BlockCompressorStream*) blockWriter->createDataStream (
-                   myDataStream);
+                   myDataStream, compressionPipeline.get ());
     }
 
     /**
@@ -109,6 +112,86 @@ public:
         currentLocalityGroup->setFirstKey (key);
     }
 
+    /**
+     Sets the cache through which decompressed blocks are read.
+     The process wide cache is used by default.
+     @param cache block cache. NULL disables caching for this file.
+     **/
+    void
+    setBlockCache (BlockCache *cache)
+    {
+        blockWriter->setBlockCache (cache);
+        for (LocalityGroupMetaData *group : localityGroups)
+        {
+            group->getIndexManager ()->setBlockCache (
+                cache, blockWriter->getFileIdentifier ());
+        }
+    }
+
+    /**
+     Shares a cache of parsed index blocks with other readers of
+     this file.
+     @param cache index block cache
+     **/
+    void
+    setIndexBlockCache (std::shared_ptr<IndexBlockCache> cache)
+    {
+        indexBlockCache = cache;
+        for (LocalityGroupMetaData *group : localityGroups)
+        {
+            group->getIndexManager ()->setIndexBlockCache (cache);
+        }
+    }
+
+    /**
+     Enables reading data blocks ahead of the scan on a background
+     thread per locality group. Only memory mapped files are read ahead.
+     @param depth maximum number of blocks read ahead per group, zero
+     disables reading ahead.
+     @param maxBytes maximum decompressed size read ahead per group.
+     @return true if reading ahead is enabled.
+     **/
+    bool
+    setReadAhead (uint16_t depth, uint64_t maxBytes)
+    {
+        bool enabled = !localityGroupReaders.empty ();
+        for (LocalityGroupReader *reader : localityGroupReaders)
+        {
+            enabled = reader->setReadAhead (depth, maxBytes) && enabled;
+        }
+        return enabled;
+    }
+
+    /**
+     Compresses data blocks on a pool of worker threads while the
+     next block is filled. Blocks are written to the file in order.
+     Must not be called once the data is closed.
+     @param threads number of compression threads, zero compresses
+     each block on the appending thread.
+     @param maxBlocks maximum number of filled blocks held in memory
+     awaiting compression or writing, zero for twice the thread count.
+     **/
+    void
+    setCompressionThreads (uint16_t threads, uint16_t maxBlocks = 0)
+    {
+        if (ownsBlockFile)
+            throw std::runtime_error ("Compression threads apply to files being written");
+        if (dataClosed || closed)
+            throw std::runtime_error ("Data block closed");
+        if (compressionPipeline != NULL)
+            compressionPipeline->flush ();
+        compressionPipeline.reset (
+            threads == 0 ? NULL :
+            new BlockCompressionPipeline (myDataStream, compressorRef, threads,
+                                          maxBlocks == 0 ? threads * 2 : maxBlocks));
+    }
+
+    std::shared_ptr<IndexBlockCache>
+    getIndexBlockCache ()
+    {
+        return indexBlockCache;
+    }
+
     static uint32_t
     generate_average (std::vector<std::shared_ptr<StreamInterface> > *keyValues)
     {
@@ -146,12 +229,31 @@ public:
     addLocalityGroup (std::string name = "")
     {
         closeCurrentGroup ();
-        LocalityGroupMetaData *group = new LocalityGroupMetaData (dataBlockCnt,
-                name);
+        // the group's blocks follow those of the preceding groups
+        LocalityGroupMetaData *group = new LocalityGroupMetaData (
+            blockWriter->getDataIndex ()->getBlockCount (), name,
+            new IndexWriter ([this] (const char *data, size_t size, BlockRegion *region)
+        {
+            writeIndexBlock (data, size, region);
+        }, [this] ()
+        {
+            if (compressionPipeline != NULL)
+                compressionPipeline->flush ();
+        }, maxIndexBlockSize));
         currentLocalityGroup = group;
         dataBlockCnt++;
 
     }
+
+    /**
+     Returns the locality groups of this file.
+     **/
+    const std::vector<LocalityGroupMetaData*> &
+    getLocalityGroups ()
+    {
+        return localityGroups;
+    }
+
     /**
      Closes the RFile.
      **/
@@ -166,18 +268,26 @@ public:
         if (dataClosed)
             return;
 
-        if (currentBlockWriter != NULL)
-        {
-            currentBlockWriter->flush ();
-            closeBlock (lastKeyValue->getKey ()->getStream());
-            //      currentBlockWriter->close();
-	    delete currentBlockWriter;
-            currentBlockWriter = NULL;
-        }
+        closeCurrentBlock ();
 
+        // the index may only be written after the last data block
+        if (compressionPipeline != NULL)
+            compressionPipeline->flush ();
         dataClosed = true;
 
     }
+    /**
+     Sets the size beyond which a level of a locality group's index
+     is written to the file as an index block. Applies to locality
+     groups added afterward.
+     @param size maximum index block size.
+     **/
+    void
+    setMaxIndexBlockSize (uint32_t size)
+    {
+        maxIndexBlockSize = size;
+    }
+
     /**
      Closes a block, setting the last key before closing it
      and adding that entry to the current locality group.
@@ -187,7 +297,8 @@ public:
     closeBlock (std::shared_ptr<StreamInterface> lastKey)
     {
     	std::cout << "Close block " << entries << lastKey << std::endl;
-        currentLocalityGroup->addIndexEntry (IndexEntry(lastKey, entries));
+        currentLocalityGroup->addIndexEntry (std::static_pointer_cast<Key> (lastKey),
+                                             entries, currentBlockWriter->getRegion ());
         dataBlockCnt = 0;
         entries = 0;
         currentBlockCount=0;
@@ -197,27 +308,36 @@ public:
     virtual bool
     hasNext ()
     {
-        return currentLocalityGroupReader->hasTop();
+        return NULL != currentLocalityGroupReader && currentLocalityGroupReader->hasTop();
     }
 
+    /**
+     Seeks the locality groups that may contain the requested column
+     families. Groups that cannot are not read.
+     @param location seek request
+     **/
     virtual void
-    relocate (cclient::data::streams::StreamRelocation *location)
-    {
-        currentLocalityGroupReader->seek(location);
-    }
+    relocate (cclient::data::streams::StreamRelocation *location);
 
 
-    virtual void next()
-    {
+    virtual void next();
 
-        currentLocalityGroupReader->next();
-    }
+    /**
+     Fills a batch with the entries of the file, beginning with the
+     current entry. The batch is cleared first, and the file is left
+     positioned after the last entry of the batch.
+     @param batch batch to fill
+     @param n maximum number of entries
+     @return number of entries in the batch.
+     **/
+    size_t
+    nextBatch (KeyValueBatch *batch, size_t n);
 
     virtual DataStream*
     operator++ ()
     {
 
-        currentLocalityGroupReader->next();
+        next();
         return this;
     }
 
@@ -249,7 +369,18 @@ public:
     operator* ()
     {
 
-        return std::make_pair (currentLocalityGroupReader->getTopKey(), nullptr);
+        // the reader's key is reused as it advances
+        return std::make_pair (currentLocalityGroupReader->copyTopKey(), nullptr);
+    }
+
+    /**
+     Returns the value of the current entry, which remains owned
+     by this RFile and is only valid until the next call to next.
+     **/
+    Value *
+    getTopValue ()
+    {
+        return currentLocalityGroupReader->getTopValue ();
     }
 
 protected:
@@ -257,6 +388,44 @@ protected:
     void
     readLocalityGroups (cclient::data::streams::InputStream *metaBlock);
 
+    /**
+     Determines whether a locality group may contain any of the
+     requested column families.
+     @param group locality group
+     @param columnFamilies requested column families
+     @param inclusive whether the column families are included or excluded
+     @param nonDefaultFamilies column families of the non default groups
+     @return true if the group must be read.
+     **/
+    static bool
+    isGroupSelected (LocalityGroupMetaData *group,
+                     const std::set<std::string> &columnFamilies, bool inclusive,
+                     const std::set<std::string> &nonDefaultFamilies);
+
+    /**
+     Closes the data block being written, if any.
+     **/
+    void
+    closeCurrentBlock ()
+    {
+        if (currentBlockWriter != NULL)
+        {
+            currentBlockWriter->flush ();
+            closeBlock (lastKeyValue->getKey ()->getStream());
+            //      currentBlockWriter->close();
+	    delete currentBlockWriter;
+            currentBlockWriter = NULL;
+        }
+    }
+
+    /**
+     Writes an index block to the file. Index blocks are located
+     through the entries of their parent, so they are not added to
+     the data index.
+     **/
+    void
+    writeIndexBlock (const char *data, size_t size, BlockRegion *region);
+
     /**
      Closes the current locality group.
      **/
@@ -265,6 +434,8 @@ protected:
     {
         if (currentLocalityGroup != NULL)
         {
+            closeCurrentBlock ();
+            currentLocalityGroup->closeIndex ();
             localityGroups.push_back (currentLocalityGroup);
             currentLocalityGroup = NULL;
             dataBlockCnt = 0;
@@ -294,15 +465,25 @@ protected:
     // list of locality group pointers.
     std::vector<LocalityGroupMetaData*> localityGroups;
     std::vector<LocalityGroupReader*> localityGroupReaders;
+    // merges the readers selected by the last seek.
+    LocalityGroupMerger merger;
 
     // block compressed file.
     BlockCompressedFile *blockWriter;
+    // true if the block compressed file was created by this RFile.
+    bool ownsBlockFile;
     // compressor reference.
     cclient::data::compression::Compressor *compressorRef;
+    // parsed index blocks, shared by the locality group readers.
+    std::shared_ptr<IndexBlockCache> indexBlockCache;
     // current block writer, created from blockWriter.
     BlockCompressorStream *currentBlockWriter;
+    // compresses filled blocks in the background, if enabled.
+    std::unique_ptr<BlockCompressionPipeline> compressionPipeline;
     // maximum block size.
     uint32_t maxBlockSize;
+    // maximum index block size.
+    uint32_t maxIndexBlockSize;
     // boolean identifying a closed data block.
     bool dataClosed;
     // boolean identifying closed rfile.
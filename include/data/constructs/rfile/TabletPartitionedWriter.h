@@ -0,0 +1,197 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TABLETPARTITIONEDWRITER_H_
+#define TABLETPARTITIONEDWRITER_H_
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+
+#include "../KeyValue.h"
+#include "../compressor/compressor.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * An RFile written for a single tablet.
+ */
+struct BulkFile
+{
+    std::string file;
+    // index of the tablet within the table's splits
+    uint32_t tablet;
+    // end row of the preceding tablet, empty for the first tablet
+    std::string prevEndRow;
+    // end row of the tablet, empty for the last tablet
+    std::string endRow;
+    uint64_t entries;
+    uint64_t size;
+};
+
+/**
+ * Routes key values, in any order, to the tablets defined by a table's
+ * split points, so that every RFile written falls within a single
+ * tablet. Each tablet buffers its entries; a tablet whose buffer reaches
+ * the target file size, or the largest tablet once the memory budget is
+ * exhausted, is sorted and written to a new RFile on a worker thread.
+ * The files of a directory may then be bulk imported, each being
+ * assigned to one tablet.
+ */
+class TabletPartitionedWriter
+{
+public:
+
+    /**
+     Constructor
+     @param directory directory in which RFiles are written
+     @param splits end rows of the table's tablets, in any order. The
+     empty end row of the last tablet is ignored.
+     @param compressor compressor from which each worker creates its own
+     @param memoryBudget bytes of entries buffered across all tablets,
+     including the buffers waiting for or being written by a worker
+     @param threads number of threads writing RFiles
+     **/
+    TabletPartitionedWriter (const std::string &directory,
+                             std::vector<std::string> splits,
+                             cclient::data::compression::Compressor *compressor,
+                             uint64_t memoryBudget, uint16_t threads);
+
+    /**
+     Stops the workers, discarding buffered entries. Files already
+     written are kept.
+     **/
+    ~TabletPartitionedWriter ();
+
+    /**
+     Sets the buffered size at which a tablet's entries are written to
+     a file.
+     @param size target file size, before compression.
+     **/
+    void
+    setTargetFileSize (uint64_t size)
+    {
+        targetFileSize = size;
+    }
+
+    /**
+     Appends an entry, waiting while every worker is busy or while the
+     buffers being written exhaust the memory budget.
+     @param kv key value
+     @throws an error raised while writing an earlier file.
+     **/
+    void
+    append (std::shared_ptr<KeyValue> kv);
+
+    /**
+     Writes the remaining entries. No entries may be appended afterward.
+     @return the files written, ordered by tablet.
+     **/
+    std::vector<BulkFile>
+    close ();
+
+    uint32_t
+    getTabletCount ()
+    {
+        return splits.size () + 1;
+    }
+
+    /**
+     Returns the tablet containing a row.
+     @param row row
+     @param len length of the row
+     @return index of the tablet.
+     **/
+    uint32_t
+    getTablet (const char *row, size_t len);
+
+protected:
+
+    struct Tablet
+    {
+        Tablet () :
+            bytes (0), files (0)
+        {
+        }
+
+        std::vector<std::shared_ptr<KeyValue>> entries;
+        uint64_t bytes;
+        // number of files handed to the workers
+        uint32_t files;
+    };
+
+    struct Job
+    {
+        uint32_t tablet;
+        uint32_t sequence;
+        std::vector<std::shared_ptr<KeyValue>> entries;
+        uint64_t bytes;
+    };
+
+    /**
+     Hands a tablet's buffered entries to a worker.
+     **/
+    void
+    submit (uint32_t tablet);
+
+    void
+    run ();
+
+    /**
+     Sorts a job's entries and writes them to an RFile.
+     **/
+    BulkFile
+    writeFile (Job &job, cclient::data::compression::Compressor *fileCompressor);
+
+    void
+    stopWorkers ();
+
+    std::string directory;
+    std::vector<std::string> splits;
+    cclient::data::compression::Compressor *compressor;
+    uint64_t memoryBudget;
+    uint64_t targetFileSize;
+    uint16_t threadCount;
+    bool closed;
+
+    std::vector<Tablet> tablets;
+    // bytes buffered across all tablets
+    uint64_t bufferedBytes;
+    // bytes of the jobs not yet written, released once their file is
+    std::atomic<uint64_t> writingBytes;
+
+    std::mutex jobLock;
+    std::condition_variable jobsChanged;
+    std::deque<Job> pending;
+    // number of jobs being written
+    uint16_t active;
+    bool stopped;
+    std::exception_ptr error;
+    std::vector<BulkFile> files;
+    std::vector<std::thread> workers;
+};
+
+}
+}
+
+#endif /* TABLETPARTITIONEDWRITER_H_ */
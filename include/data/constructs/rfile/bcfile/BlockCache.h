@@ -0,0 +1,224 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BLOCKCACHE_H_
+#define BLOCKCACHE_H_
+
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+#include "../../../streaming/input/NetworkOrderInputStream.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Decompressed block, shared between the cache and any readers.
+ */
+typedef std::vector<char> DecompressedBlock;
+
+/**
+ * Input stream over a cached, decompressed block. Holds a reference
+ * to the block so that it may outlive its eviction from the cache.
+ */
+class CachedBlockInputStream : public cclient::data::streams::EndianInputStream
+{
+public:
+    explicit CachedBlockInputStream (std::shared_ptr<DecompressedBlock> block) :
+        cclient::data::streams::EndianInputStream (block->data (), block->size (),
+                false), block (block)
+    {
+    }
+
+    virtual
+    ~CachedBlockInputStream ()
+    {
+    }
+
+    std::shared_ptr<DecompressedBlock>
+    getBlock ()
+    {
+        return block;
+    }
+
+protected:
+    std::shared_ptr<DecompressedBlock> block;
+};
+
+/**
+ * Size bounded, sharded LRU cache of decompressed RFile blocks. Blocks
+ * are keyed by the identity of the file and the offset of the block
+ * within that file.
+ */
+class BlockCache
+{
+public:
+    /**
+     Constructor
+     @param maxSize maximum number of decompressed bytes held by the cache.
+     @param shardCount number of independently locked shards.
+     **/
+    explicit BlockCache (uint64_t maxSize, uint16_t shardCount = 16);
+
+    ~BlockCache ();
+
+    /**
+     Returns the process wide block cache.
+     @return block cache shared by all RFile readers.
+     **/
+    static BlockCache *
+    getInstance ();
+
+    /**
+     Generates an identifier for a file whose identity cannot be
+     determined from the file system.
+     @return unique file identifier.
+     **/
+    static uint64_t
+    nextFileIdentifier ();
+
+    /**
+     Retrieves a block.
+     @param fileId file identifier
+     @param offset offset of the block within the file
+     @return block or null if it is not cached.
+     **/
+    std::shared_ptr<DecompressedBlock>
+    get (uint64_t fileId, uint64_t offset);
+
+    /**
+     Caches a block, evicting the least recently used blocks of the
+     shard until it fits.
+     @param fileId file identifier
+     @param offset offset of the block within the file
+     @param block decompressed block.
+     **/
+    void
+    put (uint64_t fileId, uint64_t offset,
+         std::shared_ptr<DecompressedBlock> block);
+
+    /**
+     Sets the maximum size of the cache. Shrinking the cache
+     evicts blocks immediately.
+     @param maxSize maximum number of decompressed bytes.
+     **/
+    void
+    setMaxSize (uint64_t maxSize);
+
+    uint64_t
+    getMaxSize ()
+    {
+        return maxSize;
+    }
+
+    /**
+     Returns the number of decompressed bytes held by the cache.
+     **/
+    uint64_t
+    getSize ();
+
+    uint64_t
+    getHitCount ()
+    {
+        return hits;
+    }
+
+    uint64_t
+    getMissCount ()
+    {
+        return misses;
+    }
+
+    uint64_t
+    getEvictionCount ()
+    {
+        return evictions;
+    }
+
+    /**
+     Removes all blocks from the cache.
+     **/
+    void
+    clear ();
+
+protected:
+
+    struct CacheKey
+    {
+        uint64_t fileId;
+        uint64_t offset;
+
+        bool
+        operator== (const CacheKey &other) const
+        {
+            return fileId == other.fileId && offset == other.offset;
+        }
+    };
+
+    struct CacheKeyHash
+    {
+        size_t
+        operator() (const CacheKey &key) const
+        {
+            uint64_t h = key.fileId * 0x9E3779B97F4A7C15ULL;
+            h ^= key.offset + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    typedef std::pair<CacheKey, std::shared_ptr<DecompressedBlock>> CacheEntry;
+
+    struct Shard
+    {
+        std::mutex shardLock;
+        // most recently used at the front
+        std::list<CacheEntry> lru;
+        std::unordered_map<CacheKey, std::list<CacheEntry>::iterator, CacheKeyHash> entries;
+        uint64_t size;
+        uint64_t capacity;
+
+        Shard () :
+            size (0), capacity (0)
+        {
+        }
+    };
+
+    Shard &
+    getShard (const CacheKey &key)
+    {
+        return shards[CacheKeyHash () (key) % shardCount];
+    }
+
+    // evicts until the shard fits within its capacity. lock must be held.
+    void
+    evict (Shard &shard);
+
+    uint16_t shardCount;
+    Shard *shards;
+    uint64_t maxSize;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+};
+
+}
+}
+
+#endif /* BLOCKCACHE_H_ */
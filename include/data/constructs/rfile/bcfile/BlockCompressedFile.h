@@ -43,7 +43,7 @@ public:
      * @param compressor our compressor for this BCFile
      */
     explicit BlockCompressedFile (cclient::data::compression::Compressor *compressor) :
-        compressorRef (compressor)
+        compressorRef (compressor), blockCache (NULL), fileIdentifier (0)
     {
         version.setMajor (1);
         version.setMinor (0);
@@ -56,8 +56,16 @@ public:
      * @param compressor our compressor for this BCFile
      */
     BlockCompressedFile (cclient::data::streams::InputStream *in_stream, long fileLength) :
-        in_stream (in_stream)
+        compressorRef (NULL), blockCache (BlockCache::getInstance ()), in_stream (
+            in_stream)
     {
+        cclient::data::streams::MappedInputStream *mappedStream =
+            dynamic_cast<cclient::data::streams::MappedInputStream*> (in_stream);
+        if (NULL != mappedStream)
+            fileIdentifier = mappedStream->getRegion ()->getIdentity ();
+        else
+            fileIdentifier = BlockCache::nextFileIdentifier ();
+
         verifyStructure (fileLength);
 
     }
@@ -86,6 +94,33 @@ public:
         return &dataIndex;
     }
 
+    /**
+     * Returns the cache of decompressed blocks used when reading,
+     * or NULL if blocks are not cached.
+     * @returns block cache
+     */
+    BlockCache *
+    getBlockCache ()
+    {
+        return blockCache;
+    }
+
+    void
+    setBlockCache (BlockCache *cache)
+    {
+        blockCache = cache;
+    }
+
+    /**
+     * Returns the identifier under which this file's blocks are cached.
+     * @returns file identifier
+     */
+    uint64_t
+    getFileIdentifier ()
+    {
+        return fileIdentifier;
+    }
+
     MetaIndex *
     getMetaIndex ()
     {
@@ -99,11 +134,18 @@ public:
                                           entry->getRegion ());
     }
 
+    /**
+     * Creates a stream for the next data block.
+     * @param out file output stream
+     * @param pipeline pipeline compressing and writing the block, or
+     * NULL to compress it when the stream is flushed.
+     */
     cclient::data::streams::DataOutputStream *
-    createDataStream (cclient::data::streams::OutputStream *out)
+    createDataStream (cclient::data::streams::OutputStream *out,
+                      BlockCompressionPipeline *pipeline = NULL)
     {
         return new BlockCompressorStream (out, compressorRef,
-                                          dataIndex.addBlockRegion ());
+                                          dataIndex.addBlockRegion (), pipeline);
     }
 
     MetaIndexEntry *
@@ -161,18 +203,44 @@ protected:
     verifyStructure (long fileLength)
     {
         const size_t magic_size = array_length (B_MAGIC_BCFILE);
-        in_stream->seek (fileLength - magic_size - VERSION_SIZE);
-        version.read (in_stream);
-        uint8_t* magicVerify = new uint8_t[16];
-        in_stream->readBytes (magicVerify, 16);
-        if (memcmp (B_MAGIC_BCFILE, magicVerify, 16) != 0)
+        cclient::data::streams::MappedInputStream *mappedStream =
+            dynamic_cast<cclient::data::streams::MappedInputStream*> (in_stream);
+        if (NULL != mappedStream)
         {
-            throw std::runtime_error ("Invalid Magic Number");
+            // the trailer can be read in place, without moving the stream
+            const uint64_t trailer = fileLength - magic_size - VERSION_SIZE - 8;
+            uint8_t trailerBytes[8 + VERSION_SIZE + 16];
+            mappedStream->readAt (trailer, trailerBytes, sizeof (trailerBytes));
+            if (memcmp (B_MAGIC_BCFILE, trailerBytes + 8 + VERSION_SIZE, 16) != 0)
+            {
+                throw std::runtime_error ("Invalid Magic Number");
+            }
+            // the trailer is written in network order
+            uint64_t indexMeta;
+            uint16_t major, minor;
+            memcpy (&indexMeta, trailerBytes, 8);
+            memcpy (&major, trailerBytes + 8, 2);
+            memcpy (&minor, trailerBytes + 10, 2);
+            offsetIndexMeta = be64toh (indexMeta);
+            version.maj = be16toh (major);
+            version.min = be16toh (minor);
+        }
+        else
+        {
+            in_stream->seek (fileLength - magic_size - VERSION_SIZE);
+            version.read (in_stream);
+            uint8_t* magicVerify = new uint8_t[16];
+            in_stream->readBytes (magicVerify, 16);
+            if (memcmp (B_MAGIC_BCFILE, magicVerify, 16) != 0)
+            {
+                delete[] magicVerify;
+                throw std::runtime_error ("Invalid Magic Number");
+            }
+            delete[] magicVerify;
+            // get the index meta
+            in_stream->seek (fileLength - magic_size - VERSION_SIZE - 8);
+            offsetIndexMeta = in_stream->readLong ();
         }
-        delete[] magicVerify;
-        // get the index meta
-        in_stream->seek (fileLength - magic_size - VERSION_SIZE - 8);
-        offsetIndexMeta = in_stream->readLong ();
 
 
         in_stream->seek (offsetIndexMeta);
@@ -194,6 +262,11 @@ protected:
     MetaIndex metaIndex;
     RFileVersion version;
 
+    // cache of decompressed blocks
+    BlockCache *blockCache;
+    // identifies this file within the block cache
+    uint64_t fileIdentifier;
+
     // for reading
     cclient::data::streams::InputStream *in_stream;
     uint64_t offsetIndexMeta;
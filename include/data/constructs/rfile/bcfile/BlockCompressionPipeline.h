@@ -0,0 +1,131 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDE_DATA_CONSTRUCTS_RFILE_BCFILE_BLOCKCOMPRESSIONPIPELINE_H_
+#define INCLUDE_DATA_CONSTRUCTS_RFILE_BCFILE_BLOCKCOMPRESSIONPIPELINE_H_
+
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+
+#include "../../compressor/compressor.h"
+#include "../../../streaming/ByteOutputStream.h"
+#include "BlockRegion.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Compresses raw data blocks on a pool of worker threads while the
+ * writer fills the next block. Compressed blocks are written to the
+ * output stream in the order in which they were submitted, and their
+ * regions receive the offset at which they were written. At most
+ * maxBlocks submitted blocks are held at any time.
+ */
+class BlockCompressionPipeline
+{
+public:
+
+    /**
+     Constructor
+     @param out output stream to which compressed blocks are written.
+     No other writes may be made to it until the pipeline is flushed.
+     @param compressor compressor from which each worker creates its own
+     @param threads number of compression workers
+     @param maxBlocks maximum number of blocks submitted but not yet written
+     **/
+    BlockCompressionPipeline (cclient::data::streams::OutputStream *out,
+                              cclient::data::compression::Compressor *compressor,
+                              uint16_t threads, uint16_t maxBlocks);
+
+    /**
+     Writes the remaining blocks, then stops the workers. Errors are
+     only reported through flush.
+     **/
+    ~BlockCompressionPipeline ();
+
+    /**
+     Submits a raw block for compression, waiting while maxBlocks blocks
+     are already in flight.
+     @param raw uncompressed block, taken by the pipeline
+     @param region region describing the block once it is written
+     @throws an error raised by an earlier block.
+     **/
+    void
+    submit (std::vector<char> &&raw, BlockRegion *region);
+
+    /**
+     Waits until every submitted block is written.
+     @throws the first error raised while compressing or writing a block.
+     **/
+    void
+    flush ();
+
+    uint16_t
+    getThreads ()
+    {
+        return workers.size ();
+    }
+
+    uint16_t
+    getMaxBlocks ()
+    {
+        return maxBlocks;
+    }
+
+protected:
+
+    struct PendingBlock
+    {
+        std::vector<char> raw;
+        BlockRegion *region;
+        bool claimed;
+        bool compressed;
+        std::unique_ptr<cclient::data::streams::ByteOutputStream> data;
+    };
+
+    void
+    run ();
+
+    /**
+     Writes the completed blocks at the front of the queue. Called with
+     the lock held; the lock is released while writing.
+     **/
+    void
+    commit (std::unique_lock<std::mutex> &lock);
+
+    cclient::data::streams::OutputStream *out;
+    cclient::data::compression::Compressor *compressor;
+    uint16_t maxBlocks;
+
+    std::mutex queueLock;
+    std::condition_variable queueChanged;
+    // submitted blocks, in the order they are written.
+    std::deque<std::shared_ptr<PendingBlock>> blocks;
+    // true while a block is written outside of the lock.
+    bool committing;
+    bool stopped;
+    std::exception_ptr error;
+    std::vector<std::thread> workers;
+};
+
+}
+}
+
+#endif /* INCLUDE_DATA_CONSTRUCTS_RFILE_BCFILE_BLOCKCOMPRESSIONPIPELINE_H_ */
@@ -20,6 +20,8 @@
 #include "../../../streaming/ByteOutputStream.h"
 #include "../../../streaming/input/ByteInputStream.h"
 #include "../../../streaming/input/NetworkOrderInputStream.h"
+#include "../../../streaming/input/MappedInputStream.h"
+#include "BlockCache.h"
 
 namespace cclient
 {
@@ -44,7 +46,8 @@ public:
 
     }
 
-    BlockRegion (cclient::data::streams::InputStream *in)
+    BlockRegion (cclient::data::streams::InputStream *in) :
+        compressor (NULL)
     {
         read (in);
     }
@@ -68,7 +71,7 @@ public:
      @param off offset.
      **/
     void
-    setOffset (uint32_t off)
+    setOffset (uint64_t off)
     {
         offset = off;
     }
@@ -78,7 +81,7 @@ public:
      @param csize compressed size.
      **/
     void
-    setCompressedSize (uint32_t csize)
+    setCompressedSize (uint64_t csize)
     {
         compressedSize = csize;
     }
@@ -87,7 +90,7 @@ public:
      Sets the raw size
      **/
     void
-    setRawSize (uint32_t rsize)
+    setRawSize (uint64_t rsize)
     {
         rawSize = rsize;
     }
@@ -119,35 +122,84 @@ public:
     uint64_t
     write (cclient::data::streams::OutputStream *out);
 
-    cclient::data::streams::InputStream *
-    readDataStream (cclient::data::streams::InputStream *in)
+    /**
+     Reads and decompresses this region.
+     @param in input stream of the file containing this region.
+     @return decompressed block.
+     **/
+    std::shared_ptr<DecompressedBlock>
+    readDataBlock (cclient::data::streams::InputStream *in)
     {
 
-        uint64_t pos = in->getPos();
-
+        std::unique_ptr<uint8_t[]> compressedValue;
 
-        in->seek (offset);
+        // mapped files hand us the compressed bytes directly
+        cclient::data::streams::MappedInputStream *mappedStream =
+            dynamic_cast<cclient::data::streams::MappedInputStream*> (in);
 
-        uint8_t *compressedValue = new uint8_t[compressedSize];
+        const uint8_t *span = NULL;
+        if (NULL != mappedStream)
+        {
+            span = mappedStream->getSpan (offset, compressedSize);
+        }
 
-        in->readBytes (compressedValue, compressedSize);
+        if (NULL != span)
+        {
+            compressor->setInput ((const char*) span, 0, compressedSize);
+        }
+        else
+        {
+            compressedValue.reset (new uint8_t[compressedSize]);
 
+            // read positionally, as other readers may share the stream
+            in->readAt (offset, compressedValue.get (), compressedSize);
 
-        compressor->setInput ((const char*) compressedValue, 0, compressedSize);
+            compressor->setInput ((const char*) compressedValue.get (), 0,
+                                  compressedSize);
+        }
 
-        cclient::data::streams::ByteOutputStream *outStream = new cclient::data::streams::ByteOutputStream (rawSize);
-
-        compressor->decompress (outStream);
+        // decompress straight into the block
+        std::shared_ptr<DecompressedBlock> block = std::make_shared<DecompressedBlock> (
+            rawSize);
+        block->resize (compressor->decompress (block->data (), rawSize));
 
+        return block;
+    }
 
-        cclient::data::streams::EndianInputStream *returnStream = new cclient::data::streams::EndianInputStream (
-            outStream->getByteArray (), outStream->getSize (), true);
+    /**
+     Reads and decompresses this region, consulting the cache first.
+     @param in input stream of the file containing this region.
+     @param cache block cache, may be null.
+     @param fileId identifier of the file containing this region.
+     @return decompressed block.
+     **/
+    std::shared_ptr<DecompressedBlock>
+    readDataBlock (cclient::data::streams::InputStream *in, BlockCache *cache,
+                   uint64_t fileId)
+    {
+        if (NULL == cache)
+            return readDataBlock (in);
+
+        std::shared_ptr<DecompressedBlock> block = cache->get (fileId, offset);
+        if (NULL == block)
+        {
+            block = readDataBlock (in);
+            cache->put (fileId, offset, block);
+        }
+        return block;
+    }
 
-        in->seek(pos);
-        delete[] compressedValue;
-        delete outStream;
+    cclient::data::streams::InputStream *
+    readDataStream (cclient::data::streams::InputStream *in)
+    {
+        return new CachedBlockInputStream (readDataBlock (in));
+    }
 
-        return returnStream;
+    cclient::data::streams::InputStream *
+    readDataStream (cclient::data::streams::InputStream *in, BlockCache *cache,
+                    uint64_t fileId)
+    {
+        return new CachedBlockInputStream (readDataBlock (in, cache, fileId));
     }
 
     BlockRegion &
@@ -161,19 +213,19 @@ public:
         return *this;
     }
 
-    uint32_t
+    uint64_t
     getOffset ()
     {
         return offset;
     }
 
-    uint32_t
+    uint64_t
     getCompressedSize ()
     {
         return compressedSize;
     }
 
-    uint32_t
+    uint64_t
     getRawSize ()
     {
         return rawSize;
@@ -183,11 +235,11 @@ protected:
     // compressor.
     cclient::data::compression::Compressor *compressor;
     // offset.
-    uint32_t offset;
+    uint64_t offset;
     // compressed size.
-    uint32_t compressedSize;
+    uint64_t compressedSize;
     // raw size.
-    uint32_t rawSize;
+    uint64_t rawSize;
 };
 }
 }
@@ -22,6 +22,7 @@
 #include "../../../streaming/input/NetworkOrderInputStream.h"
 #include "../../../streaming/EndianTranslation.h"
 #include "BlockRegion.h"
+#include "BlockCompressionPipeline.h"
 
 namespace cclient {
 namespace data {
@@ -57,9 +58,10 @@ class BlockCompressorStream: private BlockStreambuffer,
     public std::istream {
 
 public:
-    // takes ownership of the compressor
+    // takes ownership of the compressor. when a pipeline is given, the
+    // block is handed to it on flush and out_stream is not accessed.
     BlockCompressorStream(OutputStream *out_stream, cclient::data::compression::Compressor *compressor,
-                          BlockRegion *region);
+                          BlockRegion *region, BlockCompressionPipeline *pipeline = NULL);
 
     BlockCompressorStream(InputStream *in_stream,cclient::data::compression::Compressor *decompressor,BlockRegion *region);
 
@@ -80,10 +82,13 @@ public:
 
     /**
      * Returns the current position.
-     * @returns the current position of the output stream.
+     * @returns the current position of the output stream, or the
+     * position within the block if it is written by a pipeline.
      */
     uint64_t getPos() {
-        if (NULL != output_stream) {
+        if (NULL != pipeline) {
+            return growingBuffer.size();
+        } else if (NULL != output_stream) {
             return output_stream->getPos();
         } else {
             return EndianInputStream::getPos();
@@ -91,6 +96,13 @@ public:
 
     }
 
+    /**
+     * Returns the region of the block being written.
+     */
+    BlockRegion *getRegion() {
+        return associatedRegion;
+    }
+
     /**
      * Returns the reference to the compressor
      */
@@ -106,6 +118,23 @@ public:
     }
 
 
+    /**
+     * Encodes a hadoop variable length long directly into the
+     * block buffer.
+     * @param n value to write
+     * @returns the current position.
+     */
+    virtual uint64_t writeVLong(const int64_t n) {
+        char *encoded = reserve(streams::VLongEncoder::MAX_LENGTH);
+        size_t len = streams::VLongEncoder::encode(encoded, n);
+        growingBuffer.resize(growingBuffer.size() - streams::VLongEncoder::MAX_LENGTH + len);
+        return getPos();
+    }
+
+    virtual uint64_t writeHadoopLong(const int64_t n) {
+        return BlockCompressorStream::writeVLong(n);
+    }
+
     /**
      * Flushes the block compressor stream.
      * should be called when finished or by xsputn
@@ -118,6 +147,14 @@ public:
         if (location == 0)
             return;
 
+        if (NULL != pipeline) {
+            // the region is completed when the pipeline writes the block
+            pipeline->submit(std::move(growingBuffer), associatedRegion);
+            growingBuffer.clear();
+            blockLoc = 0;
+            return;
+        }
+
         // copy the input bufer to the compressor and call the
         // compress function on it.
 
@@ -151,23 +188,33 @@ public:
 
         if (n == 0)
             return 0;
+
+        memcpy(reserve(n), s, n);
+
+        return n;
+    }
+
+protected:
+
+    /**
+     * Extends the growing buffer by cnt bytes.
+     * @param cnt number of bytes
+     * @returns pointer to the new bytes.
+     */
+    inline char *reserve(size_t cnt) {
         // if we have not started writing we need to set the stream
         // offset of the compressor
-        if (!writeStart)
+        if (!writeStart && NULL == pipeline)
             compress->setStreamOffset(output_stream->getPos());
 
         writeStart = true;
 
         size_t location = growingBuffer.size();
         // resize the growing buffer.
-        growingBuffer.resize(location + n);
-
-        memcpy(&growingBuffer.at(location), s, n);
-
-        return n;
+        growingBuffer.resize(location + cnt);
+        return &growingBuffer.at(location);
     }
 
-protected:
     // output steram.
     OutputStream *output_stream;
     // block location.
@@ -179,6 +226,8 @@ protected:
     // compressor reference.
     cclient::data::compression::Compressor  *compress;
     BlockRegion *associatedRegion;
+    // compresses and writes the block, if set.
+    BlockCompressionPipeline *pipeline;
 
     InputStream *input_stream;
 
@@ -53,6 +53,13 @@ public:
         return reg;
     }
 
+    /**
+     * Returns the number of blocks in the index.
+     */
+    size_t getBlockCount() {
+        return listRegions.size();
+    }
+
     BlockRegion *getBlockRegion(int index) {
         return listRegions.at(index);
     }
@@ -40,6 +40,13 @@ public:
     virtual std::shared_ptr<BaseMetaBlock>
     getPreviousBlock () = 0;
 
+    /**
+     * Returns the first leaf following this block, positioned at its
+     * first entry.
+     */
+    virtual std::shared_ptr<BaseMetaBlock>
+    getNextBlock () = 0;
+
     virtual uint32_t
     getOffset () = 0;
 
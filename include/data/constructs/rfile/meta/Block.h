@@ -126,6 +126,39 @@ public:
 
 	}
 
+	/**
+	 * Positions this block at its first entry, descending to the first leaf.
+	 */
+	std::shared_ptr<Block> getFirst() {
+		currentPosition = 0;
+		if (indexBlock->getLevel() == 0) {
+			return shared_from_this();
+		}
+
+		std::shared_ptr<IndexEntry> ie = indexBlock->getIndex()->get(
+				currentPosition);
+		std::shared_ptr<Block> newChild = std::make_shared<Block>(
+				shared_from_this(), getIndexBlock(ie));
+		return newChild->getFirst();
+	}
+
+	std::shared_ptr<BaseMetaBlock> getNext() {
+		if (currentPosition + 1 >= indexBlock->getIndex()->size()) {
+			if (parent == NULL) {
+				throw std::runtime_error("Illegal state");
+			}
+			return parent->getNext();
+		}
+
+		currentPosition++;
+
+		std::shared_ptr<IndexEntry> ie = indexBlock->getIndex()->get(
+				currentPosition);
+		std::shared_ptr<Block> newChild = std::make_shared<Block>(
+				shared_from_this(), getIndexBlock(ie));
+		return newChild->getFirst();
+	}
+
 	std::shared_ptr<BaseMetaBlock> getPrevious() {
 		if (currentPosition == 0) {
 			return parent->getPrevious();
@@ -150,6 +183,13 @@ public:
 		return parent->getPrevious();
 	}
 
+	std::shared_ptr<BaseMetaBlock> getNextBlock() {
+		if (parent == NULL) {
+			throw std::runtime_error("Illegal state");
+		}
+		return parent->getNext();
+	}
+
 };
 }
 }
@@ -0,0 +1,129 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDE_DATA_CONSTRUCTS_RFILE_META_BLOCKREADAHEAD_H_
+#define INCLUDE_DATA_CONSTRUCTS_RFILE_META_BLOCKREADAHEAD_H_
+
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+
+#include "../bcfile/BlockCache.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Reads and decompresses data blocks on a background thread ahead of
+ * the reader consuming them. Blocks are loaded in the order in which
+ * they are requested; at most depth blocks, whose raw sizes total no
+ * more than the byte budget, are held at any time.
+ */
+class BlockReadAhead
+{
+public:
+
+    /**
+     Function loading a data block of the file by its index.
+     **/
+    typedef std::function<std::shared_ptr<DecompressedBlock> (uint32_t)> BlockLoader;
+
+    /**
+     Constructor
+     @param loader function used to load blocks. It is called from the
+     background thread.
+     @param depth maximum number of blocks read ahead
+     @param maxBytes maximum raw size of the blocks read ahead. A single
+     block larger than the budget is still read ahead.
+     **/
+    BlockReadAhead (BlockLoader loader, uint16_t depth, uint64_t maxBytes);
+
+    ~BlockReadAhead ();
+
+    /**
+     Requests that a block be read ahead.
+     @param block index of the block
+     @param rawSize decompressed size of the block
+     @return false if the depth or byte budget is exhausted.
+     **/
+    bool
+    prefetch (uint32_t block, uint64_t rawSize);
+
+    /**
+     Retrieves a block requested through prefetch, waiting for it to be
+     loaded if necessary. Blocks requested before it are discarded.
+     @param block index of the block
+     @return decompressed block, or null if the block wasn't requested.
+     **/
+    std::shared_ptr<DecompressedBlock>
+    take (uint32_t block);
+
+    /**
+     Discards every requested block, waiting for a load in progress
+     to complete.
+     **/
+    void
+    cancel ();
+
+    uint16_t
+    getDepth ()
+    {
+        return depth;
+    }
+
+    uint64_t
+    getMaxBytes ()
+    {
+        return maxBytes;
+    }
+
+protected:
+
+    struct PendingBlock
+    {
+        uint32_t block;
+        uint64_t rawSize;
+        bool loaded;
+        std::shared_ptr<DecompressedBlock> data;
+        std::exception_ptr error;
+    };
+
+    void
+    run ();
+
+    BlockLoader loader;
+    uint16_t depth;
+    uint64_t maxBytes;
+    // raw size of the requested blocks.
+    uint64_t bytes;
+
+    std::mutex queueLock;
+    std::condition_variable queueChanged;
+    // requested blocks, in the order they are loaded.
+    std::deque<PendingBlock> blocks;
+    // true while the worker loads a block outside of the lock.
+    bool loading;
+    bool stopped;
+    std::thread worker;
+};
+
+}
+}
+
+#endif /* INCLUDE_DATA_CONSTRUCTS_RFILE_META_BLOCKREADAHEAD_H_ */
@@ -0,0 +1,93 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDE_DATA_CONSTRUCTS_RFILE_META_INDEXBLOCKCACHE_H_
+#define INCLUDE_DATA_CONSTRUCTS_RFILE_META_INDEXBLOCKCACHE_H_
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "IndexBlock.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Parsed index blocks of a single RFile, keyed by the offset of the
+ * IndexEntry that refers to them. Parsed blocks are immutable, therefore
+ * they are shared by every locality group reader of the file.
+ */
+class IndexBlockCache
+{
+public:
+    IndexBlockCache ()
+    {
+
+    }
+
+    /**
+     Retrieves a parsed index block.
+     @param offset offset of the index block within the file
+     @return index block or null if it has not been loaded.
+     **/
+    std::shared_ptr<IndexBlock>
+    get (uint64_t offset)
+    {
+        std::lock_guard<std::mutex> lock (cacheLock);
+        auto it = blocks.find (offset);
+        if (it == blocks.end ())
+            return nullptr;
+        return it->second;
+    }
+
+    /**
+     Caches a parsed index block. If another reader loaded the same
+     block first, its block is kept and returned so that every reader
+     shares a single copy.
+     @param offset offset of the index block within the file
+     @param block parsed index block
+     @return cached index block.
+     **/
+    std::shared_ptr<IndexBlock>
+    put (uint64_t offset, std::shared_ptr<IndexBlock> block)
+    {
+        std::lock_guard<std::mutex> lock (cacheLock);
+        return blocks.insert (std::make_pair (offset, block)).first->second;
+    }
+
+    size_t
+    size ()
+    {
+        std::lock_guard<std::mutex> lock (cacheLock);
+        return blocks.size ();
+    }
+
+    void
+    clear ()
+    {
+        std::lock_guard<std::mutex> lock (cacheLock);
+        blocks.clear ();
+    }
+
+protected:
+    std::mutex cacheLock;
+    std::unordered_map<uint64_t, std::shared_ptr<IndexBlock>> blocks;
+};
+
+}
+}
+
+#endif /* INCLUDE_DATA_CONSTRUCTS_RFILE_META_INDEXBLOCKCACHE_H_ */
@@ -30,6 +30,18 @@ public:
 
     IndexEntry (std::shared_ptr<cclient::data::streams::StreamInterface> mKey, uint32_t entryCount);
 
+    /**
+     Constructs an entry of a multi-level index, which records the
+     region of the block it refers to.
+     @param mKey last key of the block
+     @param entryCount number of entries in the block
+     @param offset offset of the block
+     @param compressedSize compressed size of the block
+     @param rawSize raw size of the block
+     **/
+    IndexEntry (std::shared_ptr<cclient::data::streams::StreamInterface> mKey, uint32_t entryCount,
+                uint64_t offset, uint64_t compressedSize, uint64_t rawSize);
+
     virtual
     ~IndexEntry ();
     
@@ -42,6 +54,9 @@ public:
         key = std::make_shared<cclient::data::Key>(std::static_pointer_cast<cclient::data::Key>(other.key));
         entries = other.entries;
         newFormat = other.newFormat;
+        offset = other.offset;
+        compressedSize = other.compressedSize;
+        rawSize = other.rawSize;
     }
 
     IndexEntry () :
@@ -80,24 +95,16 @@ public:
     uint64_t
     read (cclient::data::streams::InputStream * in)
     {
-        key = std::make_shared<Key> ();
-        key->read (in);
-        entries = in->readInt ();
-
-        if (newFormat)
-        {
-            offset = in->readEncodedLong ();
-            compressedSize = in->readEncodedLong ();
-            rawSize = in->readEncodedLong ();
-        }
-        else
-        {
-            offset = -1;
-            compressedSize = -1;
-            rawSize = -1;
-        }
+        return readEntry (in);
+    }
 
-        return in->getPos ();
+    /**
+     Reads the index entry from a decompressed index block.
+     **/
+    uint64_t
+    read (cclient::data::streams::BufferedReader * in)
+    {
+        return readEntry (in);
     }
 
     /**
@@ -110,7 +117,14 @@ public:
     {
 
         key->write (outStream);
-        return outStream->writeInt (entries);
+        uint64_t pos = outStream->writeInt (entries);
+        if (newFormat)
+        {
+            outStream->writeVLong (offset);
+            outStream->writeVLong (compressedSize);
+            pos = outStream->writeVLong (rawSize);
+        }
+        return pos;
 
     }
 
@@ -121,6 +135,9 @@ public:
         key = other.key;
         entries = other.entries;
         newFormat = other.newFormat;
+        offset = other.offset;
+        compressedSize = other.compressedSize;
+        rawSize = other.rawSize;
         return *this;
     }
     
@@ -132,6 +149,9 @@ public:
         key = other.key;
         entries = other.entries;
         newFormat = other.newFormat;
+        offset = other.offset;
+        compressedSize = other.compressedSize;
+        rawSize = other.rawSize;
         return *this;
     }
 
@@ -147,6 +167,20 @@ public:
         return true;
     }
 
+    /**
+     Sets the region of the block this entry refers to.
+     @param off offset of the block
+     @param csize compressed size of the block
+     @param rsize raw size of the block
+     **/
+    void
+    setRegion (uint64_t off, uint64_t csize, uint64_t rsize)
+    {
+        offset = off;
+        compressedSize = csize;
+        rawSize = rsize;
+    }
+
     uint64_t
     getOffset ()
     {
@@ -166,6 +200,32 @@ public:
     }
 
 protected:
+
+    template<typename Reader>
+    uint64_t
+    readEntry (Reader * in)
+    {
+        std::shared_ptr<Key> entryKey = std::make_shared<Key> ();
+        entryKey->read (in);
+        key = entryKey;
+        entries = in->readInt ();
+
+        if (newFormat)
+        {
+            offset = in->readEncodedLong ();
+            compressedSize = in->readEncodedLong ();
+            rawSize = in->readEncodedLong ();
+        }
+        else
+        {
+            offset = -1;
+            compressedSize = -1;
+            rawSize = -1;
+        }
+
+        return in->getPos ();
+    }
+
    
 
    
@@ -26,6 +26,8 @@
 #include "IndexBlock.h"
 #include "BlockLookup.h"
 #include "Block.h"
+#include "IndexBlockCache.h"
+#include "../bcfile/BlockRegion.h"
 #include "../../Key.h"
 namespace cclient
 {
@@ -60,42 +62,80 @@ public:
         return size;
     }
 
+    /**
+     Returns the top level of the index.
+     **/
     std::shared_ptr<IndexBlock>
-    getIndexBlock (std::shared_ptr<IndexEntry > ie)
+    getRootIndexBlock ()
     {
+        return indexBlock;
+    }
 
-        blockReader->seek (ie->getOffset ());
-
-        uint8_t *compressedValue = new uint8_t[ie->getCompressedSize ()];
-
-        blockReader->readBytes (compressedValue, ie->getCompressedSize ());
-
-        compressorRef->setInput ((const char*) compressedValue, 0,
-                                 ie->getCompressedSize ());
+    /**
+     Sets the cache through which index blocks are read.
+     @param cache block cache, may be null.
+     @param fileId identifier of the file containing the index.
+     **/
+    void
+    setBlockCache (BlockCache *cache, uint64_t fileId)
+    {
+        blockCache = cache;
+        fileIdentifier = fileId;
+    }
 
-        cclient::data::streams::ByteOutputStream *outStream = new cclient::data::streams::ByteOutputStream (ie->getRawSize ());
+    /**
+     Sets the cache of parsed index blocks, which may be shared by
+     every index manager of the file.
+     @param cache index block cache, may be null.
+     **/
+    void
+    setIndexBlockCache (std::shared_ptr<IndexBlockCache> cache)
+    {
+        indexBlockCache = cache;
+    }
 
-        compressorRef->decompress (outStream);
+    std::shared_ptr<IndexBlock>
+    getIndexBlock (std::shared_ptr<IndexEntry > ie)
+    {
+        if (NULL != indexBlockCache)
+        {
+            std::shared_ptr<IndexBlock> block = indexBlockCache->get (
+                    ie->getOffset ());
+            if (NULL != block)
+                return block;
+            return indexBlockCache->put (ie->getOffset (), readIndexBlock (ie));
+        }
+        return readIndexBlock (ie);
+    }
+protected:
 
-        cclient::data::streams::EndianInputStream *returnStream = new cclient::data::streams::EndianInputStream (
-            outStream->getByteArray (), outStream->getSize (), true);
+    std::shared_ptr<IndexBlock>
+    readIndexBlock (std::shared_ptr<IndexEntry > ie)
+    {
+        // index blocks may be loaded by several readers at once, so
+        // don't share a compressor between them
+        BlockRegion region (ie->getOffset (), ie->getCompressedSize (),
+                            ie->getRawSize (), compressorRef->newInstance ());
+        std::shared_ptr<DecompressedBlock> data = region.readDataBlock (
+                    blockReader, blockCache, fileIdentifier);
 
-        delete outStream;
+        CachedBlockInputStream returnStream (data);
 
         std::shared_ptr<IndexBlock> block = std::make_shared<IndexBlock> (version);
-        block->read (returnStream);
-
-        delete returnStream;
+        block->read (&returnStream);
 
         return block;
 
     }
-protected:
+
     int size = 0;
     int version;
     cclient::data::streams::InputStream *blockReader;
     cclient::data::compression::Compressor *compressorRef;
     std::shared_ptr<IndexBlock> indexBlock;
+    BlockCache *blockCache;
+    uint64_t fileIdentifier;
+    std::shared_ptr<IndexBlockCache> indexBlockCache;
 
 };
 
@@ -0,0 +1,154 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDE_DATA_CONSTRUCTS_RFILE_META_INDEXWRITER_H_
+#define INCLUDE_DATA_CONSTRUCTS_RFILE_META_INDEXWRITER_H_
+
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include "../../../streaming/DataOutputStream.h"
+#include "../bcfile/BlockRegion.h"
+#include "../../Key.h"
+#include "IndexEntry.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Builds the multi-level index of a locality group, as read by
+ * IndexManager for version 7 files. Entries are added to the lowest
+ * level; a level that grows beyond the maximum block size is written
+ * to the file as an index block, which is then added to the level
+ * above it. Only the root level is written with the locality group,
+ * so the index held in memory is bounded by the maximum block size
+ * for each level.
+ */
+class IndexWriter
+{
+public:
+
+    /**
+     Writes a serialized index block to the file, setting the region at
+     which it was written.
+     **/
+    typedef std::function<void (const char *, size_t, BlockRegion *)> BlockWriter;
+
+    /**
+     Completes the regions of the data blocks added to the index.
+     **/
+    typedef std::function<void ()> RegionSync;
+
+    /**
+     Constructor
+     @param writer function writing index blocks
+     @param sync function called before the regions of data blocks are read
+     @param maxBlockSize size beyond which a level is written as a block
+     **/
+    IndexWriter (BlockWriter writer, RegionSync sync, uint32_t maxBlockSize);
+
+    /**
+     Adds a data block to the index.
+     @param key last key of the block
+     @param entries number of entries in the block
+     @param region region of the block. It is read when the entry is
+     written, and must remain valid until then.
+     **/
+    void
+    add (std::shared_ptr<Key> key, uint32_t entries, BlockRegion *region);
+
+    /**
+     Writes every level below the root. No entries may be added
+     afterward.
+     **/
+    void
+    close ();
+
+    /**
+     Closes the index, then writes the number of entries and the root
+     level.
+     @param out output stream
+     @return position of the output stream.
+     **/
+    uint64_t
+    write (cclient::data::streams::DataOutputStream *out);
+
+    /**
+     Returns the number of data blocks in the index.
+     **/
+    uint32_t
+    getSize ()
+    {
+        return totalAdded + (NULL != pendingEntry ? 1 : 0);
+    }
+
+    /**
+     Returns the number of levels of the index.
+     **/
+    uint32_t
+    getLevels ()
+    {
+        return levels.size ();
+    }
+
+protected:
+
+    struct Level
+    {
+        Level (int level, int offset) :
+            level (level), offset (offset), size (0)
+        {
+        }
+
+        int level;
+        // number of data blocks preceding this block.
+        int offset;
+        std::vector<std::shared_ptr<IndexEntry>> entries;
+        // regions of data blocks, or NULL for index blocks.
+        std::vector<BlockRegion*> regions;
+        // upper bound of the serialized size.
+        size_t size;
+    };
+
+    void
+    add (size_t level, std::shared_ptr<IndexEntry> entry, BlockRegion *region);
+
+    void
+    flush (size_t level, bool last);
+
+    /**
+     Writes a level in the format of IndexBlock.
+     **/
+    uint64_t
+    writeBlock (Level &block, bool hasNext,
+                cclient::data::streams::DataOutputStream *out);
+
+    BlockWriter writer;
+    RegionSync sync;
+    uint32_t maxBlockSize;
+    std::vector<Level> levels;
+    // number of data blocks added to the lowest level.
+    uint32_t totalAdded;
+    bool closed;
+    // the most recently added data block.
+    std::shared_ptr<IndexEntry> pendingEntry;
+    BlockRegion *pendingRegion;
+};
+
+}
+}
+
+#endif /* INCLUDE_DATA_CONSTRUCTS_RFILE_META_INDEXWRITER_H_ */
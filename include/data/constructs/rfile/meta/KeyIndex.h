@@ -18,6 +18,7 @@
 #include "../../../streaming/input/InputStream.h"
 #include "../../../streaming/input/ByteInputStream.h"
 #include "../../../streaming/input/NetworkOrderInputStream.h"
+#include "../../../streaming/input/BufferedReader.h"
 #include "../../../streaming/Streams.h"
 #include "IndexEntry.h"
 
@@ -53,58 +54,73 @@ public:
     std::shared_ptr<Key>
     get (uint64_t index)
     {
-        uint64_t len = 0;
-        if (index == offsets->size () - 1)
-        {
-            len = dataLength - offsets->at (index);
-        }
-        else
-        {
-            len = offsets->at (index + 1) - offsets->at (index);
-        }
         std::shared_ptr<Key> returnKey = std::make_shared<Key> ();
 
-        cclient::data::streams::EndianInputStream *inputStream = new cclient::data::streams::EndianInputStream (
-            (char*) data + offsets->at (index), len);
-        returnKey->read (inputStream);
-        delete inputStream;
+        cclient::data::streams::BufferedReader reader (
+            (const char*) data + offsets->at (index), length (index));
+        returnKey->read (&reader);
 
         return returnKey;
     }
 
-    int
-    binary_search (std::shared_ptr<Key> search_key)
+    size_t
+    size ()
     {
-        return binary_search (0, offsets->size () - 1, search_key);
+        return offsets->size ();
     }
 
+    /**
+     Compares the search key against the key at index without
+     materializing the latter.
+     @param index index of the serialized key
+     @param search_key key to compare
+     @return negative, zero or positive if the search key sorts before,
+     with or after the key at index.
+     **/
     int
-    binary_search (int first, int last, std::shared_ptr<Key> search_key)
+    compare (uint64_t index, const Key &search_key)
     {
-        int index;
-
-        if (first > last)
-            index = -1;
+        return search_key.compareSerialized (data + offsets->at (index),
+                                             length (index));
+    }
 
-        else
+    /**
+     Binary search over the serialized keys.
+     @param search_key key for which we are searching
+     @return index of the search key if it is found, otherwise
+     -(insertion point) - 1, where the insertion point is the index of the
+     first key greater than the search key.
+     **/
+    int
+    binary_search (std::shared_ptr<Key> search_key)
+    {
+        int low = 0;
+        int high = offsets->size () - 1;
+        while (low <= high)
         {
-            int mid = (first + last) / 2;
-
-            std::shared_ptr<Key> midKey = get (mid);
-            if (*search_key == *midKey)
-                index = mid;
+            int mid = (low + high) >> 1;
+            int cmp = compare (mid, *search_key);
+            if (cmp > 0)
+                low = mid + 1;
+            else if (cmp < 0)
+                high = mid - 1;
             else
+                return mid;
+        }
+        return -(low + 1);
+    }
 
-                if (*search_key < *midKey)
-                    index = binary_search (first, mid - 1, search_key);
-                else
-                    index = binary_search (mid + 1, last, search_key);
+protected:
 
-        } // end if
-        return index;
-    } // end binarySearch
+    // length of the serialized key at index, bounded by the next key
+    uint64_t
+    length (uint64_t index)
+    {
+        if (index == offsets->size () - 1)
+            return dataLength - offsets->at (index);
+        return offsets->at (index + 1) - offsets->at (index);
+    }
 
-protected:
     int currentValue = 0;
     std::vector<int> *offsets;
     uint8_t *data;
@@ -0,0 +1,151 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDE_DATA_CONSTRUCTS_RFILE_META_LOCALITYGROUPMERGER_H_
+#define INCLUDE_DATA_CONSTRUCTS_RFILE_META_LOCALITYGROUPMERGER_H_
+
+#include <vector>
+#include <algorithm>
+
+#include "LocalityGroupReader.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Merges locality group readers in key order. The reader holding the
+ * smallest key is kept outside of the heap, so that when a single group
+ * remains, entries are returned without consulting the heap.
+ */
+class LocalityGroupMerger
+{
+public:
+    LocalityGroupMerger () :
+        current (NULL)
+    {
+
+    }
+
+    /**
+     Removes all readers.
+     **/
+    void
+    clear ()
+    {
+        heap.clear ();
+        current = NULL;
+    }
+
+    /**
+     Adds a seeked reader. Readers without a top key are ignored.
+     @param reader locality group reader
+     **/
+    void
+    addReader (LocalityGroupReader *reader)
+    {
+        if (!reader->hasTop ())
+            return;
+        if (NULL == current)
+        {
+            current = reader;
+            return;
+        }
+        if (reader->getTopKey ()->compare (*current->getTopKey ()) < 0)
+            std::swap (reader, current);
+        heap.push_back (reader);
+        std::push_heap (heap.begin (), heap.end (), TopKeyGreater ());
+    }
+
+    bool
+    hasTop ()
+    {
+        return NULL != current;
+    }
+
+    /**
+     Returns whether entries are read from a single reader, in which
+     case they needn't be merged.
+     **/
+    bool
+    isSingleReader ()
+    {
+        return heap.empty ();
+    }
+
+    /**
+     Returns the reader positioned at the smallest key.
+     @return reader, or null if every reader is exhausted.
+     **/
+    LocalityGroupReader *
+    getCurrent ()
+    {
+        return current;
+    }
+
+    /**
+     Advances the current reader and selects the reader with the
+     next smallest key.
+     **/
+    void
+    next ()
+    {
+        current->next ();
+        if (!current->hasTop ())
+        {
+            current = pop ();
+            return;
+        }
+
+        if (!heap.empty ()
+                && heap.front ()->getTopKey ()->compare (*current->getTopKey ()) < 0)
+        {
+            LocalityGroupReader *previous = current;
+            current = pop ();
+            heap.push_back (previous);
+            std::push_heap (heap.begin (), heap.end (), TopKeyGreater ());
+        }
+    }
+
+protected:
+
+    // orders the heap so that the smallest top key is at the front.
+    struct TopKeyGreater
+    {
+        bool
+        operator() (LocalityGroupReader *lhs, LocalityGroupReader *rhs) const
+        {
+            return lhs->getTopKey ()->compare (*rhs->getTopKey ()) > 0;
+        }
+    };
+
+    LocalityGroupReader *
+    pop ()
+    {
+        if (heap.empty ())
+            return NULL;
+        std::pop_heap (heap.begin (), heap.end (), TopKeyGreater ());
+        LocalityGroupReader *reader = heap.back ();
+        heap.pop_back ();
+        return reader;
+    }
+
+    std::vector<LocalityGroupReader*> heap;
+    LocalityGroupReader *current;
+};
+
+}
+}
+
+#endif /* INCLUDE_DATA_CONSTRUCTS_RFILE_META_LOCALITYGROUPMERGER_H_ */
@@ -17,6 +17,7 @@
 
 
 #include <map>
+#include <string>
 
 #include <vector>
 #include <stdexcept>
@@ -30,6 +31,7 @@
 
 #include "IndexManager.h"
 #include "IndexEntry.h"
+#include "IndexWriter.h"
 
 namespace cclient
 {
@@ -47,9 +49,12 @@ public:
      Constructor
      @param starBlockVal start block value
      @param name The name of the locality group.
+     @param indexWriter writer of the group's index, of which we take
+     ownership.
 
      **/
-    LocalityGroupMetaData (uint32_t startBlockVal, std::string name = "");
+    LocalityGroupMetaData (uint32_t startBlockVal, std::string name,
+                           IndexWriter *indexWriter);
 
     LocalityGroupMetaData (cclient::data::compression::Compressor *compressorRef, int version,
                            cclient::data::streams::InputStream *reader);
@@ -95,24 +100,44 @@ public:
     write (cclient::data::streams::DataOutputStream *outStream);
 
     /**
-     Add the index entry to the meta data.
-     @param ind incoming index entry.
+     Adds a data block to the index of this group.
+     @param key last key of the block.
+     @param entries number of entries in the block.
+     @param region region of the block, which may be completed later.
      **/
     void
-    addIndexEntry (IndexEntry ind)
+    addIndexEntry (std::shared_ptr<Key> key, uint32_t entries, BlockRegion *region)
     {
-        index.push_back (std::move(ind));
+        indexWriter->add (key, entries, region);
     }
 
+    /**
+     Writes the index blocks below the root of the index. Called once
+     every data block of the group has been added.
+     **/
+    void
+    closeIndex ()
+    {
+        indexWriter->close ();
+    }
+
+    /**
+     Counts an entry of a column family written to this group.
+     @param cf column family
+     @param len length of the column family
+     **/
+    void
+    addColumnFamily (const char *cf, size_t len);
+
     LocalityGroupMetaData &
     operator= (const LocalityGroupMetaData &other)
     {
         startBlock = other.startBlock;
         firstKey = other.firstKey;
-        offsets.insert (offsets.end (), other.offsets.begin (),
-                        other.offsets.end ());
 
         columnFamilies = other.columnFamilies;
+        columnFamiliesKnown = other.columnFamiliesKnown;
+        lastFamily = columnFamilies.end ();
 
         return *this;
     }
@@ -130,51 +155,54 @@ public:
         return indexManager;
     }
 
-protected:
+    bool
+    isDefaultLocalityGroup ()
+    {
+        return isDefaultLG;
+    }
+
+    std::string
+    getName ()
+    {
+        return name;
+    }
 
     /**
-     Build the index array of IndexEntry objects.
-     @return std pair containing the array and the size
-     of this array. note that this array is allocated within
-     this function, therefore, the memory must be freed
-     in the calling function.
+     Returns whether the column families of this group are known. They
+     are not recorded for a default locality group. An empty list is
+     treated as unknown, as it may have been written by a writer that
+     did not record the group's families.
+     @return true if getColumnFamilies lists the group's column families.
      **/
-    std::pair<char*, size_t>
-    buildIndexArray ()
+    bool
+    hasColumnFamilies ()
     {
-        cclient::data::streams::BigEndianByteStream *byteOutStream = new cclient::data::streams::BigEndianByteStream (
-            index.size () * 120);
-        cclient::data::streams::DataOutputStream *outputStream = new cclient::data::streams::DataOutputStream (byteOutStream);
-        //BigEndianOutStream outputStream(&byteOutStream);
-
-        uint64_t totalPos = 0;
-        uint32_t off = byteOutStream->getPos ();
-        for (std::vector<IndexEntry>::iterator it = index.begin (); it != index.end ();
-                it++)
-        {
-
-            offsets.push_back (off);
-            off = (*it).write (outputStream);
-            totalPos += off;
-        }
-
-        char *arr = new char[off];
-
-        memcpy (arr, byteOutStream->getByteArray (), off);
-        delete byteOutStream;
-        delete outputStream;
-        return std::make_pair (arr, off);
+        return columnFamiliesKnown && !columnFamilies.empty ();
     }
+
+    /**
+     Returns the column families in this group, mapped to the number of
+     entries of each.
+     **/
+    const std::map<std::string, uint64_t> &
+    getColumnFamilies ()
+    {
+        return columnFamilies;
+    }
+
+protected:
     // start block of this meta data group.
     uint32_t startBlock;
     // first key in the locality group.
     std::shared_ptr<StreamInterface> firstKey;
-    // region of index entry offsets.
-    std::vector<int> offsets;
     // column families for this locality group.
-    std::map<std::pair<uint8_t *, size_t>, uint64_t> columnFamilies;
-    // index entries.
-    std::vector<IndexEntry> index;
+    std::map<std::string, uint64_t> columnFamilies;
+    // identifies whether column families were recorded for this group.
+    bool columnFamiliesKnown;
+    // family of the last entry written, as consecutive entries usually share one.
+    std::map<std::string, uint64_t>::iterator lastFamily;
+    // writes the index, when writing the group.
+    std::unique_ptr<IndexWriter> indexWriter;
 
     cclient::data::compression::Compressor *compressorRef;
 
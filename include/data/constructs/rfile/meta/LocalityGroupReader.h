@@ -17,6 +17,8 @@
 #include "../../../streaming/accumulo/StreamSeekable.h"
 #include "../../../streaming/OutputStream.h"
 #include "../../../streaming/input/InputStream.h"
+#include "../../../streaming/input/MappedInputStream.h"
+#include "../../../streaming/input/BufferedReader.h"
 #include "../../../streaming/Streams.h"
 #include "../../../streaming/StreamRelocation.h"
 #include "../../../streaming/StreamEnvironment.h"
@@ -25,13 +27,19 @@
 #include "../../../exceptions/IllegalArgumentException.h"
 #include "../../../exceptions/InterationInterruptedException.h"
 #include "IndexEntry.h"
+#include "LocalityGroupMetaData.h"
+#include "BlockReadAhead.h"
 #include <memory>
+#include <algorithm>
+#include <string>
+#include <vector>
 
 #include "../bcfile/BlockCompressedFile.h"
 // constructs
 
 #include "../../../constructs/Key.h"
 #include "../../../constructs/value.h"
+#include "../../../constructs/KeyValueBatch.h"
 #include "../../../constructs/compressor/compressor.h"
 #include "../../../constructs/Range.h"
 #include "../../../constructs/SkippedRelativeKey.h"
@@ -72,10 +80,32 @@ protected:
 
     RelativeKey *rKey;
 
+    // value of the top entry, or NULL
     Value *val;
+    Value topValue;
+
+    LocalityGroupMetaData *metadata;
+    // sorted column families from the last seek
+    std::vector<std::string> columnFamilies;
+    bool inclusive;
+    // true if entries must be checked against the column families
+    bool filterColumns;
+
+    // loads blocks ahead of the current block, if enabled.
+    BlockReadAhead *readAhead;
+    // index of the current data block.
+    uint32_t currentBlock;
+    // next block to request from the read ahead.
+    uint32_t nextPrefetch;
 
     
 
+    // decompressed block being read, and the reader decoding it.
+    std::shared_ptr<DecompressedBlock> currentBlockData;
+    cclient::data::streams::BufferedReader blockReader;
+    // the current block, as the owner of values sliced from it
+    std::shared_ptr<void> blockOwner;
+
     void
     close ()
     {
@@ -85,6 +115,9 @@ protected:
             delete currentStream;
             currentStream = NULL;
         }
+        currentBlockData = nullptr;
+        blockOwner = nullptr;
+        blockReader.reset (NULL, 0);
     }
 
 public:
@@ -94,18 +127,55 @@ public:
         bcFile (bcFile), reader (input_stream), version (version), closed (
             false), checkRange (false), topExists (false), currentStream (
                 NULL), interrupted (false), currentRange (NULL), iiter (NULL), prevKey (
-                    NULL), entriesLeft (-1)
+                    NULL), entriesLeft (-1), metadata (metadata), inclusive (
+                        false), filterColumns (false), readAhead (NULL), currentBlock (
+                        0), nextPrefetch (0)
     {
         index = metadata->getIndexManager ();
         firstKey = std::dynamic_pointer_cast<Key> (metadata->getFirstKey ());
         startBlock = metadata->getStartBlock ();
         blockCount = index->getSize ();
+        index->setBlockCache (bcFile->getBlockCache (),
+                              bcFile->getFileIdentifier ());
         rKey = NULL;
     }
 
     virtual
     ~LocalityGroupReader ()
     {
+        // stop the worker before the state it reads is destroyed
+        if (NULL != readAhead)
+            delete readAhead;
+        close ();
+    }
+
+    /**
+     Enables reading ahead, in which the blocks following the current
+     block are read and decompressed on a background thread. Blocks are
+     only read ahead from memory mapped files, as other streams cannot
+     be read concurrently.
+     @param depth maximum number of blocks read ahead, zero disables
+     reading ahead.
+     @param maxBytes maximum decompressed size of the blocks read ahead.
+     @return true if reading ahead is enabled.
+     **/
+    bool
+    setReadAhead (uint16_t depth, uint64_t maxBytes)
+    {
+        if (NULL != readAhead)
+        {
+            delete readAhead;
+            readAhead = NULL;
+        }
+        if (depth == 0
+                || NULL == dynamic_cast<cclient::data::streams::MappedInputStream*> (reader))
+            return false;
+        readAhead = new BlockReadAhead ([this] (uint32_t block)
+        {
+            return loadDataBlock (block);
+        }, depth, maxBytes);
+        nextPrefetch = 0;
+        return true;
     }
 
     std::shared_ptr<Key>
@@ -120,12 +190,34 @@ public:
         return iiter->get (iiter->size () - 1)->getKey ();
     }
 
+    /**
+     Returns the top key, which is overwritten as the reader advances.
+     **/
     std::shared_ptr<Key>
     getTopKey ()
     {
         return rKey->getKey();
     }
 
+    /**
+     Returns a copy of the top key, which the caller may retain.
+     **/
+    std::shared_ptr<Key>
+    copyTopKey ()
+    {
+        return rKey->copyKey ();
+    }
+
+    /**
+     Returns the value of the top entry, which remains owned by
+     this reader.
+     **/
+    Value *
+    getTopValue ()
+    {
+        return val;
+    }
+
     bool
     hasTop ()
     {
@@ -142,12 +234,10 @@ public:
             throw cclient::exceptions::IllegalArgumentException ("Locality group reader closed");
         }
 
-        if (newSeekRequest->getColumnFamilies ()->size () > 0
-                || newSeekRequest->isInclusive ())
-        {
-            throw std::runtime_error (
-                "I do not know how to filter column families");
-        }
+        columnFamilies = *newSeekRequest->getColumnFamilies ();
+        std::sort (columnFamilies.begin (), columnFamilies.end ());
+        inclusive = newSeekRequest->isInclusive ();
+        filterColumns = requiresColumnFilter ();
 
         if (interrupted)
         {
@@ -156,6 +246,12 @@ public:
 
         currentRange = newSeekRequest->getRange ();
 
+        if (NULL != readAhead)
+        {
+            readAhead->cancel ();
+            nextPrefetch = 0;
+        }
+
         checkRange = true;
 
         if (blockCount == 0)
@@ -177,10 +273,12 @@ public:
 
         bool reseek = true;
 
-        if (currentRange->getStopKey () != NULL && firstKey > currentRange->getStopKey ())
+        if (NULL != firstKey && afterStopKey (firstKey))
         {
             // range is before the first key;
             reseek = false;
+            close ();
+            rKey = NULL;
         }
 
         if (rKey != NULL)
@@ -198,13 +296,15 @@ public:
             iiter = index->lookup (startKey);
 
             close ();
+            rKey = NULL;
 
             if (!iiter->isEnd ())
             {
                 while (iiter->hasPrevious ())
                 {	
 		    std::shared_ptr<IndexEntry> ent = *(*iiter);
-		    if (*(iiter->getPrevious()) == *ent)
+		    // back up over blocks ending with the same key
+		    if (*(iiter->getPrevious()->getKey()) == *(ent->getKey()))
 		      iiter->previous ();
 		    else
 		      break;
@@ -220,30 +320,19 @@ public:
 
                 std::shared_ptr<IndexEntry> indexEntry = iiter->get ();
                 entriesLeft = indexEntry->getNumEntries ();
+                // keys within the block need only be checked against the
+                // stop key if the block extends beyond it
+                checkRange = afterStopKey (indexEntry->getKey ());
 
-                if (version == 3 || version == 4)
-                {
-                    currentStream = getDataBlock (
-                                        startBlock + iiter->getPreviousIndex ());
-                }
-                else
-                {
-                    currentStream = getDataBlock (
-                                        startBlock + iiter->getPreviousIndex ());
-                }
-                checkRange = newSeekRequest->getRange ()->getStopKey ()
-                             > indexEntry->getKey ();
-                if (!checkRange)
-                    topExists = true;
-
+                openDataBlock (startBlock + iiter->getPreviousIndex ());
                 // don't concern outselves with block indexing
 
-                std::vector<char> valueArray;
+                std::pair<const char*, uint32_t> topValueSpan (NULL, 0);
 
                 std::shared_ptr<Key>  currKey = 0;
 
                 SkippedRelativeKey * skipRR = new SkippedRelativeKey (
-                    currentStream, startKey, &valueArray, prevKey, currKey);
+                    &blockReader, startKey, &topValueSpan, prevKey, currKey);
 
                 if (skipRR->getPrevKey () != NULL)
                 {
@@ -252,51 +341,183 @@ public:
                 else
                     prevKey = NULL;
                 entriesLeft -= skipRR->getSkipped ();
-                val = new Value ();
-                val->setValue ((uint8_t*) valueArray.data (),
-                               valueArray.size (), 0);
+                val = &topValue;
+                if (topValueSpan.second >= Value::SLICE_THRESHOLD)
+                    val->setSlice (blockOwner,
+                                   (const uint8_t*) topValueSpan.first,
+                                   topValueSpan.second);
+                else
+                    val->setValue ((uint8_t*) topValueSpan.first,
+                                   topValueSpan.second, 0);
                 rKey = skipRR->getRelativeKey ();
                 delete skipRR;
 
             }
         }
 
-        topExists = (rKey != NULL
-                    && currentRange->getInfiniteStopKey()) || !(currentRange->getStopKey () > rKey->getStream ());
-        while (hasTop () && !currentRange->getInfiniteStartKey() && currentRange->getStartKey () < getTopKey ())
+        topExists = rKey != NULL && !afterStopKey (getTopKey ());
+        while (hasTop () && beforeStartKey (getTopKey ()))
         {
-            next ();
+            nextEntry ();
         }
+        skipFilteredColumns ();
+    }
+
+    /**
+     Returns whether the key sorts before the start of the current range.
+     **/
+    bool
+    beforeStartKey (std::shared_ptr<Key> key)
+    {
+        if (currentRange->getInfiniteStartKey ())
+            return false;
+        int cmp = key->compare (*currentRange->getStartKey ());
+        return currentRange->getStartKeyInclusive () ? cmp < 0 : cmp <= 0;
+    }
+
+    /**
+     Returns whether the key sorts after the end of the current range.
+     **/
+    bool
+    afterStopKey (std::shared_ptr<Key> key)
+    {
+        if (currentRange->getInfiniteStopKey ())
+            return false;
+        int cmp = key->compare (*currentRange->getStopKey ());
+        return currentRange->getStopKeyInclusive () ? cmp > 0 : cmp >= 0;
+    }
+
+    /**
+     Returns whether a key's column family may be returned by
+     the last seek.
+     @param key key to check
+     @return true if the key's column family is accepted.
+     **/
+    bool
+    acceptColumnFamily (std::shared_ptr<Key> key)
+    {
+        return acceptColumnFamily (key->getColFamily ());
+    }
+
+    bool
+    acceptColumnFamily (const std::pair<char*, size_t> &cf)
+    {
+        bool found = std::binary_search (columnFamilies.begin (),
+                                         columnFamilies.end (), cf, ColumnFamilyLess ());
+        return found == inclusive;
     }
 
     virtual void
     next ()
+    {
+        nextEntry ();
+        skipFilteredColumns ();
+    }
+
+    /**
+     Appends entries to a batch, beginning with the top entry and
+     advancing past each appended entry.
+     @param batch batch to which entries are appended
+     @param n maximum number of entries to append
+     @return number of entries appended.
+     **/
+    size_t
+    nextBatch (KeyValueBatch *batch, size_t n)
+    {
+        size_t count = 0;
+        while (count < n && hasTop ())
+        {
+            batch->append (rKey->getRow (), rKey->getColFamily (),
+                           rKey->getColQualifier (), rKey->getColVisibility (),
+                           rKey->getTimeStamp (), rKey->isDeleted (), val);
+            next ();
+            count++;
+        }
+        return count;
+    }
+
+protected:
+
+    /**
+     Orders column families against the byte ranges held by keys,
+     without copying the latter.
+     **/
+    struct ColumnFamilyLess
+    {
+        bool
+        operator() (const std::string &lhs,
+                    const std::pair<char*, size_t> &rhs) const
+        {
+            return compare (lhs.data (), lhs.size (), rhs.first, rhs.second) < 0;
+        }
+
+        bool
+        operator() (const std::pair<char*, size_t> &lhs,
+                    const std::string &rhs) const
+        {
+            return compare (lhs.first, lhs.second, rhs.data (), rhs.size ()) < 0;
+        }
+
+        static int
+        compare (const char *b1, size_t l1, const char *b2, size_t l2)
+        {
+            return ByteCompare::compare (b1, l1, b2, l2);
+        }
+    };
+
+    /**
+     Determines whether entries of this group must be checked against
+     the column families of the last seek. Groups whose recorded column
+     families all match need no per entry filtering.
+     **/
+    bool
+    requiresColumnFilter ()
+    {
+        if (!inclusive && columnFamilies.empty ())
+            return false;
+        if (NULL == metadata || !metadata->hasColumnFamilies ())
+            return true;
+        for (auto cf : metadata->getColumnFamilies ())
+        {
+            bool found = std::binary_search (columnFamilies.begin (),
+                                             columnFamilies.end (), cf.first);
+            if (found != inclusive)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     Advances past entries whose column family is filtered.
+     **/
+    void
+    skipFilteredColumns ()
+    {
+        if (!filterColumns)
+            return;
+        while (hasTop () && !acceptColumnFamily (rKey->getColFamily ()))
+        {
+            nextEntry ();
+        }
+    }
+
+    void
+    nextEntry ()
     {
 
         if (!hasTop ())
             throw std::runtime_error ("Illegal State Exception");
         if (entriesLeft == 0)
         {
-            currentStream->close ();
+            close ();
 
             if (iiter->hasNext ())
             {
                 (*iiter)++;
                 std::shared_ptr<IndexEntry> indexEntry = iiter->get ();
                 entriesLeft = indexEntry->getNumEntries ();
-                if (version == 3 || version == 4)
-                {
-                    currentStream = getDataBlock (
-                                        startBlock + iiter->getPreviousIndex ());
-                }
-                else
-                {
-                    currentStream = getDataBlock (
-                                        startBlock + iiter->getPreviousIndex ());
-                }
-                checkRange = currentRange->getStopKey () > indexEntry->getKey ();
-                if (!checkRange)
-                    topExists = true;
+                checkRange = afterStopKey (indexEntry->getKey ());
+                openDataBlock (startBlock + iiter->getPreviousIndex ());
             }
 
             else
@@ -307,37 +528,105 @@ public:
                 return;
             }
         }
-        prevKey = std::static_pointer_cast<Key>(rKey->getStream());
-        rKey->read(currentStream);
-        val->read(currentStream);
+        rKey->read(&blockReader);
+        // large values refer to the block rather than being copied
+        val->read(&blockReader, blockOwner);
         entriesLeft--;
+        if (checkRange && afterStopKey (getTopKey ()))
+            topExists = false;
 
     }
 
-    cclient::data::streams::InputStream *
-    getDataBlock (uint32_t index)
+    /**
+     Requests the blocks following the current block from the read
+     ahead. Nothing is requested once the range ends within the current
+     block.
+     **/
+    void
+    prefetchBlocks ()
     {
+        if (checkRange)
+            return;
+        uint32_t lastBlock = startBlock + blockCount;
+        if (nextPrefetch <= currentBlock)
+            nextPrefetch = currentBlock + 1;
+        while (nextPrefetch < lastBlock)
+        {
+            BlockRegion *region = bcFile->getDataIndex ()->getBlockRegion (
+                                      nextPrefetch);
+            if (!readAhead->prefetch (nextPrefetch, region->getRawSize ()))
+                break;
+            nextPrefetch++;
+        }
+    }
 
-
+    /**
+     Reads and decompresses a block. This may be called from the
+     read ahead's thread.
+     @param index index of the block within the file
+     @return decompressed block.
+     **/
+    std::shared_ptr<DecompressedBlock>
+    loadDataBlock (uint32_t index)
+    {
+        // the region is owned by the data index
         BlockRegion *region = bcFile->getDataIndex ()->getBlockRegion (index);
-        region->setCompressor(bcFile->getDataIndex ()->getCompressionAlgorithm ().create() );
-        cclient::data::streams::InputStream *stream = region->readDataStream (reader);
-        delete region;
-        return stream;
+        uint64_t offset = region->getOffset ();
+        BlockCache *cache = bcFile->getBlockCache ();
+        uint64_t fileId = bcFile->getFileIdentifier ();
+        if (NULL != cache)
+        {
+            // avoid creating a compressor when the block is resident
+            std::shared_ptr<DecompressedBlock> block = cache->get (fileId,
+                    offset);
+            if (NULL != block)
+                return block;
+        }
+        cclient::data::compression::Compressor *compressor =
+            bcFile->getDataIndex ()->getCompressionAlgorithm ().create ();
+        BlockRegion blockRegion (offset, region->getCompressedSize (),
+                                 region->getRawSize (), compressor);
+        std::shared_ptr<DecompressedBlock> block = blockRegion.readDataBlock (
+                    reader);
+        if (NULL != cache)
+            cache->put (fileId, offset, block);
+        return block;
     }
 
+public:
+
     cclient::data::streams::InputStream *
-    getDataBlock (uint64_t offset, uint64_t compressedSize, uint64_t rawSize)
+    getDataBlock (uint32_t index)
     {
+        return new CachedBlockInputStream (fetchDataBlock (index));
+    }
 
-//
-        cclient::data::compression::Compressor *compressor =
-            bcFile->getDataIndex ()->getCompressionAlgorithm ().create ();
-        BlockRegion *region = new BlockRegion (offset, compressedSize, rawSize,
-                                               compressor);
-        cclient::data::streams::InputStream *stream = region->readDataStream (reader);
-        delete region;
-        return stream;
+protected:
+
+    /**
+     Makes a block the current block, from which entries are decoded.
+     **/
+    void
+    openDataBlock (uint32_t index)
+    {
+        currentBlockData = fetchDataBlock (index);
+        blockOwner = currentBlockData;
+        blockReader.reset (currentBlockData->data (), currentBlockData->size ());
+    }
+
+    std::shared_ptr<DecompressedBlock>
+    fetchDataBlock (uint32_t index)
+    {
+        currentBlock = index;
+        if (NULL != readAhead)
+        {
+            std::shared_ptr<DecompressedBlock> block = readAhead->take (index);
+            if (NULL == block)
+                block = loadDataBlock (index);
+            prefetchBlocks ();
+            return block;
+        }
+        return loadDataBlock (index);
     }
 
 }
@@ -20,6 +20,7 @@
 #include "../../../streaming/input/InputStream.h"
 #include "../../../streaming/input/ByteInputStream.h"
 #include "../../../streaming/input/NetworkOrderInputStream.h"
+#include "../../../streaming/input/BufferedReader.h"
 #include "../../../streaming/Streams.h"
 #include "IndexEntry.h"
 #include "BaseMetaBlock.h"
@@ -109,10 +110,9 @@ public:
           }*/
         std::shared_ptr<IndexEntry> returnKey = std::make_shared<IndexEntry> (newFormat);
 
-        cclient::data::streams::EndianInputStream *inputStream = new cclient::data::streams::EndianInputStream (
-            (char*) data + offsets->at (index), len);
-        returnKey->read (inputStream);
-        delete inputStream;
+        cclient::data::streams::BufferedReader reader (
+            (const char*) data + offsets->at (index), len);
+        returnKey->read (&reader);
 
         return returnKey;
     }
@@ -144,18 +144,14 @@ public:
     SerializedIndex&
     operator++ ()
     {
-        currentPosition++;
+        next ();
         return *this;
     }
 
     SerializedIndex&
     operator++ (int t)
     {
-        for (int32_t i = 0; i < (t + 1); i++)
-        {
-            currentPosition++;
-        }
-
+        next ();
         return *this;
     }
 
@@ -168,60 +164,95 @@ public:
             return false;
     }
 
+    /**
+     * Returns whether an entry precedes the current entry, which may be
+     * in an earlier leaf of the index.
+     */
     bool
     hasPrevious ()
     {
         if (ptr == NULL)
             return false;
-        return currentPosition > 0;
+        return currentPosition > 0 || blockParty->getOffset () > 0;
     }
 
+    /**
+     * Returns whether an entry follows the current entry, which may be
+     * in a later leaf of the index.
+     */
     bool
     hasNext ()
     {
         if (blockParty == NULL)
             return false;
-        if (!ptr->hasNext ())
-            return blockParty->hasNextKey ();
-        else
+        if (currentPosition + 1 < ptr->size ())
             return true;
+        return blockParty->hasNextKey ();
     }
 
+    /**
+     * Returns the entry preceding the current entry, without moving.
+     */
     std::shared_ptr<IndexEntry>
     getPrevious ()
     {
-	if (currentPosition == 0)
-	  return get (0);
-      else
-	  return get (currentPosition - 1);
+        if (currentPosition > 0 || !hasPrevious ())
+            return get (currentPosition == 0 ? 0 : currentPosition - 1);
+        // step into the previous leaf and back again
+        previous ();
+        std::shared_ptr<IndexEntry> entry = get ();
+        next ();
+        return entry;
     }
 
+    /**
+     * Returns the index of the current entry amongst all entries of the
+     * lowest level of the index.
+     */
     uint32_t
     getPreviousIndex ()
     {
         if (NULL == blockParty)
             return 0;
-        int offset = blockParty->getOffset ();
-        int prev = 0;
-        if (NULL != ptr )
-            prev = ptr->getPreviousIndex();
-        return offset + prev;
+        return blockParty->getOffset () + currentPosition;
     }
 
+    /**
+     * Moves to the preceding entry.
+     */
     std::shared_ptr<IndexEntry>
     previous ()
     {
         if (!ptr)
           return 0;
-        if (!ptr->hasPrevious ())
+        if (currentPosition == 0)
         {
             blockParty = blockParty->getPreviousBlock ();
-            currentPosition = blockParty->getCurrentPosition ();
             ptr = std::dynamic_pointer_cast<SerializedIndex> (blockParty->getBlock ());
+            currentPosition = blockParty->getCurrentPosition ();
         }
-        if (ptr == shared_from_this())
+        else
+            currentPosition--;
+        return get ();
+    }
+
+    /**
+     * Moves to the following entry.
+     */
+    std::shared_ptr<IndexEntry>
+    next ()
+    {
+        if (!ptr)
           return 0;
-        return ptr->previous ();
+        if (currentPosition + 1 >= ptr->size () && blockParty->hasNextKey ())
+        {
+            blockParty = blockParty->getNextBlock ();
+            ptr = std::dynamic_pointer_cast<SerializedIndex> (blockParty->getBlock ());
+            currentPosition = blockParty->getCurrentPosition ();
+        }
+        else
+            currentPosition++;
+        return isEnd () ? 0 : get ();
     }
 
     bool
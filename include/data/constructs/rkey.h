@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include "../streaming/Streams.h"
+#include "../streaming/input/BufferedReader.h"
 
 #include <stdint.h>
 #include <cstdio>
@@ -70,6 +71,11 @@ public:
      **/
     virtual uint64_t read (cclient::data::streams::InputStream *in);
 
+    /**
+     * Reads the relative key from a decompressed block.
+     **/
+    uint64_t read (cclient::data::streams::BufferedReader *in);
+
     /**
      * Sets the previous key for this relative key.
      * @param previous_key prev key.
@@ -108,59 +114,109 @@ public:
 
     static const uint8_t PREFIX_COMPRESSION_ENABLED = 128;
 
-    std::shared_ptr<Key> getKey(){
-    	return key;
+    /**
+     * Returns the current key. Keys that were read are decoded into a
+     * key owned by this relative key, which is overwritten by the next
+     * read; use copyKey to retain it.
+     **/
+    std::shared_ptr<Key>
+    getKey ();
+
+    /**
+     * Returns a copy of the current key, which the caller may retain.
+     **/
+    std::shared_ptr<Key>
+    copyKey ();
+
+    /**
+     * Views of the fields of the last key read, valid until the next read.
+     **/
+    std::pair<char*, size_t>
+    getRow ()
+    {
+        return getField (ROW_FIELD);
     }
-protected:
 
-    void readPrefix (cclient::data::streams::InputStream *stream, std::vector<char> *row, std::vector<char> *prevRow);
+    std::pair<char*, size_t>
+    getColFamily ()
+    {
+        return getField (CF_FIELD);
+    }
 
-    bool
-    readPrefix (cclient::data::streams::InputStream *stream, int *comparison, uint8_t SAME_FIELD,
-                uint8_t PREFIX, char fieldsSame,char fieldsPrefixed, std::vector<char> *field,
-                std::vector<char> *prevField)
+    std::pair<char*, size_t>
+    getColQualifier ()
     {
-        std::vector<char> tmp;
-
-        //field->swap (*prevField);
-
-        if ((fieldsSame & SAME_FIELD) != SAME_FIELD)
-        {
-            if ((fieldsPrefixed & PREFIX) == PREFIX)
-            {
-                readPrefix (stream, field, prevField);
-            }
-            else
-            {
-                read (stream, field);
-            }
-            return true;
-        }
-        else {
-            //field->resize(prevField->size());
-            field->insert(field->begin(),prevField->data (),prevField->data ()+prevField->size());
-        }
-        return false;
+        return getField (CQ_FIELD);
     }
 
+    std::pair<char*, size_t>
+    getColVisibility ()
+    {
+        return getField (CV_FIELD);
+    }
 
-    void
-    read (cclient::data::streams::InputStream *stream, std::vector<char> *row)
+    uint64_t
+    getTimeStamp ()
     {
-        uint32_t len = stream->readEncodedLong();
-        read (stream, row, len);
+        return decoded[currentSlot].timestamp;
     }
 
-    void
-    read (cclient::data::streams::InputStream *stream, std::vector<char> *input, uint32_t len)
+    bool
+    isDeleted ()
     {
-        char *array = new char[len];
-        stream->readBytes (array, len);
+        return decoded[currentSlot].deleted;
+    }
+
+protected:
 
-        input->insert (input->begin (), array, array + len);
-        delete[] array;
+    static const uint8_t ROW_FIELD = 0;
+    static const uint8_t CF_FIELD = 1;
+    static const uint8_t CQ_FIELD = 2;
+    static const uint8_t CV_FIELD = 3;
+
+    /**
+     * Fields of a decoded key, stored contiguously. Field i spans
+     * offsets[i] to offsets[i + 1] of bytes.
+     **/
+    struct DecodedKey
+    {
+        std::vector<char> bytes;
+        uint32_t offsets[5];
+        uint64_t timestamp;
+        bool deleted;
+    };
+
+    std::pair<char*, size_t>
+    getField (uint8_t field)
+    {
+        DecodedKey &current = decoded[currentSlot];
+        return std::make_pair (current.bytes.data () + current.offsets[field],
+                               (size_t) (current.offsets[field + 1]
+                                         - current.offsets[field]));
     }
 
+    /**
+     * Copies a key into one of the decoded keys.
+     **/
+    void
+    load (std::shared_ptr<Key> from, uint8_t slot);
+
+    /**
+     * Decodes the next key against the previous key.
+     **/
+    template<typename Reader>
+    void
+    decode (Reader *stream);
+
+    /**
+     * Decodes a field into the key being read, from the stream or
+     * from the previous key.
+     **/
+    template<typename Reader>
+    void
+    readField (Reader *stream, uint8_t field, uint8_t SAME_FIELD, uint8_t PREFIX,
+               DecodedKey *target, const DecodedKey &previous);
+
     inline int
     commonPrefix (std::pair<char*, size_t> prev,
                   std::pair<char*, size_t> curr);
@@ -189,6 +245,16 @@ protected:
     bool
     isSame (std::pair<char*, size_t> a, std::pair<char*, size_t> b);
 
+    // the previous and current keys; reads alternate between them so
+    // that their storage is reused.
+    DecodedKey decoded[2];
+    // slot of the current key, or -1 if it only exists as key.
+    int8_t currentSlot;
+    // slot of the key against which the next read is decoded.
+    int8_t previousSlot;
+    // true if key holds the current key.
+    bool keyCurrent;
+
     int32_t rowCommonPrefixLen;
     int32_t cfCommonPrefixLen;
     int32_t cqCommonPrefixLen;
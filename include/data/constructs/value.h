@@ -17,9 +17,13 @@
 
 #include <stdint.h>
 #include <memory>
+#include <vector>
+#include <string>
 #include <cstdio>
 #include <cstring>
 #include "../streaming/Streams.h"
+#include "../streaming/input/BufferedReader.h"
+#include "ScanArena.h"
 
 namespace cclient {
 namespace data {
@@ -32,17 +36,88 @@ public:
 
     Value();
 
-    explicit Value(std::string val) {
+    explicit Value(const std::string &val) {
         value=NULL;
         valueSize =0;
         offset=0;
+        viewing=false;
         setValue((uint8_t*) val.c_str(), val.size());
     }
 
+    /**
+     * Constructor that refers to a value held elsewhere, such as in a
+     * ScanArena, without copying it. The value must outlive this object;
+     * it is copied into this object's own storage should it be modified.
+     **/
+    Value(const uint8_t *val, size_t size, FieldView) :
+        value((uint8_t*) val), offset(size), valueSize(size), viewing(true) {
+    }
+
+    /**
+     * Constructor that refers to a slice of a shared buffer, as setSlice
+     * does.
+     * @param sliceOwner owner of the buffer
+     * @param val beginning of the slice
+     * @param size length of the slice
+     **/
+    Value(std::shared_ptr<void> sliceOwner, const uint8_t *val, size_t size) :
+        value((uint8_t*) val), offset(size), valueSize(size), viewing(true),
+        owner(std::move(sliceOwner)) {
+    }
+
     virtual ~Value();
 
+    /**
+     * Values at least this large are read as slices where a shared
+     * buffer is available, rather than being copied.
+     **/
+    static const size_t SLICE_THRESHOLD = 16 * 1024;
+
     void setValue(uint8_t *val, size_t size, uint32_t ptrOff = 0);
 
+    /**
+     * Takes ownership of a vector's bytes rather than copying them. The
+     * value refers to the vector as a slice.
+     **/
+    void setValue(std::vector<uint8_t> &&val);
+
+    /**
+     * Takes ownership of a buffer allocated with new[].
+     * @param val buffer
+     * @param size length of the value
+     **/
+    void adopt(uint8_t *val, size_t size);
+
+    /**
+     * Refers to a slice of a shared buffer, such as a decompressed block,
+     * a Thrift result or a mapped region, rather than copying it. The
+     * owner keeps the buffer alive until this value is modified,
+     * materialized or destroyed.
+     * @param owner owner of the buffer
+     * @param val beginning of the slice
+     * @param size length of the slice
+     **/
+    void setSlice(std::shared_ptr<void> owner, const uint8_t *val, size_t size);
+
+    /**
+     * Returns whether the value refers to memory it does not own.
+     **/
+    bool isSlice() const {
+        return viewing;
+    }
+
+    /**
+     * Copies a value that refers to memory held elsewhere into storage
+     * owned by this object, releasing the shared buffer.
+     **/
+    void materialize();
+
+    /**
+     * Refers to the same slice as another value if it holds a shared
+     * buffer, otherwise copies the other value.
+     **/
+    void share(const Value &other);
+
     void append(uint8_t *val, size_t size);
 
     void deepCopy(Value *v);
@@ -59,6 +134,23 @@ public:
 
     uint64_t read (cclient::data::streams::InputStream *in);
 
+    /**
+     * Reads the value from a decompressed block, reusing this
+     * value's storage.
+     */
+    uint64_t read (cclient::data::streams::BufferedReader *in);
+
+    /**
+     * Reads the value from a decompressed block, referring to the block
+     * rather than copying values of at least sliceSize bytes.
+     * @param in reader of the block
+     * @param owner owner of the block's memory
+     * @param sliceSize minimum size of a value that is sliced
+     */
+    uint64_t read (cclient::data::streams::BufferedReader *in,
+                   const std::shared_ptr<void> &owner,
+                   size_t sliceSize = SLICE_THRESHOLD);
+
     bool operator ==(const Value & rhs) const;
 
     bool operator !=(const Value &rhs) const;
@@ -67,10 +159,21 @@ private:
 
     // value array.
     uint8_t *value;
-    // offset;
-    uint16_t offset;
+    // length of the value.
+    uint32_t offset;
     // value size.
     size_t valueSize;
+    // the value is held elsewhere and is not freed by this object.
+    bool viewing;
+    // keeps a sliced value's buffer alive, if it is shared.
+    std::shared_ptr<void> owner;
+
+    /**
+     * Discards a value held elsewhere, leaving this value empty.
+     * @return the owner of the slice, which the caller holds while it
+     * reads from the slice.
+     **/
+    std::shared_ptr<void> dropSlice();
 };
 }
 }
@@ -8,6 +8,7 @@
 #include "../../constructs/Key.h"
 #include "../../constructs/Range.h"
 #include "../../constructs/KeyValue.h"
+#include "../../constructs/ScanArena.h"
 #include "../../constructs/Mutation.h"
 #include "../../constructs/KeyExtent.h"
 #include "../../constructs/column.h"
@@ -128,19 +129,24 @@ public:
 
 	}
 
+	/**
+	 * Converts mutations, moving their serialized updates into the
+	 * TMutations rather than copying them. The buffers must be handed
+	 * back with restore before the mutations are used again.
+	 **/
 	static std::vector<org::apache::accumulo::core::data::thrift::TMutation> convert(
 	        std::vector<cclient::data::Mutation*> *iters)
 	{
 
 		std::vector<org::apache::accumulo::core::data::thrift::TMutation> convertedMutations;
 		if (!IsEmpty(iters)) {
-			for (auto it = iters->begin(); it != iters->end(); it++) {
-				org::apache::accumulo::core::data::thrift::TMutation mut;
-				mut.row = (*it)->getRow();
+			convertedMutations.resize(iters->size());
+			auto mut = convertedMutations.begin();
+			for (auto it = iters->begin(); it != iters->end(); it++, mut++) {
+				mut->row = (*it)->getRow();
 
-				mut.data = (*it)->getDataStr();
-				mut.entries = (*it)->size();
-				convertedMutations.push_back(mut);
+				mut->data = (*it)->releaseData();
+				mut->entries = (*it)->size();
 			}
 		}
 
@@ -148,6 +154,21 @@ public:
 
 	}
 
+	/**
+	 * Returns the buffers moved into TMutations by convert to their
+	 * mutations.
+	 **/
+	static void restore(std::vector<cclient::data::Mutation*> *iters,
+	                    std::vector<org::apache::accumulo::core::data::thrift::TMutation> *converted)
+	{
+		if (!IsEmpty(iters)) {
+			auto mut = converted->begin();
+			for (auto it = iters->begin(); it != iters->end() && mut != converted->end(); it++, mut++) {
+				(*it)->restoreData(std::move(mut->data));
+			}
+		}
+	}
+
 	static cclient::data::Range* convert(org::apache::accumulo::core::data::thrift::TRange range)
 	{
 		std::shared_ptr<cclient::data::Key> startKey = convert(range.start);
@@ -287,65 +308,70 @@ org::apache::accumulo::core::data::thrift::TKeyExtent keyExtent;
 		return keyExtent;
 	}
 
+	/**
+	 * Converts a batch of scan results that is no longer needed by the
+	 * caller. Large values refer to the results' strings rather than
+	 * being copied, so the results are held until those values are
+	 * released.
+	 */
 	static std::vector<std::shared_ptr<cclient::data::KeyValue> > *convert(
-	        std::vector<org::apache::accumulo::core::data::thrift::TKeyValue> tkvVec)
+	        std::vector<org::apache::accumulo::core::data::thrift::TKeyValue> &&tkvVec)
 	{
-		std::vector<std::shared_ptr<cclient::data::KeyValue>> *newvector = new std::vector<std::shared_ptr<cclient::data::KeyValue>>();
-		std::shared_ptr<cclient::data::Key> prevKey = NULL;
-
-		for (uint32_t i = 0; i < tkvVec.size(); i++) {
-
-			org::apache::accumulo::core::data::thrift::TKeyValue tkv =
-			        tkvVec.at(i);
-			std::shared_ptr<cclient::data::Key> key = std::make_shared< cclient::data::Key>();
-			if (!IsEmpty(&(tkv.key.row))) {
-				key->setRow(tkv.key.row.c_str(), tkv.key.row.size());
-			} else {
-				if (NULL != prevKey) {
-					std::pair<char*, size_t> prevRow = prevKey->getRow();
-					key->setRow(prevRow.first, prevRow.second);
-				}
-
-			}
-			if (!IsEmpty(&(tkv.key.colFamily))) {
-				key->setColFamily(tkv.key.colFamily.c_str(),
-				                  tkv.key.colFamily.size());
-			} else {
-				if (NULL != prevKey) {
-					std::pair<char*, size_t> prevCf = prevKey->getColFamily();
-					key->setColFamily(prevCf.first, prevCf.second);
-				}
-			}
-			if (!IsEmpty(&(tkv.key.colQualifier))) {
-				key->setColQualifier(tkv.key.colQualifier.c_str(),
-				                     tkv.key.colQualifier.size());
-			} else {
-				if (NULL != prevKey) {
-					std::pair<char*, size_t> prevCq =
-					        prevKey->getColQualifier();
-					key->setColQualifier(prevCq.first, prevCq.second);
-				}
-			}
+		std::shared_ptr<std::vector<org::apache::accumulo::core::data::thrift::TKeyValue>> results =
+		        std::make_shared<std::vector<org::apache::accumulo::core::data::thrift::TKeyValue>>(std::move(tkvVec));
+		return convert(*results, results);
+	}
 
-			if (!IsEmpty(&(tkv.key.colVisibility))) {
-				key->setColVisibility(tkv.key.colVisibility.c_str(),
-				                      tkv.key.colVisibility.size());
+	/**
+	 * Converts a batch of scan results. The keys, values and their fields
+	 * are placed in a single arena, to which they refer rather than owning
+	 * copies; the arena is released once every entry of the batch has
+	 * been released.
+	 * @param tkvVec scan results
+	 * @param owner owner of the results, from which large values are
+	 * sliced if provided.
+	 */
+	static std::vector<std::shared_ptr<cclient::data::KeyValue> > *convert(
+	        const std::vector<org::apache::accumulo::core::data::thrift::TKeyValue> &tkvVec,
+	        std::shared_ptr<void> owner = nullptr)
+	{
+		std::vector<std::shared_ptr<cclient::data::KeyValue>> *newvector = new std::vector<std::shared_ptr<cclient::data::KeyValue>>();
+		newvector->reserve(tkvVec.size());
+
+		// each entry holds a key, a value and the key value, along with
+		// the control block of each
+		size_t arenaSize = tkvVec.size() * (sizeof(cclient::data::Key) + sizeof(cclient::data::Value) + sizeof(cclient::data::KeyValue) + 3 * 64);
+		for (const org::apache::accumulo::core::data::thrift::TKeyValue &tkv : tkvVec) {
+			arenaSize += tkv.key.row.size() + tkv.key.colFamily.size() + tkv.key.colQualifier.size() + tkv.key.colVisibility.size();
+			if (NULL == owner || tkv.value.size() < cclient::data::Value::SLICE_THRESHOLD)
+				arenaSize += tkv.value.size();
+		}
+		std::shared_ptr<cclient::data::ScanArena> arena = std::make_shared<cclient::data::ScanArena>(arenaSize);
+		cclient::data::ArenaAllocator<char> allocator(arena);
+
+		// fields omitted from a key are those of the previous key
+		std::pair<char*, size_t> row(arena->copy(NULL, 0), 0);
+		std::pair<char*, size_t> cf = row, cq = row, cv = row;
+
+		for (const org::apache::accumulo::core::data::thrift::TKeyValue &tkv : tkvVec) {
+			if (!IsEmpty(&(tkv.key.row)))
+				row = std::make_pair(arena->copy(tkv.key.row.c_str(), tkv.key.row.size()), tkv.key.row.size());
+			if (!IsEmpty(&(tkv.key.colFamily)))
+				cf = std::make_pair(arena->copy(tkv.key.colFamily.c_str(), tkv.key.colFamily.size()), tkv.key.colFamily.size());
+			if (!IsEmpty(&(tkv.key.colQualifier)))
+				cq = std::make_pair(arena->copy(tkv.key.colQualifier.c_str(), tkv.key.colQualifier.size()), tkv.key.colQualifier.size());
+			if (!IsEmpty(&(tkv.key.colVisibility)))
+				cv = std::make_pair(arena->copy(tkv.key.colVisibility.c_str(), tkv.key.colVisibility.size()), tkv.key.colVisibility.size());
+
+			std::shared_ptr<cclient::data::Key> key = std::allocate_shared<cclient::data::Key>(allocator, row.first, row.second, cf.first, cf.second, cq.first, cq.second, cv.first, cv.second, tkv.key.timestamp, false, cclient::data::FieldView());
+			std::shared_ptr<cclient::data::Value> value;
+			if (NULL != owner && tkv.value.size() >= cclient::data::Value::SLICE_THRESHOLD) {
+				value = std::allocate_shared<cclient::data::Value>(allocator, owner, (const uint8_t*) tkv.value.data(), tkv.value.size());
 			} else {
-				if (NULL != prevKey) {
-					std::pair<char*, size_t> prevCv =
-					        prevKey->getColVisibility();
-					key->setColVisibility(prevCv.first, prevCv.second);
-				}
+				value = std::allocate_shared<cclient::data::Value>(allocator, (const uint8_t*) arena->copy(tkv.value.c_str(), tkv.value.size()), tkv.value.size(), cclient::data::FieldView());
 			}
 
-			key->setTimeStamp(tkv.key.timestamp);
-			std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared< cclient::data::KeyValue>();
-			kv->setKey(key,true);
-			kv->setValue((uint8_t*) tkv.value.c_str(), tkv.value.size());
-
-			newvector->push_back(kv);
-
-			prevKey = key;
+			newvector->push_back(std::allocate_shared<cclient::data::KeyValue>(allocator, key, value));
 		}
 		return newvector;
 	}
@@ -24,6 +24,7 @@
 #include <arpa/inet.h>
 
 #include "OutputStream.h"
+#include "VLongEncoder.h"
 
 namespace cclient {
 namespace data {
@@ -76,7 +77,38 @@ public:
     	return OutputStream::writeEncodedLong(n);
     }
 
+    virtual uint64_t writeVLong(const int64_t n = 0);
+
+    virtual uint64_t writeHadoopLong(const int64_t n = 0) {
+        return ByteOutputStream::writeVLong(n);
+    }
+
+    /**
+     * Ensures that cnt bytes may be written at the current offset.
+     * @param cnt number of bytes
+     * @returns pointer at which to write, valid until the next write.
+     */
+    inline char *reserve(size_t cnt) {
+        if (size - offset < cnt) {
+            grow(cnt);
+        }
+        return array.data() + offset;
+    }
+
+    /**
+     * Advances the offset past bytes written to a reservation.
+     * @param cnt number of bytes written
+     * @returns offset
+     */
+    inline uint64_t commit(size_t cnt) {
+        offset += cnt;
+        return offset;
+    }
+
 protected:
+
+    void grow(size_t cnt);
+
     // offset of the stream.
     uint32_t offset;
     // size of the steram.
@@ -112,15 +144,6 @@ public:
         return ByteOutputStream::writeLong(htonlw(val));
     }
 
-    virtual uint64_t writeVLong(const int64_t n = 0) {
-        return ByteOutputStream::writeHadoopLong((int64_t) htonlw(n));
-    }
-
-    virtual uint64_t writeEncodedLong(const int64_t n = 0) {
-    	std::cout << "writing BE encoded " << htonlw(n) << " from " << n << std::endl;
-        return ByteOutputStream::writeEncodedLong((int64_t) htonlw(n));
-    }
-
     virtual uint64_t writeBytes(const char *bytes, size_t cnt) {
     	return ByteOutputStream::writeBytes(bytes,cnt);
     }
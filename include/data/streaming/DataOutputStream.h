@@ -17,6 +17,7 @@
 #include <cstdint>
 #include <iostream>
 #include "OutputStream.h"
+#include "VLongEncoder.h"
 
 namespace cclient {
 namespace data {
@@ -93,32 +94,9 @@ public:
     }
 
     virtual uint64_t writeVLong(const int64_t n) {
-        int64_t i = n;
-        if (i >= -112L && i <= 127L) {
-            output_stream_ref->write((const char*) &i, 1);
-        } else {
-            int len = -112;
-            if (i < 0L) {
-                i = ~i;
-                len = -120;
-            }
-
-            for (long tmp = i; tmp != 0L; --len) {
-                tmp >>= 8;
-            }
-            char b = (char) len;
-            output_stream_ref->write((const char*) &b, 1);
-            len = len < -120 ? -(len + 120) : -(len + 112);
-
-            for (int idx = len; idx != 0; --idx) {
-                int shiftbits = (idx - 1) * 8;
-                long mask = 255L << shiftbits;
-                char val = (char) ((int) ((i & mask) >> shiftbits));
-                output_stream_ref->write((const char*) &val, 1);
-            }
-
-        }
-
+        // encode the long so that it is passed on with a single write
+        char encoded[VLongEncoder::MAX_LENGTH];
+        output_stream_ref->write(encoded, VLongEncoder::encode(encoded, n));
         return output_stream_ref->getPos();
 
     }
@@ -0,0 +1,126 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef VLONG_ENCODER_H
+#define VLONG_ENCODER_H
+
+#include <stdint.h>
+#include <cstring>
+#include <cstddef>
+
+namespace cclient {
+namespace data {
+namespace streams {
+
+/**
+ * Encodes hadoop variable length longs, as written by
+ * WritableUtils.writeVLong, directly into a caller's buffer.
+ */
+class VLongEncoder {
+public:
+
+    // length prefix followed by up to eight bytes.
+    static const size_t MAX_LENGTH = 9;
+
+    /**
+     * Encodes a long.
+     * @param out destination, which must have MAX_LENGTH bytes available
+     * regardless of the length of the encoding.
+     * @param n value to encode
+     * @returns number of bytes used.
+     */
+    static inline size_t encode(char *out, const int64_t n) {
+        if (n >= -112L && n <= 127L) {
+            out[0] = (char) n;
+            return 1;
+        }
+        uint64_t magnitude = n < 0 ? ~(uint64_t) n : (uint64_t) n;
+        // magnitude is at least 112, so it has at least one set bit
+        int bytes = 8 - __builtin_clzll(magnitude) / 8;
+        out[0] = (char) ((n < 0 ? -120 : -112) - bytes);
+        storeBigEndian(out + 1, magnitude, bytes);
+        return bytes + 1;
+    }
+
+    /**
+     * Encodes a long in the compact form read by
+     * InputStream::readHadoopLong.
+     * @param out destination, which must have MAX_LENGTH bytes available
+     * regardless of the length of the encoding.
+     * @param n value to encode
+     * @returns number of bytes used.
+     */
+    static inline size_t encodeCompact(char *out, const int64_t n) {
+        if (n < 128 && n >= -32) {
+            out[0] = (char) n;
+            return 1;
+        }
+        uint64_t un = n < 0 ? ~(uint64_t) n : (uint64_t) n;
+        // how many bytes do we need to represent the number with sign bit?
+        int len = (64 - __builtin_clzll(un)) / 8 + 1;
+        int64_t firstByte = n >> ((len - 1) * 8);
+        int bytes;
+        switch (len) {
+        case 1:
+            // fall it through to firstByte==-1, len=2.
+            firstByte >>= 8;
+        case 2:
+            if (firstByte < 20 && firstByte >= -20) {
+                out[0] = (char) (firstByte - 52);
+                bytes = 1;
+                break;
+            }
+            // fall it through to firstByte==0/-1, len=3.
+            firstByte >>= 8;
+        case 3:
+            if (firstByte < 16 && firstByte >= -16) {
+                out[0] = (char) (firstByte - 88);
+                bytes = 2;
+                break;
+            }
+            // fall it through to firstByte==0/-1, len=4.
+            firstByte >>= 8;
+        case 4:
+            if (firstByte < 8 && firstByte >= -8) {
+                out[0] = (char) (firstByte - 112);
+                bytes = 3;
+                break;
+            }
+        default:
+            out[0] = (char) (len - 129);
+            bytes = len;
+        }
+        storeBigEndian(out + 1, (uint64_t) n, bytes);
+        return bytes + 1;
+    }
+
+protected:
+
+    /**
+     * Stores the low order bytes of a value in network order. Eight
+     * bytes are always stored, so that the store needs no branches.
+     */
+    static inline void storeBigEndian(char *out, uint64_t value, int bytes) {
+        // left align the significant bytes
+        uint64_t aligned = value << ((8 - bytes) * 8);
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        aligned = __builtin_bswap64(aligned);
+#endif
+        memcpy(out, &aligned, 8);
+    }
+
+};
+}
+}
+}
+#endif
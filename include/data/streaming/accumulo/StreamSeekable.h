@@ -17,6 +17,7 @@
 #include <cstdlib>
 
 #include <vector>
+#include <string>
 #include "../StreamRelocation.h"
 #include "../../constructs/Range.h"
 
@@ -32,11 +33,18 @@ class StreamSeekable : public StreamRelocation
 {
 protected:
     Range *range;
-    std::vector<uint8_t*> columnFamilies;
+    std::vector<std::string> columnFamilies;
     bool inclusive;
 public:
 
-    StreamSeekable (Range *range, std::vector<uint8_t*> columnFamilies,
+    /**
+     Constructor
+     @param range range to which we are seeking
+     @param columnFamilies column families to include or exclude
+     @param inclusive if true, only the provided column families are
+     returned, otherwise the provided column families are excluded.
+     **/
+    StreamSeekable (Range *range, std::vector<std::string> columnFamilies,
                     bool inclusive) :
         range (range), columnFamilies (columnFamilies), inclusive (
             inclusive)
@@ -44,13 +52,27 @@ public:
 
     }
 
+    /**
+     Constructor that accepts null terminated column families.
+     **/
+    StreamSeekable (Range *range, std::vector<uint8_t*> columnFamilies,
+                    bool inclusive) :
+        range (range), inclusive (
+            inclusive)
+    {
+        for (uint8_t *cf : columnFamilies)
+        {
+            this->columnFamilies.push_back (std::string ((char*) cf));
+        }
+    }
+
     Range *
     getRange ()
     {
         return range;
     }
 
-    std::vector<uint8_t*> *
+    std::vector<std::string> *
     getColumnFamilies ()
     {
         return &columnFamilies;
@@ -0,0 +1,261 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BUFFERED_READER_H
+#define BUFFERED_READER_H
+
+#include <stdint.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace cclient
+{
+namespace data
+{
+namespace streams
+{
+
+/**
+ * Purpose: decodes a contiguous span, such as a decompressed block,
+ * without the virtual calls of the stream hierarchy. Multi byte
+ * integers are read in network order, as with EndianInputStream.
+ */
+class BufferedReader
+{
+public:
+
+    BufferedReader () :
+        start (NULL), pos (NULL), end (NULL)
+    {
+    }
+
+    BufferedReader (const char *data, size_t len) :
+        start (data), pos (data), end (data + len)
+    {
+    }
+
+    /**
+     * Reads from a new span.
+     * @param data beginning of the span
+     * @param len length of the span
+     */
+    void
+    reset (const char *data, size_t len)
+    {
+        start = data;
+        pos = data;
+        end = data + len;
+    }
+
+    inline uint8_t
+    readByte ()
+    {
+        require (1);
+        return (uint8_t) * pos++;
+    }
+
+    inline bool
+    readBoolean ()
+    {
+        return readByte () != 0;
+    }
+
+    inline int16_t
+    readShort ()
+    {
+        require (2);
+        const uint8_t *p = (const uint8_t*) pos;
+        pos += 2;
+        return (int16_t) ((p[0] << 8) | p[1]);
+    }
+
+    inline int64_t
+    readUnsignedShort ()
+    {
+        return (uint16_t) readShort ();
+    }
+
+    inline int32_t
+    readInt ()
+    {
+        require (4);
+        const uint8_t *p = (const uint8_t*) pos;
+        pos += 4;
+        return (int32_t) (((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+                          | ((uint32_t) p[2] << 8) | (uint32_t) p[3]);
+    }
+
+    inline int64_t
+    readLong ()
+    {
+        require (8);
+        const uint8_t *p = (const uint8_t*) pos;
+        pos += 8;
+        uint64_t val = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            val = (val << 8) | p[i];
+        }
+        return (int64_t) val;
+    }
+
+    /**
+     * Reads a hadoop variable length long, as written by writeVLong.
+     */
+    inline int64_t
+    readEncodedLong ()
+    {
+        require (1);
+        int8_t firstByte = (int8_t) * pos;
+        // most lengths and timestamp deltas fit within a single byte
+        if (firstByte >= -112)
+        {
+            pos++;
+            return firstByte;
+        }
+        int len = firstByte < -120 ? -119 - firstByte : -111 - firstByte;
+        require (len);
+        const uint8_t *p = (const uint8_t*) pos + 1;
+        pos += len;
+        uint64_t val = 0;
+        for (int i = 0; i < len - 1; i++)
+        {
+            val = (val << 8) | p[i];
+        }
+        return firstByte < -120 ? (int64_t) ~val : (int64_t) val;
+    }
+
+    /**
+     * Reads a long as encoded by InputStream::readHadoopLong.
+     */
+    inline int64_t
+    readHadoopLong ()
+    {
+        int8_t firstByte = (int8_t) readByte ();
+
+        if (firstByte >= -32)
+        {
+            return firstByte;
+        }
+
+        int64_t high;
+        switch ((firstByte + 128) / 8)
+        {
+        case 11:
+        case 10:
+        case 9:
+        case 8:
+        case 7:
+            return ((firstByte + 52) << 8) | readByte ();
+        case 6:
+        case 5:
+        case 4:
+        case 3:
+            high = (int64_t) (firstByte + 88) << 16;
+            return high | readUnsignedShort ();
+        case 2:
+        case 1:
+            high = (int64_t) (firstByte + 112) << 24;
+            high |= readUnsignedShort () << 8;
+            return high | readByte ();
+        case 0:
+            switch (firstByte + 129)
+            {
+            case 4:
+                return readInt ();
+            case 5:
+                high = ((int64_t) readInt ()) << 8;
+                return high | readByte ();
+            case 6:
+                high = ((int64_t) readInt ()) << 16;
+                return high | readUnsignedShort ();
+            case 7:
+                high = ((int64_t) readInt ()) << 24;
+                high |= readUnsignedShort () << 8;
+                return high | readByte ();
+            case 8:
+                return readLong ();
+            default:
+                throw std::runtime_error ("Unsupported file type");
+            }
+        default:
+            throw std::runtime_error ("Unsupported file type");
+        }
+    }
+
+    inline void
+    readBytes (char *bytes, size_t cnt)
+    {
+        require (cnt);
+        memcpy (bytes, pos, cnt);
+        pos += cnt;
+    }
+
+    inline void
+    readBytes (uint8_t *bytes, size_t cnt)
+    {
+        readBytes ((char*) bytes, cnt);
+    }
+
+    /**
+     * Consumes cnt bytes without copying them.
+     * @returns pointer to the bytes, valid while the span is.
+     */
+    inline const char *
+    read (size_t cnt)
+    {
+        require (cnt);
+        const char *bytes = pos;
+        pos += cnt;
+        return bytes;
+    }
+
+    inline void
+    skip (size_t cnt)
+    {
+        require (cnt);
+        pos += cnt;
+    }
+
+    uint64_t
+    getPos () const
+    {
+        return pos - start;
+    }
+
+    size_t
+    remaining () const
+    {
+        return end - pos;
+    }
+
+protected:
+
+    inline void
+    require (size_t cnt) const
+    {
+        if ((size_t) (end - pos) < cnt)
+            throw std::runtime_error ("Stream unavailable");
+    }
+
+    const char *start;
+    const char *pos;
+    const char *end;
+};
+
+}
+}
+}
+
+#endif
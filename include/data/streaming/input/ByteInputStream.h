@@ -65,6 +65,7 @@ public:
         }
         else
         {
+            allocated = false;
             iBytes = byteArray; //new char[ len ];
         }
         //memcpy(iBytes,byteArray,len);
@@ -122,6 +123,18 @@ public:
         return cnt;
     }
 
+    virtual uint64_t
+    readAt (uint64_t pos, uint8_t *bytes, size_t cnt)
+    {
+        if (input_stream_ref != NULL)
+            return input_stream_ref->readAt (pos, bytes, cnt);
+
+        if ((cnt + pos) > length)
+            throw std::runtime_error ("Stream unavailable");
+        memcpy (bytes, iBytes + pos, cnt);
+        return cnt;
+    }
+
     virtual uint64_t
     readBytes (char *bytes, size_t cnt)
     {
@@ -47,6 +47,10 @@ public:
         return input_stream_ref->readBytes((char*) bytes, cnt);
     }
 
+    virtual uint64_t readAt(uint64_t pos, uint8_t *bytes, size_t cnt) {
+        return input_stream_ref->readAt(pos, bytes, cnt);
+    }
+
 protected:
     // output stream reference.
     InputStream *input_stream_ref;
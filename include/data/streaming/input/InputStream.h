@@ -19,6 +19,7 @@
 #include <cstdio>
 
 #include <stdexcept>
+#include <mutex>
 
 
 
@@ -106,6 +107,33 @@ public:
         return *position;
     }
 
+    /**
+     * Positional read, which leaves the position of this stream
+     * unchanged. std::istream offers no positional read, so the
+     * underlying stream is moved and restored while holding this
+     * stream's lock.
+     * @param pos position within the stream
+     * @param bytes destination
+     * @param cnt number of bytes to read
+     * @returns number of bytes read
+     */
+    virtual uint64_t
+    readAt (uint64_t pos, uint8_t *bytes, size_t cnt)
+    {
+        if (NULL == istream_ref)
+            throw std::runtime_error ("Positional reads are unsupported");
+        std::lock_guard<std::mutex> lock (positionalLock);
+        std::streampos current = istream_ref->tellg ();
+        istream_ref->seekg (pos);
+        istream_ref->read ((char*) bytes, cnt);
+        bool complete = istream_ref->gcount () == (std::streamsize) cnt;
+        istream_ref->clear ();
+        istream_ref->seekg (current);
+        if (!complete)
+            throw std::runtime_error ("Stream unavailable");
+        return cnt;
+    }
+
     virtual uint64_t
     readBytes (uint8_t **bytes, size_t cnt)
     {
@@ -183,6 +211,9 @@ public:
         }
 
         int len = firstByte + 129;
+        // bytes are read in separate statements, as the order of
+        // evaluation within an expression is unspecified
+        int64_t high, low;
         switch ((firstByte + 128) / 8)
         {
         case 11:
@@ -195,11 +226,13 @@ public:
         case 5:
         case 4:
         case 3:
-            return ((firstByte + 88) << 16) | readByte ();
+            high = (int64_t) (firstByte + 88) << 16;
+            return high | readUnsignedShortBE ();
         case 2:
         case 1:
-            return ((firstByte + 112) << 24) | (readByte () << 8)
-                   | readByte ();
+            high = (int64_t) (firstByte + 112) << 24;
+            high |= readUnsignedShortBE () << 8;
+            return high | readByte ();
         case 0:
 
             switch (len)
@@ -207,12 +240,15 @@ public:
             case 4:
                 return readInt ();
             case 5:
-                return ((long) readInt ()) << 8 | readByte ();
+                high = ((int64_t) readInt ()) << 8;
+                return high | readByte ();
             case 6:
-                return ((long) readInt ()) << 16 | readByte ();
+                high = ((int64_t) readInt ()) << 16;
+                return high | readUnsignedShortBE ();
             case 7:
-                return ((long) readInt ()) << 24 | (readByte () << 8)
-                       | readByte ();
+                high = ((int64_t) readInt ()) << 24;
+                low = readUnsignedShortBE () << 8;
+                return high | low | readByte ();
             case 8:
                 return readLong ();
             default:
@@ -244,7 +280,7 @@ public:
                 i |= (long) (b & 255);
             }
 
-            if (i < -120 || (i >= -112 && i < 0))
+            if (firstByte < -120)
             {
                 return ~i;
             }
@@ -317,6 +353,17 @@ public:
 
 protected:
 
+    /**
+     * Reads an unsigned short in network order, regardless of the
+     * byte order of readShort.
+     */
+    int64_t
+    readUnsignedShortBE ()
+    {
+        int64_t high = readByte ();
+        return (high << 8) | readByte ();
+    }
+
     int
     numberOfLeadingZeros (uint64_t i)
     {
@@ -373,6 +420,8 @@ protected:
     // identify that we have copied a stream
     // useful when deleting position
     bool copy;
+    // serializes positional reads of istream_ref.
+    std::mutex positionalLock;
     
 
 };
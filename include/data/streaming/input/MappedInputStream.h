@@ -0,0 +1,293 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MAPPED_IN_STREAM
+#define MAPPED_IN_STREAM
+
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <endian.h>
+
+#include "InputStream.h"
+
+namespace cclient
+{
+namespace data
+{
+namespace streams
+{
+
+/**
+ * Read only mapping of a file. The mapping, and the descriptor behind it,
+ * may be shared by any number of MappedInputStreams, each of which keeps
+ * its own position.
+ */
+class MappedRegion
+{
+public:
+
+    explicit MappedRegion (const std::string &file);
+
+    ~MappedRegion ();
+
+    /**
+     * Returns the beginning of the mapping. May be NULL if the file
+     * could not be mapped, in which case reads fall back to pread.
+     * @returns mapped bytes
+     */
+    const uint8_t *
+    data () const
+    {
+        return mapping;
+    }
+
+    /**
+     * Returns the length of the file.
+     * @returns file length
+     */
+    uint64_t
+    size () const
+    {
+        return length;
+    }
+
+    /**
+     * Returns the underlying file descriptor.
+     * @returns file descriptor
+     */
+    int
+    getDescriptor () const
+    {
+        return descriptor;
+    }
+
+    /**
+     * Positional read that does not modify any cursor, therefore
+     * it may be called concurrently.
+     * @param pos position within the file
+     * @param bytes destination
+     * @param cnt number of bytes to read
+     * @returns number of bytes read
+     */
+    uint64_t
+    readAt (uint64_t pos, uint8_t *bytes, size_t cnt) const;
+
+    /**
+     * Returns an identifier derived from the device, inode, modification
+     * time and length of the file, such that two mappings of the same,
+     * unmodified file share an identity.
+     * @returns file identity
+     */
+    uint64_t
+    getIdentity () const
+    {
+        return identity;
+    }
+
+private:
+    MappedRegion (const MappedRegion &other);
+    MappedRegion &
+    operator= (const MappedRegion &other);
+
+    // file descriptor
+    int descriptor;
+    // mapped region.
+    uint8_t *mapping;
+    // file length.
+    uint64_t length;
+    // file identity.
+    uint64_t identity;
+};
+
+/**
+ * Input stream over a memory mapped file.
+ * Purpose: avoids the iostream path for RFile reads and hands out
+ * spans of the mapping so that callers may decompress directly from
+ * the page cache. Integers are read in network order, as written by
+ * Java's DataOutput, so the stream needs no EndianInputStream.
+ */
+class MappedInputStream : public InputStream
+{
+public:
+
+    explicit MappedInputStream (const std::string &file) :
+        InputStream (), region (std::make_shared<MappedRegion> (file)), offset (
+            0)
+    {
+        base = region->data ();
+    }
+
+    explicit MappedInputStream (std::shared_ptr<MappedRegion> sharedRegion) :
+        InputStream (), region (sharedRegion), offset (0)
+    {
+        base = region->data ();
+    }
+
+    virtual
+    ~MappedInputStream ()
+    {
+    }
+
+    /**
+     * Creates a new stream, with its own position, that shares
+     * this stream's mapping and descriptor.
+     * @returns newly allocated stream.
+     */
+    MappedInputStream *
+    duplicate ()
+    {
+        return new MappedInputStream (region);
+    }
+
+    std::shared_ptr<MappedRegion>
+    getRegion ()
+    {
+        return region;
+    }
+
+    /**
+     * Returns the length of the underlying file.
+     * @returns file length
+     */
+    uint64_t
+    getLength ()
+    {
+        return region->size ();
+    }
+
+    /**
+     * Returns a pointer to cnt bytes beginning at pos, without copying.
+     * @param pos position within the file
+     * @param cnt number of bytes the caller intends to read
+     * @returns pointer into the mapping, or NULL if the file isn't mapped
+     */
+    const uint8_t *
+    getSpan (uint64_t pos, size_t cnt)
+    {
+        if (NULL == base)
+            return NULL;
+        if (pos + cnt > region->size ())
+            throw std::runtime_error ("Stream unavailable");
+        return base + pos;
+    }
+
+    /**
+     * Positional read. Does not modify the position of this stream.
+     */
+    virtual uint64_t
+    readAt (uint64_t pos, uint8_t *bytes, size_t cnt)
+    {
+        return region->readAt (pos, bytes, cnt);
+    }
+
+    virtual InputStream *
+    seek (uint64_t pos)
+    {
+        if (pos > region->size ())
+            throw std::runtime_error ("Stream unavailable");
+        offset = pos;
+        return this;
+    }
+
+    virtual uint64_t
+    getPos ()
+    {
+        return offset;
+    }
+
+    virtual uint64_t
+    readBytes (uint8_t *bytes, size_t cnt)
+    {
+        copyOut (bytes, cnt);
+        return offset;
+    }
+
+    virtual uint64_t
+    readBytes (char *bytes, size_t cnt)
+    {
+        copyOut ((uint8_t*) bytes, cnt);
+        return offset;
+    }
+
+    virtual uint8_t
+    readByte ()
+    {
+        uint8_t byte;
+        copyOut (&byte, 1);
+        return byte;
+    }
+
+    virtual short
+    readShort ()
+    {
+        uint16_t shortVal;
+        copyOut ((uint8_t*) &shortVal, 2);
+        return (short) be16toh (shortVal);
+    }
+
+    virtual int
+    readInt ()
+    {
+        uint32_t intVal;
+        copyOut ((uint8_t*) &intVal, 4);
+        return (int) be32toh (intVal);
+    }
+
+    virtual uint64_t
+    readLong ()
+    {
+        uint64_t val;
+        copyOut ((uint8_t*) &val, 8);
+        return be64toh (val);
+    }
+
+    virtual uint32_t
+    bytesRead ()
+    {
+        return offset;
+    }
+
+    virtual uint64_t
+    bytesAvailable ()
+    {
+        return region->size () - offset;
+    }
+
+protected:
+
+    inline void
+    copyOut (uint8_t *bytes, size_t cnt)
+    {
+        if (offset + cnt > region->size ())
+            throw std::runtime_error ("Stream unavailable");
+        if (NULL != base)
+            memcpy (bytes, base + offset, cnt);
+        else
+            region->readAt (offset, bytes, cnt);
+        offset += cnt;
+    }
+
+    std::shared_ptr<MappedRegion> region;
+    // cached beginning of the mapping
+    const uint8_t *base;
+    // position of this stream.
+    uint64_t offset;
+
+};
+}
+}
+}
+#endif
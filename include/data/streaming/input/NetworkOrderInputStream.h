@@ -19,6 +19,7 @@
 #include <cstdio>
 #include <cstring>
 #include <netinet/in.h>
+#include <endian.h>
 
 #include "InputStream.h"
 #include "ByteInputStream.h"
@@ -68,7 +69,7 @@ public:
     }
 
     uint64_t readLong() {
-        return ntohl(ByteInputStream::readLong());
+        return be64toh(ByteInputStream::readLong());
     }
 
 };
@@ -24,6 +24,7 @@
 #include "../transport/AccumuloMasterTransporter.h"
 #include "../RootInterface.h"
 #include "../../writer/Sink.h"
+#include "../../data/constructs/rfile/TabletPartitionedWriter.h"
 
 namespace interconnect
 {
@@ -173,6 +174,18 @@ public:
 	std::unique_ptr<writer::Sink<cclient::data::KeyValue>> createWriter(cclient::data::security::Authorizations *auths,
 	                              uint16_t threads);
 
+	/**
+	 * Creates a writer of RFiles partitioned by the table's current
+	 * tablets, whose directory may then be passed to import.
+	 * @param dir directory in which the RFiles are written
+	 * @param compressor compressor of the RFiles
+	 * @param memoryBudget bytes of entries buffered across all tablets
+	 * @param threads number of threads writing RFiles
+	 * @return new partitioned writer
+	 */
+	std::unique_ptr<cclient::data::TabletPartitionedWriter> createBulkWriter(std::string dir,
+	                              cclient::data::compression::Compressor *compressor, uint64_t memoryBudget, uint16_t threads);
+
 protected:
   
 	TransportPool<interconnect::AccumuloMasterTransporter> *distributedConnector;
@@ -166,10 +166,10 @@ protected:
 		                         1024);
 
 
-		org::apache::accumulo::core::data::thrift::ScanResult results =
+		org::apache::accumulo::core::data::thrift::ScanResult &results =
 		        scan.result;
 
-		std::vector<std::shared_ptr<cclient::data::KeyValue> > *kvs = ThriftWrapper::convert(results.results);
+		std::vector<std::shared_ptr<cclient::data::KeyValue> > *kvs = ThriftWrapper::convert(std::move(results.results));
 
 
 		initialScan->setHasMore(results.more);
@@ -217,10 +217,10 @@ protected:
 		                              ThriftWrapper::convert(iters), iterOptions,
 		                              request->getAuthorizations()->getAuthorizations(), true);
 
-		org::apache::accumulo::core::data::thrift::MultiScanResult results =
+		org::apache::accumulo::core::data::thrift::MultiScanResult &results =
 		        scan.result;
 
-		std::vector<std::shared_ptr<cclient::data::KeyValue> > *kvs = ThriftWrapper::convert(results.results);
+		std::vector<std::shared_ptr<cclient::data::KeyValue> > *kvs = ThriftWrapper::convert(std::move(results.results));
 
 		initialScan->setHasMore(results.more);
 
@@ -406,7 +406,7 @@ public:
 		tinfo.parentId = originalScan->getId();
 		tserverClient->continueScan(results,tinfo,scanId);
 
-		std::vector<std::shared_ptr<cclient::data::KeyValue> > *kvs = ThriftWrapper::convert(results.results);
+		std::vector<std::shared_ptr<cclient::data::KeyValue> > *kvs = ThriftWrapper::convert(std::move(results.results));
 
 
 		if (results.more)
@@ -442,9 +442,18 @@ public:
 		for (std::map<cclient::data::KeyExtent, std::vector<cclient::data::Mutation*>>::iterator it = request->begin();
 		     it != request->end(); it++) {
 
-			tserverClient->applyUpdates(tinfo, upId,
-			                            ThriftWrapper::convert(it->first),
-			                            ThriftWrapper::convert(&it->second));
+			std::vector<org::apache::accumulo::core::data::thrift::TMutation> mutations =
+			        ThriftWrapper::convert(&it->second);
+			try {
+				tserverClient->applyUpdates(tinfo, upId,
+				                            ThriftWrapper::convert(it->first),
+				                            mutations);
+			} catch (...) {
+				// failed mutations may be sent again
+				ThriftWrapper::restore(&it->second, &mutations);
+				throw;
+			}
+			ThriftWrapper::restore(&it->second, &mutations);
 		}
 		tinfo.parentId=tinfo.traceId;
 		tinfo.traceId=tinfo.traceId+1;
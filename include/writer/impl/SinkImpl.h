@@ -107,6 +107,8 @@ protected:
     cclient::impl::TabletLocator *tableLocator;
     interconnect::TableOperations<cclient::data::KeyValue, scanners::ResultBlock<cclient::data::KeyValue>> *tops;
     moodycamel::ConcurrentQueue<cclient::data::Mutation*> mutationQueue;
+    // supplies the buffers of mutations built from queued key values
+    cclient::data::MutationBufferPool mutationPool;
     
 };
 
@@ -0,0 +1,148 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstring>
+
+#include "../../../include/data/constructs/ByteCompare.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BYTECOMPARE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cclient
+{
+namespace data
+{
+
+namespace
+{
+
+/**
+ * Index of the first differing byte within two words that differ.
+ */
+inline size_t
+firstDifference (uint64_t a, uint64_t b)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_clzll (a ^ b) / 8;
+#else
+    return __builtin_ctzll (a ^ b) / 8;
+#endif
+}
+
+size_t
+mismatchPortable (const char *b1, const char *b2, size_t len)
+{
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t a, b;
+        memcpy (&a, b1 + i, 8);
+        memcpy (&b, b2 + i, 8);
+        if (a != b)
+            return i + firstDifference (a, b);
+    }
+    for (; i < len; i++)
+    {
+        if (b1[i] != b2[i])
+            return i;
+    }
+    return len;
+}
+
+#ifdef BYTECOMPARE_X86
+
+__attribute__ ((target ("sse2"))) size_t
+mismatchSse2 (const char *b1, const char *b2, size_t len)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i a = _mm_loadu_si128 ((const __m128i *) (b1 + i));
+        __m128i b = _mm_loadu_si128 ((const __m128i *) (b2 + i));
+        unsigned mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b));
+        if (mask != 0xffff)
+            return i + __builtin_ctz (~mask & 0xffff);
+    }
+    return i + mismatchPortable (b1 + i, b2 + i, len - i);
+}
+
+__attribute__ ((target ("avx2"))) size_t
+mismatchAvx2 (const char *b1, const char *b2, size_t len)
+{
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256 ((const __m256i *) (b1 + i));
+        __m256i b = _mm256_loadu_si256 ((const __m256i *) (b2 + i));
+        unsigned mask = (unsigned) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (a, b));
+        if (mask != 0xffffffff)
+            return i + __builtin_ctz (~mask);
+    }
+    if (i + 16 <= len)
+    {
+        __m128i a = _mm_loadu_si128 ((const __m128i *) (b1 + i));
+        __m128i b = _mm_loadu_si128 ((const __m128i *) (b2 + i));
+        unsigned mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b));
+        if (mask != 0xffff)
+            return i + __builtin_ctz (~mask & 0xffff);
+        i += 16;
+    }
+    return i + mismatchPortable (b1 + i, b2 + i, len - i);
+}
+
+#endif
+
+ByteCompare::MismatchFunction
+selectMismatch ()
+{
+#ifdef BYTECOMPARE_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        return mismatchAvx2;
+    if (__builtin_cpu_supports ("sse2"))
+        return mismatchSse2;
+#endif
+    return mismatchPortable;
+}
+
+}
+
+ByteCompare::MismatchFunction ByteCompare::mismatchImpl = ByteCompare::resolve;
+
+size_t
+ByteCompare::resolve (const char *b1, const char *b2, size_t len)
+{
+    // every thread selects the same implementation
+    MismatchFunction selected = selectMismatch ();
+    __atomic_store_n (&mismatchImpl, selected, __ATOMIC_RELAXED);
+    return selected (b1, b2, len);
+}
+
+std::string
+ByteCompare::getImplementation ()
+{
+    if (mismatchImpl == resolve)
+        mismatch ("", "", 0);
+#ifdef BYTECOMPARE_X86
+    if (mismatchImpl == mismatchAvx2)
+        return "avx2";
+    if (mismatchImpl == mismatchSse2)
+        return "sse2";
+#endif
+    return "portable";
+}
+
+}
+}
@@ -12,6 +12,10 @@
  * limitations under the License.
  */
 
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
 #include "../../../include/data/constructs/Key.h"
 
 namespace cclient
@@ -19,93 +23,295 @@ namespace cclient
 namespace data
 {
 
-Key::Key () :
-    deleted (false), timestamp ((uint64_t) -1), colVisSize (0), rowMaxSize (
-        0), columnFamilySize (0), colQualSize (0), rowLength (0), columnFamilyLength (
-            0), colQualLen (0)
+/**
+ * Copies a field, which may be empty and null.
+ */
+static inline void
+copyField (char *dest, const char *src, size_t len)
 {
-    row = new char[0];
+    if (len > 0)
+        memcpy (dest, src, len);
+}
 
-    colFamily = new char[0];
+Key::Key () :
+    row (inlineFields), rowLength (0), columnFamilyLength (0), colFamily (
+        inlineFields), colQualifier (inlineFields), colQualLen (0), keyVisibility (
+            inlineFields), colVisSize (0), timestamp ((uint64_t) -1), deleted (
+                false), viewing (false), fields (inlineFields), fieldCapacity (
+                    INLINE_FIELD_SIZE)
+{
+}
 
-    colQualifier = new char[0];
+Key::Key (const char *row, uint32_t rowLen, const char *cf, uint32_t cfLen,
+          const char *cq, uint32_t cqLen, const char *cv, uint32_t cvLen,
+          uint64_t timestamp, bool deleted, FieldView) :
+    row ((char*) row), rowLength (rowLen), columnFamilyLength (cfLen), colFamily (
+        (char*) cf), colQualifier ((char*) cq), colQualLen (cqLen), keyVisibility (
+            (char*) cv), colVisSize (cvLen), timestamp (timestamp), deleted (
+                deleted), viewing (true), fields (inlineFields), fieldCapacity (
+                    INLINE_FIELD_SIZE)
+{
+}
 
-    keyVisibility = new char[0];
+Key::Key (const Key &other) :
+    Key ()
+{
+    *this = other;
+}
 
+Key::Key (Key &&other) :
+    Key ()
+{
+    *this = std::move (other);
 }
 
 Key::~Key ()
 {
+    releaseFields ();
+}
 
-    delete[] row;
-    delete[] colFamily;
-    delete[] colQualifier;
-    delete[] keyVisibility;
+Key &
+Key::operator= (const Key &other)
+{
+    if (this == &other)
+        return *this;
 
+    if (other.viewing)
+    {
+        setFields (other.row, other.rowLength, other.colFamily,
+                   other.columnFamilyLength, other.colQualifier, other.colQualLen,
+                   other.keyVisibility, other.colVisSize);
+    }
+    else
+    {
+        uint32_t size = other.rowLength + other.columnFamilyLength
+                        + other.colQualLen + other.colVisSize;
+        reserveFields (size);
+        memcpy (fields, other.fields, size);
+        rowLength = other.rowLength;
+        columnFamilyLength = other.columnFamilyLength;
+        colQualLen = other.colQualLen;
+        colVisSize = other.colVisSize;
+        layoutFields ();
+    }
+    timestamp = other.timestamp;
+    deleted = other.deleted;
+    return *this;
 }
 
-void
-Key::setRow (const char *r, uint32_t size)
+Key &
+Key::operator= (Key &&other)
 {
-    if (size > rowMaxSize)
+    if (this == &other)
+        return *this;
+
+    if (other.viewing || other.fields == other.inlineFields)
     {
-        delete[] row;
-        row = new char[size];
-        rowMaxSize = size;
+        *this = other;
+        return *this;
     }
 
-    memcpy (row, r, size);
-    rowLength = size;
-
+    releaseFields ();
+    fields = other.fields;
+    fieldCapacity = other.fieldCapacity;
+    rowLength = other.rowLength;
+    columnFamilyLength = other.columnFamilyLength;
+    colQualLen = other.colQualLen;
+    colVisSize = other.colVisSize;
+    timestamp = other.timestamp;
+    deleted = other.deleted;
+    viewing = false;
+    layoutFields ();
+
+    other.fields = other.inlineFields;
+    other.fieldCapacity = INLINE_FIELD_SIZE;
+    other.rowLength = other.columnFamilyLength = other.colQualLen =
+                          other.colVisSize = 0;
+    other.layoutFields ();
+    return *this;
 }
 
 void
-Key::setColFamily (const char *r, uint32_t size)
+Key::releaseFields ()
 {
-
-    if (size > columnFamilySize)
+    if (fields != inlineFields)
     {
-        delete[] colFamily;
-        colFamily = new char[size];
-        columnFamilySize = size;
+        delete[] fields;
+        fields = inlineFields;
+        fieldCapacity = INLINE_FIELD_SIZE;
     }
+}
 
-    memcpy (colFamily, r, size);
-    columnFamilyLength = size;
+void
+Key::layoutFields ()
+{
+    row = fields;
+    colFamily = row + rowLength;
+    colQualifier = colFamily + columnFamilyLength;
+    keyVisibility = colQualifier + colQualLen;
+}
 
+void
+Key::reserveFields (uint32_t size)
+{
+    if (size > fieldCapacity)
+    {
+        // reused keys grow geometrically
+        uint32_t capacity = std::max (size, fieldCapacity * 2);
+        char *storage = new char[capacity];
+        releaseFields ();
+        fields = storage;
+        fieldCapacity = capacity;
+    }
+    viewing = false;
 }
 
 void
-Key::setColQualifier (const char *r, uint32_t size, uint32_t offset)
+Key::setFields (const char *r, uint32_t rowLen, const char *cf,
+                uint32_t cfLen, const char *cq, uint32_t cqLen, const char *cv,
+                uint32_t cvLen)
 {
-    if (offset + size > colQualSize)
+    uint32_t size = rowLen + cfLen + cqLen + cvLen;
+    const char *storageEnd = fields + fieldCapacity;
+    if (!viewing
+            && ((r >= fields && r < storageEnd) || (cf >= fields && cf < storageEnd)
+                || (cq >= fields && cq < storageEnd)
+                || (cv >= fields && cv < storageEnd)))
     {
-        char *nr = new char[size + offset];
-        memcpy (nr, colQualifier, colQualSize);
-        delete[] colQualifier;
-        colQualifier = nr;
-        colQualSize = size + offset;
+        // the fields may be overwritten as they are copied
+        std::string staged;
+        staged.reserve (size);
+        staged.append (r, rowLen).append (cf, cfLen).append (cq, cqLen).append (
+            cv, cvLen);
+        const char *data = staged.data ();
+        setFields (data, rowLen, data + rowLen, cfLen, data + rowLen + cfLen,
+                   cqLen, data + rowLen + cfLen + cqLen, cvLen);
+        return;
     }
 
-    memcpy (colQualifier + offset, r, size);
-    colQualLen = size + offset;
+    reserveFields (size);
+    rowLength = rowLen;
+    columnFamilyLength = cfLen;
+    colQualLen = cqLen;
+    colVisSize = cvLen;
+    layoutFields ();
+    copyField (row, r, rowLen);
+    copyField (colFamily, cf, cfLen);
+    copyField (colQualifier, cq, cqLen);
+    copyField (keyVisibility, cv, cvLen);
+}
 
+void
+Key::adoptFields (char *buffer, uint32_t capacity, uint32_t rowLen,
+                  uint32_t cfLen, uint32_t cqLen, uint32_t cvLen)
+{
+    if (rowLen + cfLen + cqLen + cvLen > capacity)
+        throw std::runtime_error ("Fields exceed the adopted buffer");
+
+    releaseFields ();
+    fields = buffer;
+    fieldCapacity = capacity;
+    rowLength = rowLen;
+    columnFamilyLength = cfLen;
+    colQualLen = cqLen;
+    colVisSize = cvLen;
+    viewing = false;
+    layoutFields ();
 }
 
 void
-Key::setColVisibility (const char *r, uint32_t size)
+Key::setField (uint32_t index, const char *data, uint32_t size, uint32_t keep)
 {
-    if (size > colVisSize)
+    char *pointers[4] = { row, colFamily, colQualifier, keyVisibility };
+    uint32_t *lengths[4] = { &rowLength, &columnFamilyLength, &colQualLen,
+                             &colVisSize
+                           };
+    uint32_t oldLength = *lengths[index];
+    if (keep > oldLength)
+        keep = oldLength;
+    uint32_t length = keep + size;
+    uint32_t total = rowLength + columnFamilyLength + colQualLen + colVisSize
+                     - oldLength + length;
+
+    if (!viewing && total <= fieldCapacity)
     {
-        delete[] keyVisibility;
-        keyVisibility = new char[size];
-        colVisSize = size;
+        std::string staged;
+        if (data >= fields && data < fields + fieldCapacity)
+        {
+            staged.assign (data, size);
+            data = staged.data ();
+        }
+        // shift the fields that follow in place
+        char *tail = pointers[index] + oldLength;
+        memmove (pointers[index] + length, tail, (keyVisibility + colVisSize) - tail);
+        copyField (pointers[index] + length - size, data, size);
+        *lengths[index] = length;
+        layoutFields ();
+        return;
     }
 
-    memcpy (keyVisibility, r, size);
+    char *storage = fields;
+    uint32_t capacity = fieldCapacity;
+    if (total > fieldCapacity)
+    {
+        capacity = std::max (total, viewing ? total : fieldCapacity * 2);
+        storage = new char[capacity];
+    }
+
+    // views refer to fields outside of the key's storage, hence may be
+    // copied into it directly
+    char *position = storage;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (i == index)
+        {
+            copyField (position, pointers[i], keep);
+            copyField (position + length - size, data, size);
+            position += length;
+        }
+        else
+        {
+            copyField (position, pointers[i], *lengths[i]);
+            position += *lengths[i];
+        }
+    }
 
+    if (storage != fields)
+    {
+        releaseFields ();
+        fields = storage;
+        fieldCapacity = capacity;
+    }
+    *lengths[index] = length;
+    viewing = false;
+    layoutFields ();
+}
+
+void
+Key::setRow (const char *r, uint32_t size)
+{
+    setField (0, r, size, 0);
 }
 
+void
+Key::setColFamily (const char *r, uint32_t size)
+{
+    setField (1, r, size, 0);
+}
+
+void
+Key::setColQualifier (const char *r, uint32_t size, uint32_t offset)
+{
+    setField (2, r, size, offset);
+}
+
+void
+Key::setColVisibility (const char *r, uint32_t size)
+{
+    setField (3, r, size, 0);
+}
+
+
 bool
 Key::operator < (const Key &rhs) const
 {
@@ -134,26 +340,14 @@ Key::operator < (const Key &rhs) const
 bool
 Key::operator == (const Key & rhs) const
 {
-    int compare = compareBytes (row, 0, rowLength, rhs.row, 0,
-                                rhs.columnFamilyLength);
-
-    if (compare != 0)
-        return false;
-
-    compare = compareBytes (colFamily, 0, columnFamilyLength, rhs.colFamily,
-                            0, rhs.columnFamilyLength);
-
-    if (compare != 0)
-        return false;
-
-    compare = compareBytes (colQualifier, 0, colQualLen, rhs.colQualifier, 0,
-                            rhs.colQualLen);
-
-    if (compare != 0)
-        return false;
-
-    return (timestamp < rhs.timestamp);
-
+    return ByteCompare::equals (row, rowLength, rhs.row, rhs.rowLength)
+           && ByteCompare::equals (colFamily, columnFamilyLength, rhs.colFamily,
+                                   rhs.columnFamilyLength)
+           && ByteCompare::equals (colQualifier, colQualLen, rhs.colQualifier,
+                                   rhs.colQualLen)
+           && ByteCompare::equals (keyVisibility, colVisSize, rhs.keyVisibility,
+                                   rhs.colVisSize)
+           && timestamp == rhs.timestamp && deleted == rhs.deleted;
 }
 
 uint64_t
@@ -177,10 +371,18 @@ Key::write (cclient::data::streams::OutputStream *outStream)
     outStream->writeHadoopLong (offset);
     //outStream->writeHadoopLong( offset ); // total
 
-    outStream->writeBytes (row, rowLength);
-    outStream->writeBytes (colFamily, columnFamilyLength);
-    outStream->writeBytes (colQualifier, colQualLen);
-    outStream->writeBytes (keyVisibility, colVisSize);
+    if (viewing)
+    {
+        outStream->writeBytes (row, rowLength);
+        outStream->writeBytes (colFamily, columnFamilyLength);
+        outStream->writeBytes (colQualifier, colQualLen);
+        outStream->writeBytes (keyVisibility, colVisSize);
+    }
+    else
+    {
+        // owned fields are contiguous
+        outStream->writeBytes (row, offset);
+    }
     outStream->writeHadoopLong (timestamp);
     //outStream->writeHadoopLong( timestamp);
 
@@ -190,29 +392,147 @@ Key::write (cclient::data::streams::OutputStream *outStream)
 
 uint64_t
 Key::read (cclient::data::streams::InputStream *in)
+{
+    readFields (in);
+    return in->getPos();
+}
+
+uint64_t
+Key::read (cclient::data::streams::BufferedReader *in)
+{
+    readFields (in);
+    return in->getPos();
+}
+
+template<typename Reader>
+void
+Key::readFields (Reader *in)
 {
     int colFamilyOffset = in->readEncodedLong ();
     int colQualifierOffset = in->readEncodedLong ();
     int colVisibilityOffset = in->readEncodedLong ();
     int totalLen = in->readEncodedLong ();
 
-    row = new char[colFamilyOffset];
-    in->readBytes (row, colFamilyOffset);
+    // the fields are serialized contiguously, as they are held
+    reserveFields (totalLen);
+    rowLength = colFamilyOffset;
+    columnFamilyLength = colQualifierOffset - colFamilyOffset;
+    colQualLen = colVisibilityOffset - colQualifierOffset;
+    colVisSize = totalLen - colVisibilityOffset;
+    layoutFields ();
+    in->readBytes (fields, totalLen);
 
-    colFamily = new char[colQualifierOffset - colFamilyOffset];
-    in->readBytes (colFamily, colQualifierOffset - colFamilyOffset);
+    timestamp = in->readEncodedLong ();
 
-    colQualifier = new char[colVisibilityOffset - colQualifierOffset];
-    in->readBytes (colQualifier, colVisibilityOffset - colQualifierOffset);
+    deleted = in->readBoolean ();
+}
 
-    keyVisibility = new char[totalLen - colVisibilityOffset];
-    in->readBytes (keyVisibility, totalLen - colVisibilityOffset);
+int
+Key::compare (const Key &rhs) const
+{
+    int compare = compareBytes (row, 0, rowLength, rhs.row, 0, rhs.rowLength);
+    if (compare != 0)
+        return compare;
 
-    timestamp = in->readEncodedLong ();
+    compare = compareBytes (colFamily, 0, columnFamilyLength, rhs.colFamily, 0,
+                            rhs.columnFamilyLength);
+    if (compare != 0)
+        return compare;
 
-    deleted = in->readBoolean ();
+    compare = compareBytes (colQualifier, 0, colQualLen, rhs.colQualifier, 0,
+                            rhs.colQualLen);
+    if (compare != 0)
+        return compare;
 
-    return in->getPos();
+    compare = compareBytes (keyVisibility, 0, colVisSize, rhs.keyVisibility, 0,
+                            rhs.colVisSize);
+    if (compare != 0)
+        return compare;
+
+    // newer timestamps sort first
+    if (timestamp != rhs.timestamp)
+        return (int64_t) timestamp > (int64_t) rhs.timestamp ? -1 : 1;
+
+    if (deleted != rhs.deleted)
+        return deleted ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Decodes a hadoop variable length long from a serialized key.
+ * @param pos position, advanced past the long
+ * @param end end of the serialized key
+ * @returns decoded value
+ */
+static inline int64_t
+decodeVLong (const uint8_t *&pos, const uint8_t *end)
+{
+    if (pos >= end)
+        throw std::runtime_error ("Serialized key is truncated");
+    int8_t firstByte = (int8_t) * pos++;
+    if (firstByte >= -112)
+        return firstByte;
+    int len = firstByte < -120 ? -119 - firstByte : -111 - firstByte;
+    if (pos + len - 1 > end)
+        throw std::runtime_error ("Serialized key is truncated");
+    int64_t i = 0;
+    for (int idx = 0; idx < len - 1; ++idx)
+    {
+        i = (i << 8) | *pos++;
+    }
+    bool negative = firstByte < -120 || (firstByte >= -112 && firstByte < 0);
+    return negative ? ~i : i;
+}
+
+int
+Key::compareSerialized (const uint8_t *serialized, size_t len) const
+{
+    const uint8_t *pos = serialized;
+    const uint8_t *end = serialized + len;
+    int64_t colFamilyOffset = decodeVLong (pos, end);
+    int64_t colQualifierOffset = decodeVLong (pos, end);
+    int64_t colVisibilityOffset = decodeVLong (pos, end);
+    int64_t totalLen = decodeVLong (pos, end);
+
+    if (colFamilyOffset < 0 || colQualifierOffset < colFamilyOffset
+            || colVisibilityOffset < colQualifierOffset
+            || totalLen < colVisibilityOffset || pos + totalLen > end)
+        throw std::runtime_error ("Serialized key is malformed");
+
+    const char *fields = (const char*) pos;
+
+    int compare = compareBytes (row, 0, rowLength, fields, 0, colFamilyOffset);
+    if (compare != 0)
+        return compare;
+
+    compare = compareBytes (colFamily, 0, columnFamilyLength, fields,
+                            colFamilyOffset, colQualifierOffset - colFamilyOffset);
+    if (compare != 0)
+        return compare;
+
+    compare = compareBytes (colQualifier, 0, colQualLen, fields,
+                            colQualifierOffset,
+                            colVisibilityOffset - colQualifierOffset);
+    if (compare != 0)
+        return compare;
+
+    compare = compareBytes (keyVisibility, 0, colVisSize, fields,
+                            colVisibilityOffset, totalLen - colVisibilityOffset);
+    if (compare != 0)
+        return compare;
+
+    pos += totalLen;
+    int64_t otherTimestamp = decodeVLong (pos, end);
+    // newer timestamps sort first
+    if ((int64_t) timestamp != otherTimestamp)
+        return (int64_t) timestamp > otherTimestamp ? -1 : 1;
+
+    if (pos >= end)
+        throw std::runtime_error ("Serialized key is truncated");
+    bool otherDeleted = *pos != 0;
+    if (deleted != otherDeleted)
+        return deleted ? -1 : 1;
+    return 0;
 }
 
 } /* namespace data */
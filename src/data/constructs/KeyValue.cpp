@@ -56,7 +56,7 @@ KeyValue::getValue ()
 void
 KeyValue::setValue (std::shared_ptr<Value> v)
 {
-	value->setValue (v->getValue ().first, v->getValue ().second);
+	value->share (*v);
 }
 
 void
@@ -80,9 +80,7 @@ KeyValue::operator= (const KeyValue &other)
 
 	key = other.key;
 
-	std::pair<uint8_t*, uint32_t> p = other.value->getValue ();
-
-	value->setValue (p.first, p.second);
+	value->share (*other.value);
 	return *this;
 }
 
@@ -12,113 +12,166 @@
  * limitations under the License.
  */
 
+#include <utility>
+#include <algorithm>
+
 #include "../../../include/data/constructs/Mutation.h"
-#include "../../../include/data/constructs/../streaming/ByteOutputStream.h"
-#include "../../../include/data/constructs/../streaming/EndianTranslation.h"
+
 namespace cclient
 {
 
 namespace data
 {
 
-Mutation::Mutation (std::string row) :
-    mut_row (row), ptr (0), entries (0)
+using streams::VLongEncoder;
+
+static const size_t MIN_BUFFER_SIZE = 256;
+
+std::string
+MutationBufferPool::acquire (size_t size)
+{
+    // smallest class whose buffers hold size bytes
+    uint8_t sizeClass = size <= MIN_BUFFER_SIZE ? 0 :
+                        64 - __builtin_clzll (size - 1) - MIN_CLASS;
+    std::string buffer;
+    if (sizeClass < SIZE_CLASSES)
+    {
+        {
+            std::lock_guard<std::mutex> lock (poolLock);
+            std::vector<std::string> &free = buffers[sizeClass];
+            if (!free.empty ())
+            {
+                buffer = std::move (free.back ());
+                free.pop_back ();
+                return buffer;
+            }
+        }
+        size = (size_t) 1 << (sizeClass + MIN_CLASS);
+    }
+    buffer.resize (size);
+    return buffer;
+}
+
+void
+MutationBufferPool::release (std::string &&buffer)
+{
+    if (buffer.capacity () < MIN_BUFFER_SIZE)
+        return;
+    buffer.resize (buffer.capacity ());
+    // largest class whose buffers this one can stand in for
+    uint8_t sizeClass = 63 - __builtin_clzll (buffer.size ()) - MIN_CLASS;
+    if (sizeClass >= SIZE_CLASSES)
+        return;
+
+    std::lock_guard<std::mutex> lock (poolLock);
+    std::vector<std::string> &free = buffers[sizeClass];
+    if (free.size () < maxBuffers)
+        free.push_back (std::move (buffer));
+}
+
+Mutation::Mutation (std::string row, MutationBufferPool *pool) :
+    mut_row (std::move (row)), length (0), entries (0), pool (pool)
 {
-    outStream = new streams::ByteOutputStream (1024);
-    endianStream = new streams::EndianTranslationStream (outStream);
-    baseStream = new streams::DataOutputStream (endianStream);
 }
 
 Mutation::~Mutation ()
 {
-    delete baseStream;
-    delete outStream;
-    delete endianStream;
+    if (pool != NULL && !data.empty ())
+        pool->release (std::move (data));
 }
 
 void
-Mutation::put (std::string cf, std::string cq, std::string cv, int64_t ts, bool deleted,
-               uint8_t *value, uint64_t value_len)
+Mutation::grow (size_t size)
 {
-    baseStream->writeVLong (cf.size ());
-    //writeInt(cf.size());
-
-    baseStream->write ((uint8_t*) cf.c_str (), cf.size ());
-    //write((uint8_t*)cf.c_str(),cf.size());
-    baseStream->writeVLong (cq.size ());
-    //writeInt(cq.size());
-    baseStream->write ((uint8_t*) cq.c_str (), cq.size ());
-    //write((uint8_t*)cq.c_str(),cq.size());
-    baseStream->writeVLong (cv.size ());
-//	writeInt(cv.size());
-    baseStream->write ((uint8_t*) cv.c_str (), cv.size ());
-    //write((uint8_t*)cv.c_str(),cv.size());
-    baseStream->writeBoolean (true);
-    //write(true);
-    baseStream->writeVLong (ts);
-    //writeLong(ts);
-    baseStream->writeBoolean (deleted);
-    //write(false);
-    baseStream->writeVLong (value_len);
-    //writeInt(value_len);
-    baseStream->write (value, value_len);
-    //write(value,value_len);
-    entries++;
+    size_t required = std::max (
+                          std::max (length + size, data.size () * 2), MIN_BUFFER_SIZE);
+    if (pool != NULL)
+    {
+        std::string larger = pool->acquire (required);
+        if (length > 0)
+            memcpy (&larger[0], data.data (), length);
+        if (!data.empty ())
+            pool->release (std::move (data));
+        data = std::move (larger);
+    }
+    else
+    {
+        data.resize (required);
+    }
+}
 
+std::string
+Mutation::releaseData ()
+{
+    data.resize (length);
+    std::string released = std::move (data);
+    data = std::string ();
+    length = 0;
+    return released;
 }
 
 void
-Mutation::put (std::string cf, std::string cq, std::string cv, int64_t ts, bool deleted)
+Mutation::restoreData (std::string &&buffer)
 {
-    baseStream->writeVLong (cf.size ());
-    //writeInt(cf.size());
-
-    baseStream->write ((uint8_t*) cf.c_str (), cf.size ());
-    //write((uint8_t*)cf.c_str(),cf.size());
-    baseStream->writeVLong (cq.size ());
-    //writeInt(cq.size());
-    baseStream->write ((uint8_t*) cq.c_str (), cq.size ());
-    //write((uint8_t*)cq.c_str(),cq.size());
-    baseStream->writeVLong (cv.size ());
-//	writeInt(cv.size());
-    baseStream->write ((uint8_t*) cv.c_str (), cv.size ());
-    //write((uint8_t*)cv.c_str(),cv.size());
-    baseStream->writeBoolean (true);
-    //write(true);
-    baseStream->writeVLong (ts);
-    //writeLong(ts);
-    baseStream->writeBoolean (deleted);
-    //write(false);
-    baseStream->writeVLong (0);
+    data = std::move (buffer);
+    length = data.size ();
+}
 
+void
+Mutation::put (const char *cf, size_t cfLen, const char *cq, size_t cqLen,
+               const char *cv, size_t cvLen, int64_t ts, bool deleted,
+               const uint8_t *value, uint64_t value_len)
+{
+    // five variable length longs and two booleans surround the fields
+    reserve (cfLen + cqLen + cvLen + value_len + 5 * VLongEncoder::MAX_LENGTH
+             + 2);
+    char *out = &data[length];
+    out += VLongEncoder::encode (out, cfLen);
+    memcpy (out, cf, cfLen);
+    out += cfLen;
+    out += VLongEncoder::encode (out, cqLen);
+    memcpy (out, cq, cqLen);
+    out += cqLen;
+    out += VLongEncoder::encode (out, cvLen);
+    memcpy (out, cv, cvLen);
+    out += cvLen;
+    // the update has a timestamp
+    *out++ = 1;
+    out += VLongEncoder::encode (out, ts);
+    *out++ = deleted ? 1 : 0;
+    out += VLongEncoder::encode (out, value_len);
+    if (value_len > 0)
+    {
+        memcpy (out, value, value_len);
+        out += value_len;
+    }
+    length = out - data.data ();
     entries++;
+}
 
+void
+Mutation::put (const std::string &cf, const std::string &cq,
+               const std::string &cv, int64_t ts, bool deleted, uint8_t *value,
+               uint64_t value_len)
+{
+    put (cf.c_str (), cf.size (), cq.c_str (), cq.size (), cv.c_str (),
+         cv.size (), ts, deleted, value, value_len);
 }
 
 void
-Mutation::put (std::string cf, std::string cq, std::string cv, unsigned long ts)
+Mutation::put (const std::string &cf, const std::string &cq,
+               const std::string &cv, int64_t ts, bool deleted)
 {
-  baseStream->writeVLong (cf.size ());
-    //writeInt(cf.size());
-
-    baseStream->write ((uint8_t*) cf.c_str (), cf.size ());
-    //write((uint8_t*)cf.c_str(),cf.size());
-    baseStream->writeVLong (cq.size ());
-    //writeInt(cq.size());
-    baseStream->write ((uint8_t*) cq.c_str (), cq.size ());
-    //write((uint8_t*)cq.c_str(),cq.size());
-    baseStream->writeVLong (cv.size ());
-//	writeInt(cv.size());
-    baseStream->write ((uint8_t*) cv.c_str (), cv.size ());
-    //write((uint8_t*)cv.c_str(),cv.size());
-    baseStream->writeBoolean (true);
-    //write(true);
-    baseStream->writeVLong (ts);
-    //writeLong(ts);
-    baseStream->writeBoolean (false);
-    //write(false);
-    baseStream->writeVLong (0);
-    entries++;
+    put (cf.c_str (), cf.size (), cq.c_str (), cq.size (), cv.c_str (),
+         cv.size (), ts, deleted);
+}
+
+void
+Mutation::put (const std::string &cf, const std::string &cq,
+               const std::string &cv, unsigned long ts)
+{
+    put (cf.c_str (), cf.size (), cq.c_str (), cq.size (), cv.c_str (),
+         cv.size (), ts, false);
 }
 
 }
@@ -0,0 +1,76 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include "../../../include/data/constructs/ScanArena.h"
+
+namespace cclient
+{
+namespace data
+{
+
+static const size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+ScanArena::ScanArena (size_t chunkSize) :
+    position (NULL), remaining (0), nextChunkSize (
+        std::max (chunkSize, (size_t) 64)), capacity (0)
+{
+}
+
+ScanArena::~ScanArena ()
+{
+    for (char *chunk : chunks)
+    {
+        delete[] chunk;
+    }
+}
+
+void *
+ScanArena::allocate (size_t size, size_t alignment)
+{
+    size_t padding = (alignment - ((uintptr_t) position & (alignment - 1)))
+                     & (alignment - 1);
+    if (position == NULL || padding + size > remaining)
+    {
+        // chunks from new[] are suitably aligned for any fundamental type
+        size_t chunkSize = std::max (nextChunkSize, size);
+        char *chunk = new char[chunkSize];
+        chunks.push_back (chunk);
+        capacity += chunkSize;
+        position = chunk;
+        remaining = chunkSize;
+        padding = 0;
+        if (nextChunkSize < MAX_CHUNK_SIZE)
+            nextChunkSize = std::min (nextChunkSize * 2, MAX_CHUNK_SIZE);
+    }
+
+    char *memory = position + padding;
+    position = memory + size;
+    remaining -= padding + size;
+    return memory;
+}
+
+char *
+ScanArena::copy (const char *data, size_t len)
+{
+    char *bytes = static_cast<char*> (allocate (len, 1));
+    if (len > 0)
+        memcpy (bytes, data, len);
+    return bytes;
+}
+
+}
+}
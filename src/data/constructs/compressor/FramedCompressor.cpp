@@ -0,0 +1,160 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+
+#include "../../../../include/data/constructs/compressor/framedCompressor.h"
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+namespace {
+
+/**
+ * Scratch space of the calling thread, which only grows.
+ */
+char *
+scratch (size_t size)
+{
+    static thread_local std::vector<char> buffer;
+    if (buffer.size () < size)
+        buffer.resize (size);
+    return buffer.data ();
+}
+
+inline void
+writeLength (char *out, uint32_t length)
+{
+    out[0] = (char) (length >> 24);
+    out[1] = (char) (length >> 16);
+    out[2] = (char) (length >> 8);
+    out[3] = (char) length;
+}
+
+inline uint32_t
+readLength (const char *&in, const char *end)
+{
+    if (end - in < 4)
+        throw std::runtime_error ("Failure during decompression; truncated block");
+    const uint8_t *p = (const uint8_t*) in;
+    in += 4;
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16)
+           | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+}
+
+void
+FramedCompressor::compress (cclient::data::streams::OutputStream *out_stream)
+{
+    if (len == 0)
+        return;
+
+    const char *in = buffer + off;
+    // hadoop leaves room for the codec's overhead in its buffer
+    const uint32_t maxInput = bufferSize - getCompressionOverHead ();
+
+    rawSize += len;
+    total_out = 0;
+
+    for (uint32_t pos = 0; pos < len;)
+    {
+        uint32_t chunk = len - pos < maxInput ? len - pos : maxInput;
+        char *out = scratch (8 + maxCompressedLength (chunk));
+        size_t compressed = compressChunk (in + pos, chunk, out + 8);
+        // each chunk is written as a block of its own
+        writeLength (out, chunk);
+        writeLength (out + 4, compressed);
+        out_stream->write (out, 8 + compressed);
+        total_out += 8 + compressed;
+        pos += chunk;
+    }
+
+    buffer = NULL;
+    len = 0;
+}
+
+void
+FramedCompressor::decompressBlock (const char *&in, const char *end, char *out,
+                                   uint32_t raw)
+{
+    uint32_t produced = 0;
+    while (produced < raw)
+    {
+        uint32_t compressed = readLength (in, end);
+        if ((size_t) (end - in) < compressed)
+            throw std::runtime_error ("Failure during decompression; truncated block");
+        produced += decompressChunk (in, compressed, out + produced,
+                                     raw - produced);
+        in += compressed;
+    }
+}
+
+void
+FramedCompressor::decompress (cclient::data::streams::OutputStream *out_stream)
+{
+    if (len == 0)
+        return;
+
+    const char *in = buffer + off;
+    const char *end = in + len;
+
+    rawSize += len;
+
+    while (in < end)
+    {
+        uint32_t raw = readLength (in, end);
+        char *out = scratch (raw);
+        decompressBlock (in, end, out, raw);
+        out_stream->write (out, raw);
+        total_out += raw;
+    }
+
+    buffer = NULL;
+    len = 0;
+}
+
+size_t
+FramedCompressor::decompress (char *out, size_t capacity)
+{
+    if (len == 0)
+        return 0;
+
+    const char *in = buffer + off;
+    const char *end = in + len;
+
+    rawSize += len;
+
+    size_t produced = 0;
+    while (in < end)
+    {
+        uint32_t raw = readLength (in, end);
+        if (capacity - produced < raw)
+            throw std::runtime_error ("Decompressed data exceeds its expected size");
+        decompressBlock (in, end, out + produced, raw);
+        produced += raw;
+    }
+    total_out += produced;
+
+    buffer = NULL;
+    len = 0;
+
+    return produced;
+}
+
+}
+}
+}
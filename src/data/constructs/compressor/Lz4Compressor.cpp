@@ -0,0 +1,55 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../../../include/data/constructs/compressor/lz4Compressor.h"
+
+#ifdef HAVE_LZ4
+
+#include <stdexcept>
+#include <lz4.h>
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+size_t
+Lz4Compressor::maxCompressedLength (size_t length)
+{
+    return LZ4_compressBound (length);
+}
+
+size_t
+Lz4Compressor::compressChunk (const char *in, size_t length, char *out)
+{
+    int compressed = LZ4_compress_default (in, out, length,
+                                           LZ4_compressBound (length));
+    if (compressed <= 0)
+        throw std::runtime_error ("Failure during compression");
+    return compressed;
+}
+
+size_t
+Lz4Compressor::decompressChunk (const char *in, size_t length, char *out,
+                                size_t capacity)
+{
+    int uncompressed = LZ4_decompress_safe (in, out, length, capacity);
+    if (uncompressed < 0)
+        throw std::runtime_error ("Failure during decompression");
+    return uncompressed;
+}
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../../../include/data/constructs/compressor/snappyCompressor.h"
+
+#ifdef HAVE_SNAPPY
+
+#include <stdexcept>
+#include <snappy.h>
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+size_t
+SnappyCompressor::maxCompressedLength (size_t length)
+{
+    return snappy::MaxCompressedLength (length);
+}
+
+size_t
+SnappyCompressor::compressChunk (const char *in, size_t length, char *out)
+{
+    size_t compressed = 0;
+    snappy::RawCompress (in, length, out, &compressed);
+    return compressed;
+}
+
+size_t
+SnappyCompressor::decompressChunk (const char *in, size_t length, char *out,
+                                   size_t capacity)
+{
+    size_t uncompressed = 0;
+    if (!snappy::GetUncompressedLength (in, length, &uncompressed))
+        throw std::runtime_error ("Failure during decompression");
+    if (uncompressed > capacity)
+        throw std::runtime_error ("Decompressed data exceeds its expected size");
+    if (!snappy::RawUncompress (in, length, out))
+        throw std::runtime_error ("Failure during decompression");
+    return uncompressed;
+}
+
+}
+}
+}
+
+#endif
@@ -39,6 +39,90 @@ namespace cclient{
  * Compression method.
  * @param out_stream.
  */
+ZLibContext::ZLibContext () :
+    deflaterInitialized (false), inflaterInitialized (false)
+{
+#ifdef HAVE_LIBDEFLATE
+    blockInflater = NULL;
+#endif
+}
+
+ZLibContext::~ZLibContext ()
+{
+    if (deflaterInitialized)
+        deflateEnd (&deflater);
+    if (inflaterInitialized)
+        inflateEnd (&inflater);
+#ifdef HAVE_LIBDEFLATE
+    if (blockInflater != NULL)
+        libdeflate_free_decompressor (blockInflater);
+#endif
+}
+
+z_stream *
+ZLibContext::getDeflater ()
+{
+    if (deflaterInitialized)
+    {
+        // keeps the allocated state and the compression level
+        if (deflateReset (&deflater) != Z_OK)
+            throw std::runtime_error ("Failure resetting compression");
+        return &deflater;
+    }
+
+    deflater.zalloc = (alloc_func) 0;
+    deflater.zfree = (free_func) 0;
+    deflater.opaque = (voidpf) 0;
+
+    if (deflateInit(&deflater, 6) != Z_OK)
+        throw std::runtime_error ("Failure initializing compression");
+    deflaterInitialized = true;
+    return &deflater;
+}
+
+z_stream *
+ZLibContext::getInflater ()
+{
+    if (inflaterInitialized)
+    {
+        if (inflateReset (&inflater) != Z_OK)
+            throw std::runtime_error ("Failure resetting decompression");
+        return &inflater;
+    }
+
+    inflater.zalloc = (alloc_func) 0;
+    inflater.zfree = (free_func) 0;
+    inflater.opaque = (voidpf) 0;
+    inflater.next_in = Z_NULL;
+    inflater.avail_in = 0;
+
+    if (inflateInit(&inflater) != Z_OK)
+        throw std::runtime_error ("Failure initializing decompression");
+    inflaterInitialized = true;
+    return &inflater;
+}
+
+#ifdef HAVE_LIBDEFLATE
+struct libdeflate_decompressor *
+ZLibContext::getBlockInflater ()
+{
+    if (blockInflater == NULL)
+    {
+        blockInflater = libdeflate_alloc_decompressor ();
+        if (blockInflater == NULL)
+            throw std::runtime_error ("Failure initializing decompression");
+    }
+    return blockInflater;
+}
+#endif
+
+ZLibContext &
+ZLibContext::local ()
+{
+    static thread_local ZLibContext context;
+    return context;
+}
+
 void
 ZLibCompressor::compress (cclient::data::streams::OutputStream *out_stream)
 {
@@ -49,86 +133,40 @@ ZLibCompressor::compress (cclient::data::streams::OutputStream *out_stream)
     if (len == 0)
         return;
 
-    // variable used for the return code.
-    int r = 0;
-
-
-    c_stream.zalloc = (alloc_func) 0;
-    c_stream.zfree = (free_func) 0;
-    c_stream.opaque = (voidpf) 0;
-
-    r = deflateInit(&c_stream, 6);
-    if (r != Z_OK)
-        throw std::runtime_error ("Failure initializing compression");
+    ZLibContext &context = ZLibContext::local ();
+    z_stream *c_stream = context.getDeflater ();
 
     rawSize += len;
-    // estimate the output buffer.
-    output_length = len + len / 1000 + 12 + 1;
-
-    out_buf = new Bytef[output_length];
+    // the bound guarantees that a single call completes the stream
+    output_length = deflateBound (c_stream, len);
 
-    in_buf = new Bytef[len];
-    memcpy (in_buf, buffer + off, len);
-    delete[] buffer;
-    buffer = NULL;
+    Bytef *out_buf = context.getScratch (output_length);
 
-    c_stream.next_in = in_buf;
-    c_stream.next_out = out_buf;
-    c_stream.avail_in = len;
-    c_stream.avail_out = output_length;
-    c_stream.total_in = 0;
-    c_stream.total_out = 0;
-    total_out = 0;
-
-    /*
-     * Attempt to go through all input data. we know we have enough
-     * length in the out_buf to compress the data, so we will go through
-     * as many attempts at compression as the compressor will allow.
-     */
-    while (c_stream.total_in < len && c_stream.total_out < output_length)
-    {
+    // compress directly from the caller's buffer
+    c_stream->next_in = (Bytef*) (buffer + off);
+    c_stream->avail_in = len;
+    c_stream->next_out = out_buf;
+    c_stream->avail_out = output_length;
 
-        r = deflate (&c_stream, Z_NO_FLUSH);
-        if (r != Z_OK)
-            throw std::runtime_error ("Failure during compression; r != Z_OK");
-    }
-    // finish compression.
-    r = deflate (&c_stream, Z_FINISH);
+    int r = deflate (c_stream, Z_FINISH);
 
-    if (r == Z_STREAM_END)
-    {
-        // if we have successful compression, write the data
-        // to the output stream. and increment total_out.
-        out_stream->write ((const char*) out_buf, c_stream.total_out);
-
-        total_out += c_stream.total_out;
-    }
-    else
+    if (r != Z_STREAM_END)
     {
         throw std::runtime_error (
             "Failure during compression; r != Z_STREAM_END");
     }
 
-    len = 0;
-    // delete the output buffer and end compression.
-    delete[] out_buf;
-    delete[] in_buf;
+    // if we have successful compression, write the data
+    // to the output stream. and increment total_out.
+    out_stream->write ((const char*) out_buf, c_stream->total_out);
 
-    deflateEnd (&c_stream);
-    len = 0;
+    total_out = c_stream->total_out;
 
-}
+    buffer = NULL;
+    len = 0;
 
-#define CHECK_ERR(err, msg) { \
-    if (err != Z_OK) { \
-        throw std::runtime_error ("Failure during decompression"); \
-    } \
 }
 
-/**
- * Deompression method.
- * @param out_stream.
- */
 void
 ZLibCompressor::decompress (cclient::data::streams::OutputStream *out_stream)
 {
@@ -139,101 +177,108 @@ ZLibCompressor::decompress (cclient::data::streams::OutputStream *out_stream)
     if (len == 0)
         return;
 
+    ZLibContext &context = ZLibContext::local ();
+    z_stream *c_stream = context.getInflater ();
 
-    // variable used for the return code.
-    int r = 0;
+    rawSize += len;
 
+    output_length = len + len / 1000 + 12 + 1;
 
-    c_stream.zalloc = (alloc_func) 0;
-    c_stream.zfree = (free_func) 0;
-    c_stream.opaque = (voidpf) 0;
+    Bytef *out_buf = context.getScratch (output_length);
 
-    r = inflateInit(&c_stream);
-    if (r != Z_OK)
-        throw std::runtime_error ("Failure initializing compression");
+    c_stream->next_in = (Bytef*) (buffer + off);
+    c_stream->avail_in = len;
 
-    rawSize += len;
-    // estimate the output buffer.
+    int ret = Z_OK;
+    do
+    {
+        c_stream->avail_out = output_length;
+        c_stream->next_out = out_buf;
 
-    output_length = len + len / 1000 + 12 + 1;
+        ret = inflate (c_stream, Z_NO_FLUSH);
 
-    out_buf = new Bytef[output_length];
+        if (ret != Z_OK && ret != Z_STREAM_END)
+            throw std::runtime_error ("Failure during decompression");
 
-    in_buf = new Bytef[len];
-    memcpy (in_buf, buffer + off, len);
-    delete[] buffer;
-    buffer = NULL;
+        out_stream->write ((const char*) out_buf,
+                           output_length - c_stream->avail_out);
 
-    c_stream.next_in = in_buf;
-    c_stream.next_out = out_buf;
-    c_stream.avail_in = len;
-    c_stream.avail_out = output_length;
-    c_stream.total_in = 0;
-    c_stream.total_out = 0;
-    total_out = 0;
-    int ret = 0;
-    int err = 0;
-    int have = 0;
-    for(uint32_t i=0; i <  len; i += output_length)
-    {
-        c_stream.avail_in = len - i;
-        c_stream.next_in = in_buf + i;
+    }
+    while (ret == Z_OK && (c_stream->avail_out == 0 || c_stream->avail_in > 0));
 
-        do {
-            have =0;
-            c_stream.avail_out = output_length;       // H
-            c_stream.next_out = out_buf;
+    // input that ends before the stream does is truncated
+    if (ret != Z_STREAM_END)
+        throw std::runtime_error ("Compressed data is truncated");
 
-            ret = inflate(&c_stream, Z_NO_FLUSH);  // I
+    total_out += c_stream->total_out;
 
-            assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-            switch (ret) {
-            case Z_NEED_DICT:
-                ret = Z_DATA_ERROR;     /* and fall through */
-            case Z_DATA_ERROR:
-            case Z_MEM_ERROR:
+    buffer = NULL;
+    len = 0;
 
-                (void)inflateEnd(&c_stream);
-                CHECK_ERR(err, "Z_MEM_ERROR");
-            }
+}
+
+size_t
+ZLibCompressor::decompress (char *out, size_t capacity)
+{
+    if (!init)
+        throw std::runtime_error (
+            "Failure during compression; compression not initialized");
 
-            have = output_length - c_stream.avail_out;     // J
-            out_stream->write ((const char*) out_buf,have);
+    if (len == 0)
+        return 0;
 
-        } while (c_stream.avail_out == 0);         // K
+    rawSize += len;
+
+#ifdef HAVE_LIBDEFLATE
+    size_t inflated = 0;
+    switch (libdeflate_zlib_decompress (ZLibContext::local ().getBlockInflater (),
+                                        buffer + off, len, out, capacity,
+                                        &inflated))
+    {
+    case LIBDEFLATE_SUCCESS:
+        break;
+    case LIBDEFLATE_INSUFFICIENT_SPACE:
+        throw std::runtime_error ("Decompressed data exceeds its expected size");
+    default:
+        throw std::runtime_error ("Failure during decompression");
     }
-    total_out += c_stream.total_out;
-    err = inflateEnd(&c_stream);
-
-
-    /*
-      // finish compression.
-      r = inflate (&c_stream, Z_FINISH);
-
-      if (r == Z_STREAM_END)
-        {
-          // if we have successful compression, write the data
-          // to the output stream. and increment total_out.
-          out_stream->write ((const char*) out_buf, c_stream.total_out);
-
-          total_out += c_stream.total_out;
-        }
-      else
-        {
-          throw std::runtime_error (
-    	  "Failure during compression; r != Z_STREAM_END");
-        }
-    */
+    if (inflated != capacity)
+        throw std::runtime_error ("Decompressed data is shorter than its expected size");
+
+    total_out += inflated;
+
+    buffer = NULL;
     len = 0;
-    // delete the output buffer and end compression.
-    delete[] out_buf;
-    delete[] in_buf;
 
+    return inflated;
+#else
+    z_stream *c_stream = ZLibContext::local ().getInflater ();
+
+    // inflate straight into the caller's buffer
+    c_stream->next_in = (Bytef*) (buffer + off);
+    c_stream->avail_in = len;
+    c_stream->next_out = (Bytef*) out;
+    c_stream->avail_out = capacity;
+
+    int ret = inflate (c_stream, Z_FINISH);
 
+    // truncated input also ends in Z_BUF_ERROR, with output space left
+    if (ret == Z_BUF_ERROR && c_stream->avail_out == 0)
+        throw std::runtime_error ("Decompressed data exceeds its expected size");
+    if (ret != Z_STREAM_END)
+        throw std::runtime_error ("Failure during decompression");
+    if (c_stream->total_out != capacity)
+        throw std::runtime_error ("Decompressed data is shorter than its expected size");
+
+    total_out += c_stream->total_out;
+
+    buffer = NULL;
     len = 0;
 
+    return c_stream->total_out;
+#endif
 }
-     
+
     }
     
   }
@@ -0,0 +1,177 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../../../../include/data/constructs/compressor/zstdCompressor.h"
+
+#ifdef HAVE_ZSTD
+
+#include <stdexcept>
+#include <vector>
+#include <zstd.h>
+
+namespace cclient {
+namespace data {
+namespace compression {
+
+namespace {
+
+/**
+ * zstd contexts and scratch space kept by each thread.
+ */
+class ZstdContext
+{
+public:
+    ZstdContext () :
+        cctx (ZSTD_createCCtx ()), dctx (ZSTD_createDCtx ())
+    {
+    }
+
+    ~ZstdContext ()
+    {
+        ZSTD_freeCCtx (cctx);
+        ZSTD_freeDCtx (dctx);
+    }
+
+    ZSTD_DCtx *
+    getDecompressor ()
+    {
+        ZSTD_DCtx_reset (dctx, ZSTD_reset_session_only);
+        return dctx;
+    }
+
+    char *
+    getScratch (size_t size)
+    {
+        if (scratch.size () < size)
+            scratch.resize (size);
+        return scratch.data ();
+    }
+
+    static ZstdContext &
+    local ()
+    {
+        static thread_local ZstdContext context;
+        return context;
+    }
+
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+    std::vector<char> scratch;
+};
+
+}
+
+void
+ZstdCompressor::compress (cclient::data::streams::OutputStream *out_stream)
+{
+    if (len == 0)
+        return;
+
+    ZstdContext &context = ZstdContext::local ();
+    size_t bound = ZSTD_compressBound (len);
+    char *out = context.getScratch (bound);
+
+    size_t compressed = ZSTD_compressCCtx (context.cctx, out, bound,
+                                           buffer + off, len, level);
+    if (ZSTD_isError (compressed))
+        throw std::runtime_error ("Failure during compression");
+
+    out_stream->write (out, compressed);
+
+    rawSize += len;
+    total_out = compressed;
+
+    buffer = NULL;
+    len = 0;
+}
+
+void
+ZstdCompressor::decompress (cclient::data::streams::OutputStream *out_stream)
+{
+    if (len == 0)
+        return;
+
+    ZstdContext &context = ZstdContext::local ();
+    ZSTD_DCtx *dctx = context.getDecompressor ();
+    size_t chunk = ZSTD_DStreamOutSize ();
+    char *out = context.getScratch (chunk);
+
+    rawSize += len;
+
+    ZSTD_inBuffer input = { buffer + off, len, 0 };
+    size_t remaining = 1;
+    // a block may hold several frames
+    while (input.pos < input.size || remaining != 0)
+    {
+        ZSTD_outBuffer output = { out, chunk, 0 };
+        remaining = ZSTD_decompressStream (dctx, &output, &input);
+        if (ZSTD_isError (remaining))
+            throw std::runtime_error ("Failure during decompression");
+        out_stream->write (out, output.pos);
+        total_out += output.pos;
+        if (output.pos == 0 && input.pos == input.size)
+            break;
+    }
+    if (remaining != 0)
+        throw std::runtime_error ("Compressed data is truncated");
+
+    buffer = NULL;
+    len = 0;
+}
+
+size_t
+ZstdCompressor::decompress (char *out, size_t capacity)
+{
+    if (len == 0)
+        return 0;
+
+    ZSTD_DCtx *dctx = ZstdContext::local ().getDecompressor ();
+
+    rawSize += len;
+
+    ZSTD_inBuffer input = { buffer + off, len, 0 };
+    ZSTD_outBuffer output = { out, capacity, 0 };
+    size_t remaining = 0;
+    do
+    {
+        size_t consumed = input.pos;
+        size_t produced = output.pos;
+        remaining = ZSTD_decompressStream (dctx, &output, &input);
+        if (ZSTD_isError (remaining))
+            throw std::runtime_error ("Failure during decompression");
+        if (input.pos == consumed && output.pos == produced)
+            break;
+    }
+    while (input.pos < input.size || remaining != 0);
+    // a full buffer with a frame still in progress cannot hold the block
+    if (output.pos == output.size && (remaining != 0 || input.pos < input.size))
+        throw std::runtime_error ("Decompressed data exceeds its expected size");
+    if (remaining != 0)
+        throw std::runtime_error ("Compressed data is truncated");
+    if (input.pos < input.size)
+        throw std::runtime_error ("Failure during decompression");
+    if (output.pos != capacity)
+        throw std::runtime_error ("Decompressed data is shorter than its expected size");
+    total_out += output.pos;
+
+    buffer = NULL;
+    len = 0;
+
+    return output.pos;
+}
+
+}
+}
+}
+
+#endif
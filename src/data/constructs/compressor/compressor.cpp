@@ -21,17 +21,24 @@
 
 
 #include "../../../../include/data/constructs/compressor/compressor.h"
+#include "../../../../include/data/streaming/ByteOutputStream.h"
 
 
 void
 cclient::data::compression::Compressor::setInput (const char *b, uint32_t offset, uint32_t length)
 {
-//  std::cout << "buffer address is " << buffer << std::endl;
-
-    if (buffer != NULL)
-        delete[] buffer;
-    buffer = new char[length];
-    memcpy (buffer, b, length);
+    buffer = b;
     off = offset;
     len = length;
 }
+
+size_t
+cclient::data::compression::Compressor::decompress (char *out, size_t capacity)
+{
+    cclient::data::streams::ByteOutputStream outStream (capacity);
+    decompress (&outStream);
+    if (outStream.getPos () > capacity)
+        throw std::runtime_error ("Decompressed data exceeds its expected size");
+    memcpy (out, outStream.getByteArray (), outStream.getPos ());
+    return outStream.getPos ();
+}
@@ -0,0 +1,545 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <queue>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "../../../../include/data/constructs/rfile/BulkRFileBuilder.h"
+#include "../../../../include/data/constructs/rfile/LocalRFile.h"
+#include "../../../../include/data/streaming/ByteOutputStream.h"
+#include "../../../../include/data/streaming/input/BufferedReader.h"
+
+namespace cclient
+{
+namespace data
+{
+
+// raw bytes of a run compressed together
+#define RUN_CHUNK_SIZE (1024 * 1024)
+
+// memory held by an entry beyond its fields: the key value, key and
+// value objects along with their control blocks
+#define ENTRY_OVERHEAD 192
+
+/**
+ * Writes entries to a run as a series of compressed chunks, each
+ * preceded by its raw and compressed sizes.
+ */
+class BulkRFileBuilder::RunWriter
+{
+public:
+
+    RunWriter (const std::string &name, compression::Compressor *compressor) :
+        file (name, std::ofstream::out | std::ofstream::binary
+              | std::ofstream::trunc), compressor (compressor), raw (
+                  RUN_CHUNK_SIZE + 4096)
+    {
+        if (!file)
+            throw std::runtime_error ("Could not open run " + name);
+    }
+
+    void
+    append (KeyValue *kv)
+    {
+        kv->getKey ()->write (&raw);
+        kv->getValue ()->write (&raw);
+        if (raw.getPos () >= RUN_CHUNK_SIZE)
+            flushChunk ();
+    }
+
+    void
+    close ()
+    {
+        flushChunk ();
+        file.close ();
+        if (file.fail ())
+            throw std::runtime_error ("Failure writing run");
+    }
+
+protected:
+
+    void
+    flushChunk ()
+    {
+        if (raw.getPos () == 0)
+            return;
+
+        streams::ByteOutputStream compressed (
+            raw.getPos () + compressor->getCompressionOverHead ());
+        compressor->setInput (raw.getByteArray (), 0, raw.getPos ());
+        compressor->compress (&compressed);
+
+        streams::BigEndianByteStream header (8);
+        header.writeInt (raw.getPos ());
+        header.writeInt (compressed.getPos ());
+        file.write (header.getByteArray (), header.getPos ());
+        file.write (compressed.getByteArray (), compressed.getPos ());
+        if (file.fail ())
+            throw std::runtime_error ("Failure writing run");
+        // no stream is attached, so this only resets the buffer
+        raw.flush ();
+    }
+
+    std::ofstream file;
+    compression::Compressor *compressor;
+    streams::BigEndianByteStream raw;
+};
+
+/**
+ * Reads the entries of a run in order.
+ */
+class BulkRFileBuilder::RunReader
+{
+public:
+
+    RunReader (const std::string &name, compression::Compressor *compressor,
+               size_t index) :
+        file (name, std::ifstream::in | std::ifstream::binary), compressor (
+            compressor), index (index)
+    {
+        if (!file)
+            throw std::runtime_error ("Could not open run " + name);
+    }
+
+    /**
+     Advances to the next entry.
+     @return false once the run is exhausted.
+     **/
+    bool
+    next ()
+    {
+        if (reader.remaining () == 0 && !readChunk ())
+        {
+            current = NULL;
+            return false;
+        }
+        std::shared_ptr<Key> key = std::make_shared<Key> ();
+        key->read (&reader);
+        std::shared_ptr<Value> value = std::make_shared<Value> ();
+        value->read (&reader);
+        current = std::make_shared<KeyValue> ();
+        current->setKey (key, true);
+        current->setValue (value);
+        return true;
+    }
+
+    std::shared_ptr<KeyValue> current;
+    // position of the run, ordering equal keys
+    size_t index;
+
+protected:
+
+    bool
+    readChunk ()
+    {
+        char header[8];
+        file.read (header, sizeof (header));
+        if (file.gcount () == 0 && file.eof ())
+            return false;
+        if (file.gcount () != sizeof (header))
+            throw std::runtime_error ("Run is truncated");
+
+        streams::BufferedReader headerReader (header, sizeof (header));
+        uint32_t rawSize = headerReader.readInt ();
+        uint32_t compressedSize = headerReader.readInt ();
+
+        compressed.resize (compressedSize);
+        file.read (compressed.data (), compressedSize);
+        if ((uint32_t) file.gcount () != compressedSize)
+            throw std::runtime_error ("Run is truncated");
+
+        raw.resize (rawSize);
+        compressor->setInput (compressed.data (), 0, compressedSize);
+        if (compressor->decompress (raw.data (), rawSize) != rawSize)
+            throw std::runtime_error ("Run chunk is shorter than expected");
+        reader.reset (raw.data (), rawSize);
+        return true;
+    }
+
+    std::ifstream file;
+    compression::Compressor *compressor;
+    std::vector<char> compressed;
+    std::vector<char> raw;
+    streams::BufferedReader reader;
+};
+
+uint64_t
+BulkRFileBuilder::getEntrySize (KeyValue *kv)
+{
+    std::shared_ptr<Key> key = kv->getKey ();
+    return key->getRow ().second + key->getColFamily ().second
+           + key->getColQualifier ().second + key->getColVisibility ().second
+           + kv->getValue ()->getValue ().second + ENTRY_OVERHEAD;
+}
+
+static bool
+entryLess (const std::shared_ptr<KeyValue> &a, const std::shared_ptr<KeyValue> &b)
+{
+    return a->getKey ()->compare (*b->getKey ()) < 0;
+}
+
+BulkRFileBuilder::BulkRFileBuilder (const std::string &outputPrefix,
+                                    const std::string &tempDirectory,
+                                    compression::Compressor *compressor,
+                                    uint64_t memoryBudget, uint16_t threads) :
+    outputPrefix (outputPrefix), tempDirectory (tempDirectory), compressor (
+        compressor), targetFileSize (1024 * 1024 * 1024), mergeFanIn (64), threadCount (
+            threads), closed (false), bufferedBytes (0), spilledRuns (0), active (0), stopped (
+                false)
+{
+    if (compressor == NULL)
+        throw std::runtime_error ("Bulk builder requires a compressor");
+    if (threads == 0)
+        throw std::runtime_error ("Bulk builder requires a worker");
+
+    // the buffer being filled and one per worker
+    runBudget = memoryBudget / (threads + 1);
+
+    for (uint16_t i = 0; i < threads; i++)
+    {
+        workers.push_back (std::thread (&BulkRFileBuilder::run, this));
+    }
+}
+
+BulkRFileBuilder::~BulkRFileBuilder ()
+{
+    {
+        std::lock_guard<std::mutex> lock (runLock);
+        pending.clear ();
+    }
+    stopWorkers ();
+    removeRuns ();
+}
+
+void
+BulkRFileBuilder::append (std::shared_ptr<KeyValue> kv)
+{
+    if (closed)
+        throw std::runtime_error ("Bulk builder is closed");
+
+    bufferedBytes += getEntrySize (kv.get ());
+    buffer.push_back (kv);
+    if (bufferedBytes >= runBudget)
+        spill ();
+}
+
+void
+BulkRFileBuilder::spill ()
+{
+    if (buffer.empty ())
+        return;
+
+    std::unique_lock<std::mutex> lock (runLock);
+    runsChanged.wait (lock, [this]
+    {
+        return pending.size () + active < threadCount || error;
+    });
+    if (error)
+        std::rethrow_exception (error);
+
+    runFiles.push_back ("");
+    pending.push_back (std::make_pair (runFiles.size () - 1, std::move (buffer)));
+    buffer.clear ();
+    bufferedBytes = 0;
+    spilledRuns++;
+    runsChanged.notify_all ();
+}
+
+void
+BulkRFileBuilder::run ()
+{
+    std::unique_ptr<compression::Compressor> runCompressor (
+        compressor->newInstance ());
+
+    std::unique_lock<std::mutex> lock (runLock);
+    while (true)
+    {
+        runsChanged.wait (lock, [this]
+        {
+            return stopped || !pending.empty ();
+        });
+        if (pending.empty ())
+            return;
+
+        size_t slot = pending.front ().first;
+        std::vector<std::shared_ptr<KeyValue>> entries = std::move (
+                    pending.front ().second);
+        pending.pop_front ();
+        if (error)
+            continue;
+        active++;
+        lock.unlock ();
+
+        std::string name;
+        std::exception_ptr failure;
+        try
+        {
+            name = writeRun (entries, runCompressor.get ());
+        }
+        catch (...)
+        {
+            failure = std::current_exception ();
+        }
+        // releases the buffer before another may be filled
+        entries.clear ();
+        entries.shrink_to_fit ();
+
+        lock.lock ();
+        active--;
+        if (failure && !error)
+            error = failure;
+        else
+            runFiles.at (slot) = name;
+        runsChanged.notify_all ();
+    }
+}
+
+std::string
+BulkRFileBuilder::writeRun (std::vector<std::shared_ptr<KeyValue>> &entries,
+                            compression::Compressor *runCompressor)
+{
+    // stable, so that equal keys keep the order in which they were added
+    std::stable_sort (entries.begin (), entries.end (), entryLess);
+
+    std::string name = createRunFile ();
+    try
+    {
+        RunWriter writer (name, runCompressor);
+        for (std::shared_ptr<KeyValue> &kv : entries)
+        {
+            writer.append (kv.get ());
+        }
+        writer.close ();
+    }
+    catch (...)
+    {
+        std::remove (name.c_str ());
+        throw;
+    }
+    return name;
+}
+
+struct RunOrder
+{
+    template<typename Reader>
+    bool
+    operator() (Reader *a, Reader *b) const
+    {
+        int cmp = a->current->getKey ()->compare (*b->current->getKey ());
+        if (cmp != 0)
+            return cmp > 0;
+        return a->index > b->index;
+    }
+};
+
+void
+BulkRFileBuilder::merge (const std::vector<std::string> &runs,
+                         const std::function<void (std::shared_ptr<KeyValue>)> &consumer)
+{
+    std::unique_ptr<compression::Compressor> runCompressor (
+        compressor->newInstance ());
+
+    std::vector<std::unique_ptr<RunReader>> readers;
+    std::priority_queue<RunReader*, std::vector<RunReader*>, RunOrder> heap;
+    for (size_t i = 0; i < runs.size (); i++)
+    {
+        readers.push_back (
+            std::unique_ptr<RunReader> (
+                new RunReader (runs.at (i), runCompressor.get (), i)));
+        if (readers.back ()->next ())
+            heap.push (readers.back ().get ());
+    }
+
+    while (!heap.empty ())
+    {
+        RunReader *reader = heap.top ();
+        heap.pop ();
+        consumer (reader->current);
+        if (reader->next ())
+            heap.push (reader);
+    }
+}
+
+void
+BulkRFileBuilder::writeFiles (
+    const std::function<void (const std::function<void (std::shared_ptr<KeyValue>)>&)> &source)
+{
+    std::unique_ptr<LocalRFile> rfile;
+    std::shared_ptr<Key> lastKey;
+
+    source ([&] (std::shared_ptr<KeyValue> kv)
+    {
+        std::shared_ptr<Key> key = kv->getKey ();
+        if (NULL != rfile && rfile->getSize () >= targetFileSize)
+        {
+            std::pair<char*, size_t> row = key->getRow ();
+            std::pair<char*, size_t> lastRow = lastKey->getRow ();
+            // rows are never split across files
+            if (row.second != lastRow.second
+                    || memcmp (row.first, lastRow.first, row.second) != 0)
+            {
+                rfile->close ();
+                rfile.reset ();
+            }
+        }
+
+        if (NULL == rfile)
+        {
+            char sequence[16];
+            snprintf (sequence, sizeof (sequence), "-%05u.rf",
+                      (uint32_t) outputFiles.size ());
+            outputFiles.push_back (outputPrefix + sequence);
+            // the compressor's settings determine the size of data blocks.
+            // blocks are compressed on this thread, so that the size of
+            // the file is known after each append
+            rfile.reset (new LocalRFile (outputFiles.back (), compressor));
+        }
+
+        rfile->append (kv);
+        lastKey = key;
+    });
+
+    if (NULL != rfile)
+        rfile->close ();
+}
+
+std::vector<std::string>
+BulkRFileBuilder::close ()
+{
+    if (closed)
+        return outputFiles;
+    closed = true;
+
+    bool spilled;
+    {
+        std::lock_guard<std::mutex> lock (runLock);
+        spilled = !runFiles.empty ();
+    }
+
+    if (!spilled)
+    {
+        // everything fits in memory, so no runs are needed
+        stopWorkers ();
+        std::stable_sort (buffer.begin (), buffer.end (), entryLess);
+        std::vector<std::shared_ptr<KeyValue>> entries = std::move (buffer);
+        buffer.clear ();
+        writeFiles ([&entries] (const std::function<void (std::shared_ptr<KeyValue>)> &consumer)
+        {
+            for (std::shared_ptr<KeyValue> &kv : entries)
+            {
+                consumer (kv);
+            }
+        });
+        return outputFiles;
+    }
+
+    spill ();
+    stopWorkers ();
+    if (error)
+        std::rethrow_exception (error);
+
+    std::unique_ptr<compression::Compressor> runCompressor (
+        compressor->newInstance ());
+    // each pass merges consecutive groups of runs, so that every entry is
+    // rewritten once per pass. the merged runs keep the order of their
+    // groups, as equal keys are ordered by the position of their run
+    while (runFiles.size () > mergeFanIn)
+    {
+        size_t count = runFiles.size ();
+        std::vector<std::string> pass;
+        for (size_t i = 0; i < count; i += mergeFanIn)
+        {
+            size_t last = std::min (count, i + mergeFanIn);
+            if (last - i == 1)
+            {
+                pass.push_back (runFiles.at (i));
+                continue;
+            }
+            std::vector<std::string> group (runFiles.begin () + i,
+                                            runFiles.begin () + last);
+            // listed before merging, so that it is removed should the
+            // merge fail
+            std::string merged = createRunFile ();
+            runFiles.push_back (merged);
+            pass.push_back (merged);
+            RunWriter writer (merged, runCompressor.get ());
+            merge (group, [&writer] (std::shared_ptr<KeyValue> kv)
+            {
+                writer.append (kv.get ());
+            });
+            writer.close ();
+
+            for (const std::string &name : group)
+            {
+                std::remove (name.c_str ());
+            }
+        }
+        runFiles = std::move (pass);
+    }
+
+    writeFiles ([this] (const std::function<void (std::shared_ptr<KeyValue>)> &consumer)
+    {
+        merge (runFiles, consumer);
+    });
+    removeRuns ();
+    return outputFiles;
+}
+
+void
+BulkRFileBuilder::stopWorkers ()
+{
+    {
+        std::lock_guard<std::mutex> lock (runLock);
+        stopped = true;
+        runsChanged.notify_all ();
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join ();
+    }
+    workers.clear ();
+}
+
+std::string
+BulkRFileBuilder::createRunFile ()
+{
+    std::string pattern = tempDirectory + "/run-XXXXXX";
+    std::vector<char> name (pattern.begin (), pattern.end ());
+    name.push_back ('\0');
+    int descriptor = mkstemp (name.data ());
+    if (descriptor < 0)
+        throw std::runtime_error ("Could not create a run in " + tempDirectory);
+    ::close (descriptor);
+    return std::string (name.data ());
+}
+
+void
+BulkRFileBuilder::removeRuns ()
+{
+    std::lock_guard<std::mutex> lock (runLock);
+    for (const std::string &name : runFiles)
+    {
+        if (!name.empty ())
+            std::remove (name.c_str ());
+    }
+    runFiles.clear ();
+}
+
+}
+}
@@ -0,0 +1,131 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "../../../../include/data/constructs/rfile/LocalRFile.h"
+
+namespace cclient
+{
+namespace data
+{
+
+/**
+ * Buffers the file, writing the buffer out once it fills. Positions are
+ * those within the whole file, which the block regions record.
+ */
+class LocalRFile::FileStream : public streams::BigEndianByteStream
+{
+public:
+
+    FileStream (streams::OutputStream *file, size_t bufferSize) :
+        BigEndianByteStream (bufferSize, file), bufferSize (bufferSize), written (
+            0)
+    {
+    }
+
+    using BigEndianByteStream::write;
+
+    virtual uint64_t
+    write (const char *bytes, long cnt)
+    {
+        ByteOutputStream::write (bytes, cnt);
+        if (offset >= bufferSize)
+            spill ();
+        return getPos ();
+    }
+
+    virtual uint64_t
+    getPos ()
+    {
+        return written + offset;
+    }
+
+    /**
+     Writes the buffered bytes to the file.
+     **/
+    void
+    spill ()
+    {
+        written += offset;
+        flush ();
+    }
+
+protected:
+    size_t bufferSize;
+    // bytes already written to the file
+    uint64_t written;
+};
+
+LocalRFile::LocalRFile (const std::string &name,
+                        compression::Compressor *compressor, size_t bufferSize) :
+    name (name), file (name, std::ofstream::out | std::ofstream::binary
+                       | std::ofstream::trunc), closed (false), size (0)
+{
+    if (!file)
+        throw std::runtime_error ("Could not open " + name);
+
+    fileStream.reset (new streams::OutputStream (&file, 0));
+    outStream.reset (new FileStream (fileStream.get (), bufferSize));
+    bcFile.reset (new BlockCompressedFile (compressor));
+    rfile.reset (new RFile (outStream.get (), bcFile.get ()));
+    rfile->addLocalityGroup ();
+}
+
+LocalRFile::~LocalRFile ()
+{
+    if (!closed)
+    {
+        rfile.reset ();
+        // the buffer would otherwise be written as it is destroyed
+        outStream->setOutputStreamRef (NULL);
+        outStream.reset ();
+        fileStream.reset ();
+        file.close ();
+        // an incomplete file must not be mistaken for an RFile
+        std::remove (name.c_str ());
+    }
+}
+
+uint64_t
+LocalRFile::getSize ()
+{
+    return closed ? size : outStream->getPos ();
+}
+
+void
+LocalRFile::close ()
+{
+    if (closed)
+        return;
+
+    rfile->close ();
+    closed = true;
+    rfile.reset ();
+    bcFile.reset ();
+    size = outStream->getPos ();
+    outStream->spill ();
+    outStream.reset ();
+    fileStream.reset ();
+    file.close ();
+    if (file.fail ())
+    {
+        std::remove (name.c_str ());
+        throw std::runtime_error ("Failure writing " + name);
+    }
+}
+
+}
+}
@@ -0,0 +1,345 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+
+#include "../../../../include/data/constructs/rfile/ParallelScan.h"
+#include "../../../../include/data/streaming/accumulo/StreamSeekable.h"
+
+namespace cclient
+{
+namespace data
+{
+
+namespace
+{
+
+struct IndexWeight
+{
+    std::shared_ptr<Key> key;
+    uint64_t entries;
+};
+
+/**
+ * Gathers the index entries of a block, descending into lower levels
+ * while a level has fewer entries than there are partitions.
+ */
+void
+gatherEntries (std::shared_ptr<IndexManager> manager,
+               std::shared_ptr<IndexBlock> block, uint32_t partitions,
+               std::vector<IndexWeight> *weights)
+{
+    std::shared_ptr<SerializedIndex> index = block->getIndex ();
+    bool descend = block->getLevel () > 0 && index->size () < partitions;
+    for (size_t i = 0; i < index->size (); i++)
+    {
+        std::shared_ptr<IndexEntry> entry = index->get (i);
+        if (descend)
+        {
+            gatherEntries (manager, manager->getIndexBlock (entry), partitions,
+                           weights);
+        }
+        else
+        {
+            IndexWeight weight =
+            { entry->getKey (), entry->getNumEntries () };
+            weights->push_back (weight);
+        }
+    }
+}
+
+}
+
+ParallelScan::ParallelScan (const std::string &file, uint32_t partitions,
+                            uint16_t threads) :
+    region (std::make_shared<cclient::data::streams::MappedRegion> (file)), indexBlockCache (
+        std::make_shared<IndexBlockCache> ()), inclusiveFamilies (false), threadCount (
+            threads == 0 ? 1 : threads)
+{
+    cclient::data::streams::MappedInputStream *stream =
+        new cclient::data::streams::MappedInputStream (region);
+    RFile *rfile = new RFile (stream, region->size ());
+    rfile->setIndexBlockCache (indexBlockCache);
+
+    computeSplits (rfile, partitions);
+
+    delete rfile;
+    delete stream;
+}
+
+ParallelScan::~ParallelScan ()
+{
+}
+
+void
+ParallelScan::computeSplits (RFile *file, uint32_t partitions)
+{
+    splits.clear ();
+    if (partitions <= 1)
+        return;
+
+    std::vector<IndexWeight> weights;
+    for (LocalityGroupMetaData *group : file->getLocalityGroups ())
+    {
+        std::shared_ptr<IndexManager> manager = group->getIndexManager ();
+        if (NULL != manager->getRootIndexBlock ())
+            gatherEntries (manager, manager->getRootIndexBlock (), partitions,
+                           &weights);
+    }
+
+    if (weights.size () < 2)
+        return;
+
+    std::sort (weights.begin (), weights.end (),
+               [] (const IndexWeight &a, const IndexWeight &b)
+    {
+        return a.key->compare (*b.key) < 0;
+    });
+
+    uint64_t total = 0;
+    for (const IndexWeight &weight : weights)
+        total += weight.entries;
+    if (total == 0)
+    {
+        // without entry counts each block is weighed equally
+        for (IndexWeight &weight : weights)
+            weight.entries = 1;
+        total = weights.size ();
+    }
+
+    // a split at the last key would leave the final partition empty
+    uint64_t cumulative = 0;
+    uint32_t nextSplit = 1;
+    for (size_t i = 0; i + 1 < weights.size () && nextSplit < partitions; i++)
+    {
+        cumulative += weights.at (i).entries;
+        if (cumulative * partitions < total * nextSplit)
+            continue;
+        if (splits.empty () || weights.at (i).key->compare (*splits.back ()) > 0)
+            splits.push_back (weights.at (i).key);
+        while (nextSplit < partitions && cumulative * partitions >= total * nextSplit)
+            nextSplit++;
+    }
+}
+
+void
+ParallelScan::scanPartition (uint32_t partition,
+                             const std::function<bool (std::shared_ptr<Key>, Value*)> &emit)
+{
+    std::shared_ptr<Key> lower = partition > 0 ? splits.at (partition - 1) : nullptr;
+    std::shared_ptr<Key> upper =
+        partition < splits.size () ? splits.at (partition) : nullptr;
+
+    cclient::data::streams::MappedInputStream *stream =
+        new cclient::data::streams::MappedInputStream (region);
+    RFile *rfile = new RFile (stream, region->size ());
+    rfile->setIndexBlockCache (indexBlockCache);
+
+    // the stop key is enforced here, so that the range needn't alter it
+    Range *range = NULL != lower ? new Range (lower, false, NULL, false) : new Range ();
+    cclient::data::streams::StreamSeekable seekable (range, columnFamilies,
+            inclusiveFamilies);
+
+    try
+    {
+        rfile->relocate (&seekable);
+        while (rfile->hasNext ())
+        {
+            std::shared_ptr<Key> key = (**rfile).first;
+            if (NULL != upper && key->compare (*upper) > 0)
+                break;
+            if (!emit (key, rfile->getTopValue ()))
+                break;
+            rfile->next ();
+        }
+    }
+    catch (...)
+    {
+        delete rfile;
+        delete stream;
+        delete range;
+        throw;
+    }
+
+    delete rfile;
+    delete stream;
+    delete range;
+}
+
+uint64_t
+ParallelScan::scan (EntryCallback callback, bool ordered)
+{
+    typedef std::vector<std::pair<std::shared_ptr<Key>, std::shared_ptr<Value>>> Batch;
+
+    const uint32_t partitionCount = getPartitionCount ();
+
+    std::mutex scanLock;
+    // signalled when a batch is queued or a partition completes
+    std::condition_variable produced;
+    // signalled when a batch is taken from a queue
+    std::condition_variable consumed;
+    std::exception_ptr error;
+    std::atomic<bool> failed (false);
+    std::atomic<uint64_t> delivered (0);
+
+    uint32_t nextPartition = 0;
+    // partitions are handed out in order, so at most threadCount queues
+    // are being filled while the oldest one is drained
+    std::vector<std::deque<Batch>> queues (ordered ? partitionCount : 0);
+    std::vector<bool> complete (partitionCount, false);
+
+    auto fail = [&] ()
+    {
+        std::lock_guard<std::mutex> lock (scanLock);
+        if (!error)
+            error = std::current_exception ();
+        failed = true;
+        produced.notify_all ();
+        consumed.notify_all ();
+    };
+
+    // blocks while the partition's queue is full
+    auto enqueue = [&] (uint32_t partition, Batch *batch)
+    {
+        std::unique_lock<std::mutex> lock (scanLock);
+        std::deque<Batch> &queue = queues.at (partition);
+        consumed.wait (lock, [&]
+        {
+            return failed || queue.size () < QUEUED_BATCHES;
+        });
+        if (failed)
+            return false;
+        queue.push_back (Batch ());
+        queue.back ().swap (*batch);
+        produced.notify_all ();
+        return true;
+    };
+
+    auto worker = [&] ()
+    {
+        while (!failed)
+        {
+            uint32_t partition;
+            {
+                std::lock_guard<std::mutex> lock (scanLock);
+                if (failed || nextPartition >= partitionCount)
+                    return;
+                partition = nextPartition++;
+            }
+
+            try
+            {
+                if (ordered)
+                {
+                    Batch batch;
+                    bool open = true;
+                    scanPartition (partition, [&] (std::shared_ptr<Key> key, Value *value)
+                    {
+                        // large values share the reader's block
+                        std::shared_ptr<Value> copy = std::make_shared<Value> ();
+                        copy->share (*value);
+                        batch.push_back (std::make_pair (key, copy));
+                        if (batch.size () >= BATCH_SIZE)
+                            open = enqueue (partition, &batch);
+                        return open;
+                    });
+                    if (open && !batch.empty ())
+                        enqueue (partition, &batch);
+                    std::lock_guard<std::mutex> lock (scanLock);
+                    complete.at (partition) = true;
+                    produced.notify_all ();
+                }
+                else
+                {
+                    scanPartition (partition, [&] (std::shared_ptr<Key> key, Value *value)
+                    {
+                        std::shared_ptr<Value> copy = std::make_shared<Value> ();
+                        copy->share (*value);
+                        callback (partition, key, copy);
+                        delivered++;
+                        return !failed;
+                    });
+                }
+            }
+            catch (...)
+            {
+                fail ();
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint16_t i = 0; i < threadCount && i < partitionCount; i++)
+    {
+        workers.push_back (std::thread (worker));
+    }
+
+    if (ordered)
+    {
+        for (uint32_t partition = 0; partition < partitionCount && !failed;)
+        {
+            Batch batch;
+            {
+                std::unique_lock<std::mutex> lock (scanLock);
+                std::deque<Batch> &queue = queues.at (partition);
+                produced.wait (lock, [&]
+                {
+                    return failed || !queue.empty () || complete.at (partition);
+                });
+                if (failed)
+                    break;
+                if (queue.empty ())
+                {
+                    partition++;
+                    continue;
+                }
+                batch.swap (queue.front ());
+                queue.pop_front ();
+                consumed.notify_all ();
+            }
+            try
+            {
+                for (auto &entry : batch)
+                {
+                    callback (partition, entry.first, entry.second);
+                    delivered++;
+                }
+            }
+            catch (...)
+            {
+                fail ();
+                break;
+            }
+        }
+    }
+
+    for (std::thread &thread : workers)
+    {
+        thread.join ();
+    }
+
+    if (error)
+        std::rethrow_exception (error);
+
+    return delivered;
+}
+}
+}
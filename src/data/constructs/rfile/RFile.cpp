@@ -14,6 +14,9 @@
 
 #include "../../../../include/data/streaming/input/NetworkOrderInputStream.h"
 #include "../../../../include/data/constructs/rfile/RFile.h"
+#include "../../../../include/data/streaming/accumulo/StreamSeekable.h"
+#include "../../../../include/data/exceptions/IllegalArgumentException.h"
+
 
 namespace cclient{
   namespace data{
@@ -31,8 +34,12 @@ RFile::RFile (streams::OutputStream *output_stream, BlockCompressedFile *bWriter
 
     compressorRef = bWriter->getCompressor ();
 
+    ownsBlockFile = false;
+
     maxBlockSize = compressorRef->getBufferSize () * 8;
 
+    maxIndexBlockSize = 128 * 1024;
+
     myDataStream = output_stream;
 
     lastKeyValue = NULL;
@@ -56,6 +63,12 @@ RFile::RFile (streams::InputStream *input_stream, long fileLength) :
     lastKeyValue = NULL;
 
     blockWriter = new BlockCompressedFile (in_stream, fileLength);
+
+    ownsBlockFile = true;
+
+    compressorRef = blockWriter->getDataIndex ()->getCompressionAlgorithm ().create ();
+
+    indexBlockCache = std::make_shared<IndexBlockCache> ();
     
     streams::InputStream *metaBlock = blockWriter->getMetaIndex ()->getEntry (
                                  "RFile.index")->readDataStream (in_stream);
@@ -90,13 +103,15 @@ RFile::readLocalityGroups (streams::InputStream *metaBlock)
     int size = metaBlock->readInt ();
 
 
-    localityGroups.resize (size);
+    localityGroups.reserve (size);
     
     for (int i = 0; i < size; i++)
     {
         LocalityGroupMetaData *meatadata = new LocalityGroupMetaData (
             compressorRef, version, in_stream);
         meatadata->read(metaBlock);
+        // index blocks are shared by every locality group of the file
+        meatadata->getIndexManager ()->setIndexBlockCache (indexBlockCache);
         localityGroups.push_back (meatadata);
         localityGroupReaders.push_back (
             new LocalityGroupReader (blockWriter, in_stream, meatadata, version));
@@ -107,9 +122,123 @@ RFile::readLocalityGroups (streams::InputStream *metaBlock)
 
 }
 
-RFile::~RFile ()
+void
+RFile::relocate (streams::StreamRelocation *location)
 {
+    streams::StreamSeekable *seekable =
+        dynamic_cast<streams::StreamSeekable*> (location);
+    if (NULL == seekable)
+    {
+        throw cclient::exceptions::IllegalArgumentException ("Expected a StreamSeekable");
+    }
+
+    std::set<std::string> columnFamilies (seekable->getColumnFamilies ()->begin (),
+                                          seekable->getColumnFamilies ()->end ());
+
+    std::set<std::string> nonDefaultFamilies;
+    for (LocalityGroupMetaData *group : localityGroups)
+    {
+        if (group->hasColumnFamilies ())
+        {
+            for (auto cf : group->getColumnFamilies ())
+                nonDefaultFamilies.insert (cf.first);
+        }
+    }
+
+    merger.clear ();
+    for (size_t i = 0; i < localityGroups.size (); i++)
+    {
+        if (!isGroupSelected (localityGroups.at (i), columnFamilies,
+                              seekable->isInclusive (), nonDefaultFamilies))
+            continue;
+        LocalityGroupReader *reader = localityGroupReaders.at (i);
+        reader->seek (location);
+        merger.addReader (reader);
+    }
 
+    currentLocalityGroupReader = merger.getCurrent ();
+}
+
+void
+RFile::next ()
+{
+    merger.next ();
+    currentLocalityGroupReader = merger.getCurrent ();
+}
+
+size_t
+RFile::nextBatch (KeyValueBatch *batch, size_t n)
+{
+    batch->clear ();
+    while (batch->size () < n && hasNext ())
+    {
+        if (merger.isSingleReader ())
+        {
+            // the remaining entries come from one group
+            currentLocalityGroupReader->nextBatch (batch, n - batch->size ());
+            break;
+        }
+        batch->append (currentLocalityGroupReader->getTopKey ().get (),
+                       currentLocalityGroupReader->getTopValue ());
+        next ();
+    }
+    return batch->size ();
+}
+
+bool
+RFile::isGroupSelected (LocalityGroupMetaData *group,
+                        const std::set<std::string> &columnFamilies, bool inclusive,
+                        const std::set<std::string> &nonDefaultFamilies)
+{
+    if (!group->hasColumnFamilies ())
+    {
+        // the default group may contain any family not in another group
+        if (!inclusive)
+            return true;
+        for (const std::string &cf : columnFamilies)
+        {
+            if (nonDefaultFamilies.find (cf) == nonDefaultFamilies.end ())
+                return true;
+        }
+        return false;
+    }
+
+    if (inclusive)
+    {
+        for (const std::string &cf : columnFamilies)
+        {
+            if (group->getColumnFamilies ().count (cf) > 0)
+                return true;
+        }
+        return false;
+    }
+
+    // excluded families are only skipped if the group has nothing else
+    for (auto cf : group->getColumnFamilies ())
+    {
+        if (cf.second > 0 && columnFamilies.find (cf.first) == columnFamilies.end ())
+            return true;
+    }
+    return false;
+}
+
+RFile::~RFile ()
+{
+    for (LocalityGroupReader *reader : localityGroupReaders)
+    {
+        delete reader;
+    }
+    for (LocalityGroupMetaData *group : localityGroups)
+    {
+        delete group;
+    }
+    if (NULL != currentLocalityGroup)
+        delete currentLocalityGroup;
+    if (ownsBlockFile)
+    {
+        delete compressorRef;
+        delete blockWriter;
+    }
 }
 
 bool
@@ -125,8 +254,10 @@ RFile::append (std::shared_ptr<KeyValue> kv)
         setCurrentLocalityKey (firstKey);
     }
 
+    // the first key of each block is written in full, so that a seek
+    // may begin decoding at any block
     std::shared_ptr<Key> prevKey = NULL;
-    if (NULL != lastKeyValue)
+    if (NULL != lastKeyValue && NULL != currentBlockWriter)
     {
         prevKey = lastKeyValue->getKey ();
     }
@@ -136,23 +267,30 @@ RFile::append (std::shared_ptr<KeyValue> kv)
     {
 
         currentBlockWriter =
-            (BlockCompressorStream*) blockWriter->createDataStream (myDataStream);
+            (BlockCompressorStream*) blockWriter->createDataStream (myDataStream,
+                    compressionPipeline.get ());
         currentBlockCount = 0;
     }
 
+    if (!currentLocalityGroup->isDefaultLocalityGroup ())
+    {
+        std::pair<char*, size_t> cf = kv->getKey ()->getColFamily ();
+        currentLocalityGroup->addColumnFamily (cf.first, cf.second);
+    }
+
     entries++;
     currentBlockCount++;
     key->write (currentBlockWriter);
-    uint64_t position = kv->getValue ()->write (currentBlockWriter);
+    kv->getValue ()->write (currentBlockWriter);
 
     lastKeyValue = kv;
 
     // we've written all we can write doctor.
-    if (position >= maxBlockSize)
+    if (currentBlockWriter->bytesWritten () >= maxBlockSize)
     {
     	std::cout << "stopping at " << entries << std::endl;
         currentBlockWriter->flush ();
-        closeBlock (kv);
+        closeBlock (kv->getKey ()->getStream ());
 
         delete currentBlockWriter;
         currentBlockWriter = NULL;
@@ -177,7 +315,6 @@ RFile::append (std::vector<std::shared_ptr<streams::StreamInterface>> *keyValues
 
     uint32_t recordIncrement = (maxBlockSize / average_recordSize);
 
-    std::shared_ptr<streams::StreamInterface> key;
     std::shared_ptr<streams::StreamInterface> firstKey = NULL;
     firstKey = keyValues->at (0)->getStream ();
     // set the first key for the current locality group.
@@ -187,10 +324,21 @@ RFile::append (std::vector<std::shared_ptr<streams::StreamInterface>> *keyValues
     for (uint64_t i = 0; i < keyValues->size (); i += (j - i))
     {
         currentBlockWriter =
-            (BlockCompressorStream*) blockWriter->createDataStream (myDataStream);
+            (BlockCompressorStream*) blockWriter->createDataStream (myDataStream,
+                    compressionPipeline.get ());
         for (j = i; j < keyValues->size () && j < (i + recordIncrement); j++)
         {
             keyValues->at (j)->write (currentBlockWriter);
+            if (!currentLocalityGroup->isDefaultLocalityGroup ())
+            {
+                std::shared_ptr<KeyValue> kv = std::dynamic_pointer_cast<KeyValue> (
+                                                   keyValues->at (j));
+                if (NULL != kv)
+                {
+                    std::pair<char*, size_t> cf = kv->getKey ()->getColFamily ();
+                    currentLocalityGroup->addColumnFamily (cf.first, cf.second);
+                }
+            }
             entries++;
         }
         currentBlockWriter->flush ();
@@ -200,23 +348,26 @@ RFile::append (std::vector<std::shared_ptr<streams::StreamInterface>> *keyValues
         currentBlockWriter = NULL;
     }
 
-    if (currentBlockWriter != NULL)
-    {
-        currentBlockWriter->flush ();
-        delete currentBlockWriter;
-    }
-    key = keyValues->back ()->getStream ();
-    closeBlock (key);
-
     return true;
 
 }
 
+void
+RFile::writeIndexBlock (const char *data, size_t size, BlockRegion *region)
+{
+    BlockCompressorStream blockStream (myDataStream, compressorRef, region);
+    blockStream.writeBytes ((const uint8_t*) data, size);
+    blockStream.flush ();
+}
+
 void
 RFile::close ()
 {
     closeData ();
 
+    // the groups' index blocks are written before the meta block
+    closeCurrentGroup ();
+
     // create  new compression stream.
 
     BlockCompressorStream *outStream =
@@ -225,7 +376,6 @@ RFile::close ()
     // prepare the RFile Index.
 
     MetaBlock block;
-    closeCurrentGroup ();
     block.addLocalityGroups (localityGroups);
     block.write (outStream);
     outStream->flush ();
@@ -0,0 +1,269 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+
+#include "../../../../include/data/constructs/rfile/TabletPartitionedWriter.h"
+#include "../../../../include/data/constructs/rfile/BulkRFileBuilder.h"
+#include "../../../../include/data/constructs/rfile/LocalRFile.h"
+
+namespace cclient
+{
+namespace data
+{
+
+TabletPartitionedWriter::TabletPartitionedWriter (const std::string &directory,
+        std::vector<std::string> splits, compression::Compressor *compressor,
+        uint64_t memoryBudget, uint16_t threads) :
+    directory (directory), compressor (compressor), memoryBudget (
+        memoryBudget), targetFileSize (256 * 1024 * 1024), threadCount (
+            threads), closed (false), bufferedBytes (0), writingBytes (0), active (
+                    0), stopped (false)
+{
+    if (compressor == NULL)
+        throw std::runtime_error ("Partitioned writer requires a compressor");
+    if (threads == 0)
+        throw std::runtime_error ("Partitioned writer requires a worker");
+
+    std::sort (splits.begin (), splits.end ());
+    splits.erase (std::unique (splits.begin (), splits.end ()), splits.end ());
+    // the last tablet has no end row
+    if (!splits.empty () && splits.front ().empty ())
+        splits.erase (splits.begin ());
+    this->splits = splits;
+
+    tablets.resize (this->splits.size () + 1);
+
+    for (uint16_t i = 0; i < threads; i++)
+    {
+        workers.push_back (std::thread (&TabletPartitionedWriter::run, this));
+    }
+}
+
+TabletPartitionedWriter::~TabletPartitionedWriter ()
+{
+    {
+        std::lock_guard<std::mutex> lock (jobLock);
+        pending.clear ();
+    }
+    stopWorkers ();
+}
+
+uint32_t
+TabletPartitionedWriter::getTablet (const char *row, size_t len)
+{
+    // a tablet contains the rows after its previous end row, up to and
+    // including its end row
+    std::string rowString (row, len);
+    return std::lower_bound (splits.begin (), splits.end (), rowString)
+           - splits.begin ();
+}
+
+void
+TabletPartitionedWriter::append (std::shared_ptr<KeyValue> kv)
+{
+    if (closed)
+        throw std::runtime_error ("Partitioned writer is closed");
+
+    std::pair<char*, size_t> row = kv->getKey ()->getRow ();
+    uint32_t index = getTablet (row.first, row.second);
+    Tablet &tablet = tablets.at (index);
+
+    uint64_t size = BulkRFileBuilder::getEntrySize (kv.get ());
+    tablet.entries.push_back (kv);
+    tablet.bytes += size;
+    bufferedBytes += size;
+
+    if (tablet.bytes >= targetFileSize)
+    {
+        submit (index);
+    }
+    else if (bufferedBytes + writingBytes >= memoryBudget)
+    {
+        uint32_t largest = 0;
+        for (uint32_t i = 1; i < tablets.size (); i++)
+        {
+            if (tablets.at (i).bytes > tablets.at (largest).bytes)
+                largest = i;
+        }
+        submit (largest);
+    }
+
+    if (bufferedBytes + writingBytes >= memoryBudget)
+    {
+        // the buffers being written hold the budget until their files are
+        std::unique_lock<std::mutex> lock (jobLock);
+        jobsChanged.wait (lock, [this]
+        {
+            return bufferedBytes + writingBytes < memoryBudget
+                   || writingBytes == 0 || error;
+        });
+        if (error)
+            std::rethrow_exception (error);
+    }
+}
+
+void
+TabletPartitionedWriter::submit (uint32_t index)
+{
+    Tablet &tablet = tablets.at (index);
+    if (tablet.entries.empty ())
+        return;
+
+    std::unique_lock<std::mutex> lock (jobLock);
+    jobsChanged.wait (lock, [this]
+    {
+        return pending.size () + active < threadCount || error;
+    });
+    if (error)
+        std::rethrow_exception (error);
+
+    Job job;
+    job.tablet = index;
+    job.sequence = tablet.files++;
+    job.entries = std::move (tablet.entries);
+    job.bytes = tablet.bytes;
+    pending.push_back (std::move (job));
+
+    tablet.entries.clear ();
+    bufferedBytes -= tablet.bytes;
+    writingBytes += tablet.bytes;
+    tablet.bytes = 0;
+    jobsChanged.notify_all ();
+}
+
+void
+TabletPartitionedWriter::run ()
+{
+    std::unique_ptr<compression::Compressor> fileCompressor (
+        compressor->newInstance ());
+
+    std::unique_lock<std::mutex> lock (jobLock);
+    while (true)
+    {
+        jobsChanged.wait (lock, [this]
+        {
+            return stopped || !pending.empty ();
+        });
+        if (pending.empty ())
+            return;
+
+        Job job = std::move (pending.front ());
+        pending.pop_front ();
+        if (error)
+        {
+            writingBytes -= job.bytes;
+            continue;
+        }
+        active++;
+        lock.unlock ();
+
+        BulkFile file;
+        std::exception_ptr failure;
+        try
+        {
+            file = writeFile (job, fileCompressor.get ());
+        }
+        catch (...)
+        {
+            failure = std::current_exception ();
+        }
+        // releases the buffer before another may be filled
+        job.entries.clear ();
+        job.entries.shrink_to_fit ();
+
+        lock.lock ();
+        active--;
+        writingBytes -= job.bytes;
+        if (failure && !error)
+            error = failure;
+        else if (!failure)
+            files.push_back (file);
+        jobsChanged.notify_all ();
+    }
+}
+
+BulkFile
+TabletPartitionedWriter::writeFile (Job &job,
+                                    compression::Compressor *fileCompressor)
+{
+    std::stable_sort (job.entries.begin (), job.entries.end (),
+                      [] (const std::shared_ptr<KeyValue> &a, const std::shared_ptr<KeyValue> &b)
+    {
+        return a->getKey ()->compare (*b->getKey ()) < 0;
+    });
+
+    char name[32];
+    snprintf (name, sizeof (name), "/t%05u-%05u.rf", job.tablet, job.sequence);
+
+    BulkFile file;
+    file.file = directory + name;
+    file.tablet = job.tablet;
+    if (job.tablet > 0)
+        file.prevEndRow = splits.at (job.tablet - 1);
+    if (job.tablet < splits.size ())
+        file.endRow = splits.at (job.tablet);
+    file.entries = job.entries.size ();
+
+    LocalRFile rfile (file.file, fileCompressor);
+    for (std::shared_ptr<KeyValue> &kv : job.entries)
+    {
+        rfile.append (kv);
+    }
+    rfile.close ();
+    file.size = rfile.getSize ();
+    return file;
+}
+
+std::vector<BulkFile>
+TabletPartitionedWriter::close ()
+{
+    if (!closed)
+    {
+        closed = true;
+        for (uint32_t i = 0; i < tablets.size (); i++)
+        {
+            submit (i);
+        }
+        stopWorkers ();
+        if (error)
+            std::rethrow_exception (error);
+
+        std::sort (files.begin (), files.end (), [] (const BulkFile &a, const BulkFile &b)
+        {
+            return a.file < b.file;
+        });
+    }
+    return files;
+}
+
+void
+TabletPartitionedWriter::stopWorkers ()
+{
+    {
+        std::lock_guard<std::mutex> lock (jobLock);
+        stopped = true;
+        jobsChanged.notify_all ();
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join ();
+    }
+    workers.clear ();
+}
+
+}
+}
@@ -0,0 +1,145 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../../../../../include/data/constructs/rfile/bcfile/BlockCache.h"
+
+// default size of the process wide cache
+#define DEFAULT_BLOCK_CACHE_SIZE (256 * 1024 * 1024)
+
+namespace cclient
+{
+namespace data
+{
+
+BlockCache::BlockCache (uint64_t maxSize, uint16_t shardCount) :
+    shardCount (shardCount == 0 ? 1 : shardCount), maxSize (0), hits (0), misses (
+        0), evictions (0)
+{
+    shards = new Shard[this->shardCount];
+    setMaxSize (maxSize);
+}
+
+BlockCache::~BlockCache ()
+{
+    delete[] shards;
+}
+
+BlockCache *
+BlockCache::getInstance ()
+{
+    static BlockCache cache (DEFAULT_BLOCK_CACHE_SIZE);
+    return &cache;
+}
+
+uint64_t
+BlockCache::nextFileIdentifier ()
+{
+    static std::atomic<uint64_t> identifier (0);
+    // keep generated identifiers away from those derived from the file system
+    return (1ULL << 63) | ++identifier;
+}
+
+std::shared_ptr<DecompressedBlock>
+BlockCache::get (uint64_t fileId, uint64_t offset)
+{
+    CacheKey key = { fileId, offset };
+    Shard &shard = getShard (key);
+    std::lock_guard<std::mutex> lock (shard.shardLock);
+    auto it = shard.entries.find (key);
+    if (it == shard.entries.end ())
+    {
+        misses++;
+        return nullptr;
+    }
+    shard.lru.splice (shard.lru.begin (), shard.lru, it->second);
+    hits++;
+    return it->second->second;
+}
+
+void
+BlockCache::put (uint64_t fileId, uint64_t offset,
+                 std::shared_ptr<DecompressedBlock> block)
+{
+    if (block == nullptr)
+        return;
+    CacheKey key = { fileId, offset };
+    Shard &shard = getShard (key);
+    std::lock_guard<std::mutex> lock (shard.shardLock);
+    // blocks larger than a shard would only flush the shard
+    if (block->size () > shard.capacity)
+        return;
+    auto it = shard.entries.find (key);
+    if (it != shard.entries.end ())
+    {
+        shard.size -= it->second->second->size ();
+        shard.lru.erase (it->second);
+        shard.entries.erase (it);
+    }
+    shard.lru.push_front (std::make_pair (key, block));
+    shard.entries[key] = shard.lru.begin ();
+    shard.size += block->size ();
+    evict (shard);
+}
+
+void
+BlockCache::evict (Shard &shard)
+{
+    while (shard.size > shard.capacity && !shard.lru.empty ())
+    {
+        CacheEntry &victim = shard.lru.back ();
+        shard.size -= victim.second->size ();
+        shard.entries.erase (victim.first);
+        shard.lru.pop_back ();
+        evictions++;
+    }
+}
+
+void
+BlockCache::setMaxSize (uint64_t newSize)
+{
+    maxSize = newSize;
+    for (uint16_t i = 0; i < shardCount; i++)
+    {
+        std::lock_guard<std::mutex> lock (shards[i].shardLock);
+        shards[i].capacity = maxSize / shardCount;
+        evict (shards[i]);
+    }
+}
+
+uint64_t
+BlockCache::getSize ()
+{
+    uint64_t size = 0;
+    for (uint16_t i = 0; i < shardCount; i++)
+    {
+        std::lock_guard<std::mutex> lock (shards[i].shardLock);
+        size += shards[i].size;
+    }
+    return size;
+}
+
+void
+BlockCache::clear ()
+{
+    for (uint16_t i = 0; i < shardCount; i++)
+    {
+        std::lock_guard<std::mutex> lock (shards[i].shardLock);
+        shards[i].lru.clear ();
+        shards[i].entries.clear ();
+        shards[i].size = 0;
+    }
+}
+
+}
+}
@@ -0,0 +1,181 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdexcept>
+
+#include "../../../../../include/data/constructs/rfile/bcfile/BlockCompressionPipeline.h"
+
+namespace cclient
+{
+namespace data
+{
+
+BlockCompressionPipeline::BlockCompressionPipeline (
+    streams::OutputStream *out, compression::Compressor *compressor,
+    uint16_t threads, uint16_t maxBlocks) :
+    out (out), compressor (compressor), maxBlocks (
+        maxBlocks == 0 ? 1 : maxBlocks), committing (false), stopped (false)
+{
+    if (threads == 0)
+        throw std::runtime_error ("Compression pipeline requires a worker");
+
+    for (uint16_t i = 0; i < threads; i++)
+    {
+        workers.push_back (std::thread (&BlockCompressionPipeline::run, this));
+    }
+}
+
+BlockCompressionPipeline::~BlockCompressionPipeline ()
+{
+    {
+        std::unique_lock<std::mutex> lock (queueLock);
+        queueChanged.wait (lock, [this]
+        {
+            return (blocks.empty () || error) && !committing;
+        });
+        stopped = true;
+        queueChanged.notify_all ();
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join ();
+    }
+}
+
+void
+BlockCompressionPipeline::submit (std::vector<char> &&raw, BlockRegion *region)
+{
+    std::unique_lock<std::mutex> lock (queueLock);
+    queueChanged.wait (lock, [this]
+    {
+        return blocks.size () < maxBlocks || error;
+    });
+    if (error)
+        std::rethrow_exception (error);
+
+    std::shared_ptr<PendingBlock> pending = std::make_shared<PendingBlock> ();
+    pending->raw = std::move (raw);
+    pending->region = region;
+    pending->claimed = false;
+    pending->compressed = false;
+    blocks.push_back (pending);
+    queueChanged.notify_all ();
+}
+
+void
+BlockCompressionPipeline::flush ()
+{
+    std::unique_lock<std::mutex> lock (queueLock);
+    queueChanged.wait (lock, [this]
+    {
+        return (blocks.empty () || error) && !committing;
+    });
+    if (error)
+        std::rethrow_exception (error);
+}
+
+void
+BlockCompressionPipeline::run ()
+{
+    std::unique_ptr<compression::Compressor> blockCompressor (
+        compressor->newInstance ());
+
+    std::unique_lock<std::mutex> lock (queueLock);
+    while (true)
+    {
+        std::shared_ptr<PendingBlock> next;
+        queueChanged.wait (lock, [this, &next]
+        {
+            if (stopped)
+                return true;
+            if (error)
+                return false;
+            for (const std::shared_ptr<PendingBlock> &pending : blocks)
+            {
+                if (!pending->claimed)
+                {
+                    next = pending;
+                    return true;
+                }
+            }
+            return false;
+        });
+        if (stopped)
+            return;
+
+        next->claimed = true;
+        lock.unlock ();
+
+        std::exception_ptr failure;
+        try
+        {
+            // leaves room for data that does not compress
+            next->data.reset (new streams::ByteOutputStream (
+                next->raw.size () + blockCompressor->getCompressionOverHead ()));
+            blockCompressor->setInput (next->raw.data (), 0, next->raw.size ());
+            blockCompressor->compress (next->data.get ());
+        }
+        catch (...)
+        {
+            failure = std::current_exception ();
+        }
+
+        lock.lock ();
+        next->compressed = true;
+        if (failure && !error)
+            error = failure;
+        commit (lock);
+        queueChanged.notify_all ();
+    }
+}
+
+void
+BlockCompressionPipeline::commit (std::unique_lock<std::mutex> &lock)
+{
+    // a single worker writes, so that blocks are written in order
+    if (committing)
+        return;
+
+    committing = true;
+    while (!error && !blocks.empty () && blocks.front ()->compressed)
+    {
+        std::shared_ptr<PendingBlock> pending = blocks.front ();
+        lock.unlock ();
+
+        std::exception_ptr failure;
+        try
+        {
+            size_t compressedSize = pending->data->getPos ();
+            pending->region->setOffset (out->getPos ());
+            pending->region->setRawSize (pending->raw.size ());
+            pending->region->setCompressedSize (compressedSize);
+            out->write (pending->data->getByteArray (), compressedSize);
+        }
+        catch (...)
+        {
+            failure = std::current_exception ();
+        }
+
+        lock.lock ();
+        if (failure && !error)
+            error = failure;
+        blocks.pop_front ();
+        // frees space for the writer
+        queueChanged.notify_all ();
+    }
+    committing = false;
+}
+
+}
+}
@@ -18,37 +18,56 @@
 #include "../../../../../include/data/constructs/rfile/bcfile/../../../streaming/input/InputStream.h"
 #include "../../../../../include/data/constructs/rfile/bcfile/../../../streaming/DataOutputStream.h"
 #include "../../../../../include/data/constructs/rfile/bcfile/../../../streaming/input/NetworkOrderInputStream.h"
+#include "../../../../../include/data/constructs/rfile/bcfile/../../../streaming/input/MappedInputStream.h"
 #include "../../../../../include/data/constructs/rfile/bcfile/../../../streaming/NetworkOrderStream.h"
 namespace cclient{
   namespace data{
 
 BlockCompressorStream::BlockCompressorStream (streams::OutputStream *out_stream,
         compression::Compressor *compressor,
-        BlockRegion *region) :
+        BlockRegion *region, BlockCompressionPipeline *pipeline) :
     BlockStreambuffer (compressor->getBufferSize ()), cclient::data::streams::DataOutputStream (
         new streams::BigEndianOutStream (
-            new OutputStream ((std::ostream*) this, out_stream->getPos ()))), compress (
+            new OutputStream ((std::ostream*) this,
+                              NULL == pipeline ? out_stream->getPos () : 0))), compress (
                 compressor->newInstance()), output_stream (out_stream), std::ostream (
                     (BlockStreambuffer*) this), std::istream(this), std::ios (0), blockLoc (0), writeStart (false), associatedRegion (
-                        region)
+                        region), pipeline (pipeline)
 {
 }
 
 
 BlockCompressorStream::BlockCompressorStream(InputStream *in_stream,  compression::Compressor *decompressor,  BlockRegion *region) :
     BlockStreambuffer (decompressor->getBufferSize ()),cclient::data::streams::DataOutputStream (NULL),cclient::data::streams::EndianInputStream(),std::istream(this), std::ios (0), blockLoc (0), writeStart (false), associatedRegion(region),output_stream(NULL),compress (
-        decompressor->newInstance())
+        decompressor->newInstance()), pipeline (NULL)
 {
-    uint64_t prevPosition = in_stream->getPos();
-
-    in_stream->seek (region->getOffset ());
-
-    uint8_t *compressedValue = new uint8_t[region->getCompressedSize ()];
-
-    in_stream->readBytes (compressedValue, region->getCompressedSize ());
-
-    decompressor->setInput ((const char*) compressedValue, 0,
-                            region->getCompressedSize ());
+    uint8_t *compressedValue = NULL;
+
+    streams::MappedInputStream *mappedStream =
+        dynamic_cast<streams::MappedInputStream*> (in_stream);
+    const uint8_t *span = NULL;
+    if (NULL != mappedStream)
+    {
+        span = mappedStream->getSpan (region->getOffset (),
+                                      region->getCompressedSize ());
+    }
+
+    if (NULL != span)
+    {
+        decompressor->setInput ((const char*) span, 0,
+                                region->getCompressedSize ());
+    }
+    else
+    {
+        compressedValue = new uint8_t[region->getCompressedSize ()];
+
+        // read positionally, as other readers may share the stream
+        in_stream->readAt (region->getOffset (), compressedValue,
+                           region->getCompressedSize ());
+
+        decompressor->setInput ((const char*) compressedValue, 0,
+                                region->getCompressedSize ());
+    }
 
    streams::ByteOutputStream *outStream = new streams::ByteOutputStream (
         region->getRawSize ());
@@ -57,11 +76,8 @@ BlockCompressorStream::BlockCompressorStream(InputStream *in_stream,  compressio
 
     setArray(outStream->getByteArray (), outStream->getSize (), true);
 
-    // reset the location
-
-    in_stream->seek(prevPosition);
-
-    delete[] compressedValue;
+    if (NULL != compressedValue)
+        delete[] compressedValue;
 
     delete outStream;
 
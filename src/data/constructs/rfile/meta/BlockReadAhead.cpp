@@ -0,0 +1,161 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../../../../../include/data/constructs/rfile/meta/BlockReadAhead.h"
+
+namespace cclient
+{
+namespace data
+{
+
+BlockReadAhead::BlockReadAhead (BlockLoader loader, uint16_t depth,
+                                uint64_t maxBytes) :
+    loader (loader), depth (depth == 0 ? 1 : depth), maxBytes (maxBytes), bytes (
+        0), loading (false), stopped (false)
+{
+    worker = std::thread (&BlockReadAhead::run, this);
+}
+
+BlockReadAhead::~BlockReadAhead ()
+{
+    {
+        std::lock_guard<std::mutex> lock (queueLock);
+        stopped = true;
+        queueChanged.notify_all ();
+    }
+    worker.join ();
+}
+
+bool
+BlockReadAhead::prefetch (uint32_t block, uint64_t rawSize)
+{
+    std::lock_guard<std::mutex> lock (queueLock);
+    if (blocks.size () >= depth)
+        return false;
+    if (!blocks.empty () && bytes + rawSize > maxBytes)
+        return false;
+    PendingBlock pending =
+    { block, rawSize, false, nullptr, nullptr };
+    blocks.push_back (pending);
+    bytes += rawSize;
+    queueChanged.notify_all ();
+    return true;
+}
+
+std::shared_ptr<DecompressedBlock>
+BlockReadAhead::take (uint32_t block)
+{
+    std::unique_lock<std::mutex> lock (queueLock);
+    bool requested = false;
+    for (const PendingBlock &pending : blocks)
+    {
+        if (pending.block == block)
+        {
+            requested = true;
+            break;
+        }
+    }
+    if (!requested)
+        return nullptr;
+
+    // blocks requested earlier were skipped by the reader
+    while (blocks.front ().block != block)
+    {
+        bytes -= blocks.front ().rawSize;
+        blocks.pop_front ();
+    }
+
+    queueChanged.notify_all ();
+    queueChanged.wait (lock, [this]
+    {
+        return blocks.front ().loaded;
+    });
+
+    PendingBlock pending = blocks.front ();
+    blocks.pop_front ();
+    bytes -= pending.rawSize;
+    queueChanged.notify_all ();
+
+    if (pending.error)
+        std::rethrow_exception (pending.error);
+    return pending.data;
+}
+
+void
+BlockReadAhead::cancel ()
+{
+    std::unique_lock<std::mutex> lock (queueLock);
+    blocks.clear ();
+    bytes = 0;
+    queueChanged.wait (lock, [this]
+    {
+        return !loading;
+    });
+}
+
+void
+BlockReadAhead::run ()
+{
+    std::unique_lock<std::mutex> lock (queueLock);
+    while (true)
+    {
+        std::deque<PendingBlock>::iterator next;
+        queueChanged.wait (lock, [this, &next]
+        {
+            if (stopped)
+                return true;
+            for (next = blocks.begin (); next != blocks.end (); next++)
+            {
+                if (!next->loaded)
+                    return true;
+            }
+            return false;
+        });
+        if (stopped)
+            return;
+
+        uint32_t block = next->block;
+        loading = true;
+        lock.unlock ();
+
+        std::shared_ptr<DecompressedBlock> data;
+        std::exception_ptr error;
+        try
+        {
+            data = loader (block);
+        }
+        catch (...)
+        {
+            error = std::current_exception ();
+        }
+
+        lock.lock ();
+        loading = false;
+        // the block may have been discarded while it was loaded
+        for (PendingBlock &pending : blocks)
+        {
+            if (pending.block == block && !pending.loaded)
+            {
+                pending.data = data;
+                pending.error = error;
+                pending.loaded = true;
+                break;
+            }
+        }
+        queueChanged.notify_all ();
+    }
+}
+
+}
+}
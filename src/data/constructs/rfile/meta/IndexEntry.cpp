@@ -23,6 +23,14 @@ IndexEntry::IndexEntry (std::shared_ptr<streams::StreamInterface> mKey, uint32_t
 	key = std::make_shared<cclient::data::Key>(std::static_pointer_cast<cclient::data::Key>(mKey));
 }
 
+IndexEntry::IndexEntry (std::shared_ptr<streams::StreamInterface> mKey, uint32_t entryCount,
+                        uint64_t offset, uint64_t compressedSize, uint64_t rawSize) :
+    entries (entryCount), newFormat (true), offset (offset), compressedSize (
+        compressedSize), rawSize (rawSize)
+{
+	key = std::make_shared<cclient::data::Key>(std::static_pointer_cast<cclient::data::Key>(mKey));
+}
+
 IndexEntry::~IndexEntry ()
 {
 }
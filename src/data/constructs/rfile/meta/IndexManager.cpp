@@ -19,7 +19,7 @@ namespace cclient{
 
 IndexManager::IndexManager (cclient::data::compression::Compressor *compressorRef,cclient::data::streams::InputStream *blockReader, int version) :
     blockReader (blockReader), version (version), indexBlock (NULL), compressorRef (
-        compressorRef)
+        compressorRef), blockCache (NULL), fileIdentifier (0)
 {
 
 }
@@ -0,0 +1,171 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdexcept>
+
+#include "../../../../../include/data/constructs/rfile/meta/IndexWriter.h"
+#include "../../../../../include/data/streaming/VLongEncoder.h"
+
+namespace cclient
+{
+namespace data
+{
+
+IndexWriter::IndexWriter (BlockWriter writer, RegionSync sync,
+                          uint32_t maxBlockSize) :
+    writer (writer), sync (sync), maxBlockSize (maxBlockSize), totalAdded (
+        0), closed (false), pendingRegion (NULL)
+{
+}
+
+void
+IndexWriter::add (std::shared_ptr<Key> key, uint32_t entries,
+                  BlockRegion *region)
+{
+    if (closed)
+        throw std::runtime_error ("Index is closed");
+
+    // the last entry is held back, so that a block written below the
+    // root knows whether another block follows it
+    if (NULL != pendingEntry)
+    {
+        totalAdded++;
+        add (0, pendingEntry, pendingRegion);
+        flush (0, false);
+    }
+    pendingEntry = std::make_shared<IndexEntry> (key, entries, 0, 0, 0);
+    pendingRegion = region;
+}
+
+void
+IndexWriter::close ()
+{
+    if (closed)
+        return;
+    closed = true;
+    sync ();
+    if (NULL != pendingEntry)
+    {
+        totalAdded++;
+        add (0, pendingEntry, pendingRegion);
+        pendingEntry = NULL;
+        flush (0, true);
+    }
+}
+
+uint64_t
+IndexWriter::write (streams::DataOutputStream *out)
+{
+    close ();
+    out->writeInt (totalAdded);
+    if (levels.empty ())
+    {
+        Level empty (0, 0);
+        return writeBlock (empty, false, out);
+    }
+    return writeBlock (levels.back (), false, out);
+}
+
+void
+IndexWriter::add (size_t level, std::shared_ptr<IndexEntry> entry,
+                  BlockRegion *region)
+{
+    if (level == levels.size ())
+        levels.push_back (Level (level, 0));
+
+    Level &block = levels.at (level);
+    std::shared_ptr<Key> key = entry->getKey ();
+    // the key's fields, five longs, the entry count and the region,
+    // as well as the entry's offset within the block
+    block.size += key->getRow ().second + key->getColFamily ().second
+                  + key->getColQualifier ().second
+                  + key->getColVisibility ().second
+                  + 8 * streams::VLongEncoder::MAX_LENGTH + 1 + 4 + 4;
+    block.entries.push_back (entry);
+    block.regions.push_back (region);
+}
+
+void
+IndexWriter::flush (size_t level, bool last)
+{
+    // the root is written with the locality group
+    if (last && level == levels.size () - 1)
+        return;
+
+    Level &block = levels.at (level);
+    if ((block.size > maxBlockSize && block.entries.size () > 1) || last)
+    {
+        // entries of the lowest level refer to data blocks, which
+        // must be written before their regions are known
+        if (level == 0)
+            sync ();
+
+        streams::BigEndianByteStream byteOutStream (block.size + 64);
+        streams::DataOutputStream outStream (&byteOutStream);
+        writeBlock (block, !last, &outStream);
+
+        BlockRegion region;
+        writer (byteOutStream.getByteArray (), byteOutStream.getPos (), &region);
+
+        std::shared_ptr<Key> lastKey = block.entries.back ()->getKey ();
+        if (last)
+            levels.at (level) = Level (level, 0);
+        else
+            levels.at (level) = Level (level, totalAdded);
+
+        add (level + 1,
+             std::make_shared<IndexEntry> (lastKey, 0, region.getOffset (),
+                                           region.getCompressedSize (),
+                                           region.getRawSize ()), NULL);
+        flush (level + 1, last);
+    }
+}
+
+uint64_t
+IndexWriter::writeBlock (Level &block, bool hasNext,
+                         streams::DataOutputStream *out)
+{
+    streams::BigEndianByteStream byteOutStream (block.size);
+    streams::DataOutputStream indexStream (&byteOutStream);
+
+    std::vector<int> offsets;
+    offsets.reserve (block.entries.size ());
+    for (size_t i = 0; i < block.entries.size (); i++)
+    {
+        BlockRegion *region = block.regions.at (i);
+        if (NULL != region)
+        {
+            block.entries.at (i)->setRegion (region->getOffset (),
+                                             region->getCompressedSize (),
+                                             region->getRawSize ());
+        }
+        offsets.push_back (byteOutStream.getPos ());
+        block.entries.at (i)->write (&indexStream);
+    }
+
+    out->writeInt (block.level);
+    out->writeInt (block.offset);
+    out->writeBoolean (hasNext);
+    out->writeInt (offsets.size ());
+    for (int offset : offsets)
+    {
+        out->writeInt (offset);
+    }
+    out->writeInt (byteOutStream.getPos ());
+    return out->writeBytes ((const uint8_t*) byteOutStream.getByteArray (),
+                            byteOutStream.getPos ());
+}
+
+}
+}
@@ -19,10 +19,14 @@ namespace cclient {
 namespace data {
 
 LocalityGroupMetaData::LocalityGroupMetaData(uint32_t startBlockVal,
-                                             std::string name)
+                                             std::string name,
+                                             IndexWriter *indexWriter)
     : startBlock(startBlockVal),
       firstKey(NULL),
+      columnFamiliesKnown(false),
+      indexWriter(indexWriter),
       indexManager(NULL) {
+  lastFamily = columnFamilies.end();
   this->name = name;
   if (name == "") {
     isDefaultLG = true;
@@ -35,16 +39,23 @@ LocalityGroupMetaData::LocalityGroupMetaData(
     cclient::data::compression::Compressor *compressorRef, int version,
     cclient::data::streams::InputStream *reader)
     : firstKey(NULL),
+      columnFamiliesKnown(false),
       compressorRef(compressorRef) {
+  lastFamily = columnFamilies.end();
   indexManager = std::make_shared<IndexManager>(compressorRef, reader, version);
 }
 
 LocalityGroupMetaData::~LocalityGroupMetaData() {
+}
 
-  for (auto pair : columnFamilies) {
-    delete[] pair.first.first;
+void LocalityGroupMetaData::addColumnFamily(const char *cf, size_t len) {
+  if (lastFamily == columnFamilies.end() || lastFamily->first.size() != len
+      || memcmp(lastFamily->first.data(), cf, len) != 0) {
+    lastFamily = columnFamilies.insert(
+        std::make_pair(std::string(cf, len), (uint64_t) 0)).first;
   }
-
+  lastFamily->second++;
+  columnFamiliesKnown = true;
 }
 /**
  read function for the Locality Meta Data
@@ -61,20 +72,23 @@ uint64_t LocalityGroupMetaData::read(cclient::data::streams::InputStream *in) {
 
   int size = in->readInt();
 
+  columnFamilies.clear();
+  lastFamily = columnFamilies.end();
   if (size == -1) {
     if (!isDefaultLG)
       throw std::runtime_error("Non default LG");
-
+    columnFamiliesKnown = false;
   } else {
-    columnFamilies.clear();
-
+    std::vector<char> cf;
     for (int32_t i = 0; i < size; i++) {
       int len = in->readInt();
-      uint8_t *cf = new uint8_t[len];
-      in->readBytes(cf, len);
+      cf.resize(len);
+      in->readBytes(cf.data(), len);
       uint64_t count = in->readLong();
-      columnFamilies.insert(std::make_pair(std::make_pair(cf, len), count));
+      columnFamilies.insert(
+          std::make_pair(std::string(cf.data(), len), count));
     }
+    columnFamiliesKnown = true;
   }
 
   if (in->readBoolean()) {
@@ -111,30 +125,18 @@ uint64_t LocalityGroupMetaData::write(
   } else {
     outStream->writeInt(columnFamilies.size());
     // now write out columnFamilies
+    for (auto cf : columnFamilies) {
+      outStream->writeInt(cf.first.size());
+      outStream->writeBytes((const uint8_t*) cf.first.data(), cf.first.size());
+      outStream->writeLong(cf.second);
+    }
   }
   bool haveKey = (firstKey != NULL);
   outStream->writeBoolean(haveKey);
   if (haveKey)
     firstKey->write(outStream);
-  // retrieved the encoded indices.
-  std::pair<char*, size_t> indices = buildIndexArray();
-
-  outStream->writeInt(offsets.size());
-
-  for (std::vector<int>::iterator it = offsets.begin(); it != offsets.end();
-      it++) {
-    outStream->writeInt((*it));
-  }
-
-  // write out the number of indices.
-  outStream->writeInt(indices.second);
-
-  uint64_t pos = outStream->writeBytes((const uint8_t*) indices.first,
-                                       indices.second);
-
-  delete[] indices.first;
-
-  return pos;
+  // the number of data blocks and the root of the index
+  return indexWriter->write(outStream);
 
 }
 }
@@ -33,7 +33,7 @@ MetaBlock::write (cclient::data::streams::DataOutputStream *outStream)
     // write the magic number.
     outStream->writeInt (MAGIC_NUMBER);
     // write version of the RFIle
-    outStream->writeInt (RFILE_VERSION);
+    outStream->writeInt (RFILE_VERSION_7);
     // write the size of the locaity groups.
     outStream->writeInt (localityGroups.size ());
     uint64_t offset = 0;
@@ -23,7 +23,10 @@ RelativeKey::RelativeKey()
     : fieldsSame(0),
       fieldsPrefixed(0),
       key(NULL),
-      prevKey(NULL) {
+      prevKey(NULL),
+      currentSlot(-1),
+      previousSlot(-1),
+      keyCurrent(false) {
 
 }
 
@@ -32,21 +35,14 @@ int RelativeKey::commonPrefix(std::pair<char*, size_t> prev,
   if (prev == curr)
     return -1;  // infinite... exact match
 
-  int prevLen = prev.second;
-  int curLen = curr.second;
-  int maxChecks = std::min(prevLen, curLen);
-  int common = 0;
-  while (common < maxChecks) {
-    int a = prev.first[common] & 0xff;
-    int b = curr.first[common] & 0xff;
-    if (a != b)
-      return common;
-    common++;
-  }
+  size_t maxChecks = std::min(prev.second, curr.second);
+  size_t common = ByteCompare::mismatch(prev.first, curr.first, maxChecks);
+  if (common < maxChecks)
+    return common;
   // no differences found
   // either exact or matches the part checked, so if they are the same length, they are an exact match,
   // and if not, then they have a common prefix over all the checks we've done
-  return prevLen == curLen ? -1 : maxChecks;
+  return prev.second == curr.second ? -1 : maxChecks;
 }
 
 RelativeKey::RelativeKey(std::shared_ptr<Key> previous_key,
@@ -58,6 +54,9 @@ RelativeKey::RelativeKey(std::shared_ptr<Key> previous_key,
   prevKey = NULL;
   fieldsSame = 0;
   fieldsPrefixed = 0;
+  currentSlot = -1;
+  previousSlot = -1;
+  keyCurrent = true;
   setKey(my_key, key);
 
   if (previous_key != NULL) {
@@ -117,25 +116,78 @@ RelativeKey::RelativeKey(std::shared_ptr<Key> previous_key,
 }
 
 std::shared_ptr<streams::StreamInterface> RelativeKey::getStream() {
+  return getKey();
+}
+
+std::shared_ptr<Key> RelativeKey::getKey() {
+  if (keyCurrent || currentSlot < 0)
+    return key;
+  if (key == NULL)
+    key = std::make_shared<Key>();
+  // the key's buffer only grows, so this doesn't allocate once warm
+  std::pair<char*, size_t> row = getRow();
+  std::pair<char*, size_t> cf = getColFamily();
+  std::pair<char*, size_t> cq = getColQualifier();
+  std::pair<char*, size_t> cv = getColVisibility();
+  key->setFields(row.first, row.second, cf.first, cf.second, cq.first,
+                 cq.second, cv.first, cv.second);
+  key->setTimeStamp(getTimeStamp());
+  key->setDeleted(isDeleted());
+  keyCurrent = true;
   return key;
 }
 
+std::shared_ptr<Key> RelativeKey::copyKey() {
+  std::shared_ptr<Key> current = getKey();
+  if (current == NULL)
+    return NULL;
+  return std::make_shared<Key>(current);
+}
+
+void RelativeKey::load(std::shared_ptr<Key> from, uint8_t slot) {
+  DecodedKey &target = decoded[slot];
+  target.bytes.clear();
+  target.offsets[0] = 0;
+  std::pair<char*, size_t> fields[4] = { from->getRow(), from->getColFamily(),
+      from->getColQualifier(), from->getColVisibility() };
+  for (uint8_t i = 0; i < 4; i++) {
+    target.bytes.insert(target.bytes.end(), fields[i].first,
+                        fields[i].first + fields[i].second);
+    target.offsets[i + 1] = target.bytes.size();
+  }
+  target.timestamp = from->getTimeStamp();
+  target.deleted = from->isDeleted();
+}
+
 void RelativeKey::setBase(std::shared_ptr<Key> my_key) {
   if (my_key != NULL) {
-    key = std::make_shared<Key>();
-    setKey(my_key, key);
+    uint8_t slot = previousSlot == 0 ? 1 : 0;
+    load(my_key, slot);
+    currentSlot = slot;
+    keyCurrent = false;
   }
 }
 
 void RelativeKey::setPrevious(std::shared_ptr<Key> previous_key) {
   if (previous_key != NULL) {
-
-    prevKey = std::make_shared<Key>();
-    setKey(previous_key, prevKey);
+    uint8_t slot = currentSlot == 0 ? 1 : 0;
+    load(previous_key, slot);
+    previousSlot = slot;
   }
 }
 
 uint64_t RelativeKey::read(streams::InputStream *stream) {
+  decode(stream);
+  return stream->getPos();
+}
+
+uint64_t RelativeKey::read(streams::BufferedReader *stream) {
+  decode(stream);
+  return stream->getPos();
+}
+
+template<typename Reader>
+void RelativeKey::decode(Reader *stream) {
   fieldsSame = stream->readByte();
 
   if ((fieldsSame & PREFIX_COMPRESSION_ENABLED) == PREFIX_COMPRESSION_ENABLED) {
@@ -144,79 +196,68 @@ uint64_t RelativeKey::read(streams::InputStream *stream) {
     fieldsPrefixed = 0;
   }
 
-  std::vector<char> row, cf, cq, cv;
-  std::vector<char> prevRow, prevCf, prevCq, prevVis;
-
-  std::pair<char*, size_t> scratch = prevKey->getRow();
-
-  prevRow.insert(prevRow.begin(), scratch.first,
-                 scratch.first + scratch.second);
-  scratch = prevKey->getColFamily();
-  prevCf.insert(prevCf.begin(), scratch.first, scratch.first + scratch.second);
-  scratch = prevKey->getColQualifier();
-  prevCq.insert(prevCq.begin(), scratch.first, scratch.first + scratch.second);
-
-  scratch = prevKey->getColVisibility();
-  prevVis.insert(prevVis.begin(), scratch.first,
-                 scratch.first + scratch.second);
-
-  uint64_t timestamp = 0;
-  uint64_t prevTimestamp = prevKey->getTimeStamp();
-
-  int rowCmp = -1, cfCmp = -1, cqCmp = -1, cvCmp = -1;
-
-  readPrefix(stream, &rowCmp, RelativeKey::ROW_SAME, RelativeKey::ROW_PREFIX,
-             fieldsSame, fieldsPrefixed, &row, &prevRow);
-
-  if (readPrefix(stream, &cfCmp, RelativeKey::CF_SAME, RelativeKey::CF_PREFIX,
-                 fieldsSame, fieldsPrefixed, &cf, &prevCf)) {
-
+  if (previousSlot < 0) {
+    // keys built by the writer's constructor exist only as Key objects
+    std::shared_ptr<Key> previous = prevKey != NULL ? prevKey : key;
+    if (previous == NULL)
+      previous = std::make_shared<Key>();
+    load(previous, 0);
+    previousSlot = 0;
   }
 
-  if (readPrefix(stream, &cqCmp, RelativeKey::CQ_SAME, RelativeKey::CQ_PREFIX,
-                 fieldsSame, fieldsPrefixed, &cq, &prevCq)) {
+  const DecodedKey &previous = decoded[previousSlot];
+  uint8_t slot = previousSlot == 0 ? 1 : 0;
+  DecodedKey *target = &decoded[slot];
+  target->bytes.clear();
+  target->offsets[0] = 0;
 
-  }
-
-  if (readPrefix(stream, &cvCmp, RelativeKey::CV_SAME, RelativeKey::CV_PREFIX,
-                 fieldsSame, fieldsPrefixed, &cv, &prevVis)) {
+  readField(stream, ROW_FIELD, ROW_SAME, ROW_PREFIX, target, previous);
+  readField(stream, CF_FIELD, CF_SAME, CF_PREFIX, target, previous);
+  readField(stream, CQ_FIELD, CQ_SAME, CQ_PREFIX, target, previous);
+  readField(stream, CV_FIELD, CV_SAME, CV_PREFIX, target, previous);
 
+  if ((fieldsSame & TS_SAME) == TS_SAME) {
+    target->timestamp = previous.timestamp;
+  } else if ((fieldsPrefixed & TS_DIFF) == TS_DIFF) {
+    target->timestamp = previous.timestamp + stream->readEncodedLong();
+  } else {
+    target->timestamp = stream->readEncodedLong();
   }
+  target->deleted = (fieldsSame & DELETED) == DELETED;
 
-  if ((fieldsSame & RelativeKey::TS_SAME) != RelativeKey::TS_SAME) {
-    prevTimestamp = timestamp;
-
-    timestamp = stream->readEncodedLong();
-    if ((fieldsSame & RelativeKey::TS_DIFF) != RelativeKey::TS_DIFF) {
-      timestamp += prevTimestamp;
-    }
-  } else
-    timestamp = prevTimestamp;
-
-
-  key = std::make_shared<Key>();
-  key->setRow(row.data(), row.size());
-  key->setColFamily(cf.data(), cf.size());
-  key->setColQualifier(cq.data(), cq.size());
-  key->setColVisibility(cv.data(), cv.size());
-  key->setTimeStamp(timestamp);
-
-  prevKey = key;
-
-  return stream->getPos();
-
+  // the key just read is the base of the next
+  currentSlot = slot;
+  previousSlot = slot;
+  keyCurrent = false;
 }
 
-void RelativeKey::readPrefix(streams::InputStream *stream,
-                             std::vector<char> *row,
-                             std::vector<char> *prevRow) {
-  uint32_t prefixLen = stream->readHadoopLong();
-  uint32_t remainingLen = stream->readHadoopLong();
-  row->insert(row->begin(), prevRow->data(), prevRow->data() + prefixLen);
-  char *array = new char[remainingLen];
-  stream->readBytes(array, remainingLen);
-  row->insert(row->end(), array, array + remainingLen);
-  delete[] array;
+template<typename Reader>
+void RelativeKey::readField(Reader *stream, uint8_t field,
+                            uint8_t SAME_FIELD, uint8_t PREFIX,
+                            DecodedKey *target, const DecodedKey &previous) {
+  const char *prevField = previous.bytes.data() + previous.offsets[field];
+  uint32_t prevLen = previous.offsets[field + 1] - previous.offsets[field];
+  std::vector<char> &bytes = target->bytes;
+
+  if ((fieldsSame & SAME_FIELD) == SAME_FIELD) {
+    bytes.insert(bytes.end(), prevField, prevField + prevLen);
+  } else {
+    uint32_t len;
+    if ((fieldsPrefixed & PREFIX) == PREFIX) {
+      uint32_t prefixLen = stream->readEncodedLong();
+      len = stream->readEncodedLong();
+      if (prefixLen > prevLen)
+        throw std::runtime_error("Prefix exceeds the previous key");
+      bytes.insert(bytes.end(), prevField, prevField + prefixLen);
+    } else {
+      len = stream->readEncodedLong();
+    }
+    size_t start = bytes.size();
+    bytes.resize(start + len);
+    if (len > 0)
+      stream->readBytes(bytes.data() + start, len);
+  }
+  target->offsets[field + 1] = bytes.size();
 }
 
 uint64_t RelativeKey::write(streams::OutputStream *outStream) {
@@ -294,23 +335,13 @@ RelativeKey::~RelativeKey() {
 
 void RelativeKey::setKey(std::shared_ptr<Key> keyToCopy,
                          std::shared_ptr<Key> keyToCopyTo) {
-  std::pair<char*, size_t> p = keyToCopy->getRow();
-  keyToCopyTo->setRow(p.first, p.second);
-
-  p = keyToCopy->getColFamily();
-  keyToCopyTo->setColFamily(p.first, p.second);
-  p = keyToCopy->getColQualifier();
-  keyToCopyTo->setColQualifier(p.first, p.second);
-  p = keyToCopy->getColVisibility();
-  keyToCopyTo->setColVisibility(p.first, p.second);
-  keyToCopyTo->setTimeStamp(keyToCopy->getTimeStamp());
-
+  *keyToCopyTo = *keyToCopy;
 }
 
 bool RelativeKey::isSame(std::pair<char*, size_t> a,
                          std::pair<char*, size_t> b) {
-  if (a.second > 0 && a.second == b.second) {
-    return (memcmp(a.first, b.first, a.second) == 0);
+  if (a.second > 0) {
+    return ByteCompare::equals(a.first, a.second, b.first, b.second);
   } else
     return false;
 }
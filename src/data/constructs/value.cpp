@@ -24,7 +24,7 @@ namespace cclient{
 
 
 Value::Value () :
-    valueSize (0)
+    valueSize (0), viewing (false)
 {
     value = new uint8_t[0];
     offset = 0;
@@ -32,18 +32,101 @@ Value::Value () :
 
 Value::~Value ()
 {
-    if (value != NULL)
+    if (value != NULL && !viewing)
         delete[] value;
 }
 
+void
+Value::materialize ()
+{
+    if (!viewing)
+        return;
+
+    uint8_t *ownedValue = new uint8_t[offset];
+    memcpy (ownedValue, value, offset);
+    value = ownedValue;
+    valueSize = offset;
+    viewing = false;
+    owner.reset ();
+}
+
+std::shared_ptr<void>
+Value::dropSlice ()
+{
+    std::shared_ptr<void> previousOwner = std::move (owner);
+    owner.reset ();
+    value = NULL;
+    valueSize = 0;
+    offset = 0;
+    viewing = false;
+    return previousOwner;
+}
+
+void
+Value::setSlice (std::shared_ptr<void> sliceOwner, const uint8_t *val,
+                 size_t size)
+{
+    if (!viewing && value != NULL)
+        delete[] value;
+
+    value = (uint8_t*) val;
+    offset = size;
+    valueSize = size;
+    viewing = true;
+    owner = std::move (sliceOwner);
+}
+
+void
+Value::setValue (std::vector<uint8_t> &&val)
+{
+    std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<
+            std::vector<uint8_t>> (std::move (val));
+    setSlice (bytes, bytes->data (), bytes->size ());
+}
+
+void
+Value::adopt (uint8_t *val, size_t size)
+{
+    if (viewing)
+        dropSlice ();
+    else if (value != NULL && value != val)
+        delete[] value;
+
+    value = val;
+    offset = size;
+    valueSize = size;
+}
+
+void
+Value::share (const Value &other)
+{
+    if (&other == this)
+        return;
+
+    if (other.viewing && NULL != other.owner)
+        setSlice (other.owner, other.value, other.offset);
+    else
+        setValue (other.value, other.offset);
+}
+
 /**
  * Sets the value using the value and the corresponding size and offset.
  */
 void
 Value::setValue (uint8_t *val, size_t size, uint32_t ptrOff)
 {
+    // the slice's buffer is held until val has been copied, as val may
+    // lie within it
+    std::shared_ptr<void> previousOwner;
+    if (viewing)
+    {
+        if (ptrOff == 0)
+            previousOwner = dropSlice ();
+        else
+            materialize ();
+    }
 
-    if ((size + ptrOff) > valueSize)
+    if ((size + ptrOff) > valueSize || value == NULL)
     {
         uint8_t *oldVal = value;
         value = new uint8_t[size + ptrOff];
@@ -67,6 +150,8 @@ Value::setValue (uint8_t *val, size_t size, uint32_t ptrOff)
 void
 Value::append (uint8_t *val, size_t size)
 {
+    if (viewing)
+        materialize ();
     if ((size + offset) > valueSize)
     {
         uint8_t *oldVal = value;
@@ -91,9 +176,12 @@ Value::deepCopy (Value *v)
     v->value = value;
     v->valueSize = valueSize;
     v->offset = offset;
+    v->viewing = viewing;
+    v->owner = std::move (owner);
     value = NULL;
     offset = 0;
     valueSize = 0;
+    viewing = false;
 }
 
 uint8_t *
@@ -130,20 +218,47 @@ Value::write (cclient::data::streams::OutputStream *outStream)
 uint64_t
 Value::read(cclient::data::streams::InputStream *in)
 {
-    if (value != NULL)
-        delete[] value;
-
+    if (viewing)
+        dropSlice ();
     uint32_t size = in->readInt();
-    value = new uint8_t[ size ];
+    if (size > valueSize || value == NULL)
+    {
+        if (value != NULL)
+            delete[] value;
+        value = new uint8_t[ size ];
+        valueSize = size;
+    }
+    offset = size;
     return in->readBytes(value, size );
 }
 
+uint64_t
+Value::read(cclient::data::streams::BufferedReader *in)
+{
+    uint32_t size = in->readInt();
+    setValue((uint8_t*) in->read(size), size);
+    return in->getPos();
+}
+
+uint64_t
+Value::read(cclient::data::streams::BufferedReader *in,
+            const std::shared_ptr<void> &blockOwner, size_t sliceSize)
+{
+    uint32_t size = in->readInt();
+    const uint8_t *bytes = (const uint8_t*) in->read(size);
+    if (NULL != blockOwner && size >= sliceSize)
+        setSlice(blockOwner, bytes, size);
+    else
+        setValue((uint8_t*) bytes, size);
+    return in->getPos();
+}
+
 bool
 Value::operator == (const Value & rhs) const
 {
-    if (valueSize == rhs.valueSize && offset == rhs.offset)
+    if (offset == rhs.offset)
     {
-        return (memcmp (value, rhs.value, valueSize) == 0);
+        return (memcmp (value, rhs.value, offset) == 0);
     }
     else
         return false;
@@ -128,16 +128,7 @@ ByteOutputStream::write (const char *bytes, long cnt)
 
     if (size - offset < (uint64_t)cnt)
     {
-        // we don't have space, so create
-        // a new array that we can copy to
-        //char *nArray = new char[size + (cnt * 2)];
-	 array.resize(size+(cnt*2));
-       // memcpy (nArray, array, offset);
-	//std::copy(array,array+offset,nArray);
-
-        //elete[] array;
-        //array = nArray;
-        size += cnt * 2;
+        grow (cnt);
     }
     //memcpy (array + offset, bytes, cnt);
     std::copy(bytes,bytes+cnt,array.data()+offset);
@@ -145,6 +136,32 @@ ByteOutputStream::write (const char *bytes, long cnt)
     return offset;
 }
 
+/**
+ * Grows the array so that cnt bytes fit after the offset.
+ * @param cnt number of bytes needed
+ */
+void
+ByteOutputStream::grow (size_t cnt)
+{
+    // grow geometrically so that small writes are amortized
+    size_t newSize = size * 2;
+    if (newSize < offset + cnt)
+        newSize = offset + cnt * 2;
+    array.resize (newSize);
+    size = newSize;
+}
+
+/**
+ * Writes a hadoop variable length long directly into the array
+ * @param n value to write
+ * @returns offset
+ */
+uint64_t
+ByteOutputStream::writeVLong (const int64_t n)
+{
+    return commit (VLongEncoder::encode (reserve (VLongEncoder::MAX_LENGTH), n));
+}
+
 /**
  * writes a single byte
  * @param byte incoming byte to write.
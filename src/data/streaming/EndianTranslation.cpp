@@ -48,10 +48,6 @@ uint64_t EndianTranslationStream::writeLong(uint64_t val) {
 	return HadoopDataOutputStream::writeLong(htonlw(val));
 }
 
-uint64_t EndianTranslationStream::writeEncodedLong(const int64_t val) {
-	return HadoopDataOutputStream::writeEncodedLong((int64_t) htonlw(val));
-}
-
 }
 }
 }
@@ -0,0 +1,119 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+#include "../../../../include/data/streaming/input/MappedInputStream.h"
+
+namespace cclient
+{
+namespace data
+{
+namespace streams
+{
+
+MappedRegion::MappedRegion (const std::string &file) :
+    descriptor (-1), mapping (NULL), length (0), identity (0)
+{
+    descriptor = open (file.c_str (), O_RDONLY);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error ("Could not open " + file);
+    }
+
+    struct stat fileStat;
+    if (fstat (descriptor, &fileStat) != 0)
+    {
+        close (descriptor);
+        throw std::runtime_error ("Could not stat " + file);
+    }
+
+    length = fileStat.st_size;
+
+    // whole seconds miss files rewritten within the same second
+    const uint64_t fields[] =
+    { (uint64_t) fileStat.st_dev, (uint64_t) fileStat.st_ino,
+      (uint64_t) fileStat.st_mtim.tv_sec, (uint64_t) fileStat.st_mtim.tv_nsec,
+      length
+    };
+    // FNV-1a over the fields that identify this version of the file
+    identity = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < sizeof (fields) / sizeof (fields[0]); i++)
+    {
+        identity ^= fields[i];
+        identity *= 0x100000001b3ULL;
+    }
+    // generated identifiers have the high bit set
+    identity &= ~(1ULL << 63);
+
+    if (length > 0)
+    {
+        void *addr = mmap (NULL, length, PROT_READ, MAP_SHARED, descriptor, 0);
+        if (addr != MAP_FAILED)
+        {
+            mapping = (uint8_t*) addr;
+            // RFiles are largely read front to back, or at least a block at a time
+            madvise (addr, length, MADV_WILLNEED);
+        }
+        // otherwise we fall back to pread
+    }
+}
+
+MappedRegion::~MappedRegion ()
+{
+    if (NULL != mapping)
+    {
+        munmap (mapping, length);
+    }
+    if (descriptor >= 0)
+    {
+        close (descriptor);
+    }
+}
+
+uint64_t
+MappedRegion::readAt (uint64_t pos, uint8_t *bytes, size_t cnt) const
+{
+    if (pos + cnt > length)
+        throw std::runtime_error ("Stream unavailable");
+
+    if (NULL != mapping)
+    {
+        memcpy (bytes, mapping + pos, cnt);
+        return cnt;
+    }
+
+    size_t total = 0;
+    while (total < cnt)
+    {
+        ssize_t r = pread (descriptor, bytes + total, cnt - total, pos + total);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error ("Failure reading from file");
+        }
+        if (r == 0)
+            throw std::runtime_error ("Stream unavailable");
+        total += r;
+    }
+    return total;
+}
+
+}
+}
+}
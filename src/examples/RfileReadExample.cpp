@@ -28,6 +28,7 @@
 #include "../include/data/constructs/compressor/zlibCompressor.h"
 
 #include "../include/data/streaming/OutputStream.h"
+#include "../include/data/streaming/input/MappedInputStream.h"
 
 #define BOOST_IOSTREAMS_NO_LIB 1
 
@@ -136,19 +137,12 @@ void
 readRfile (std::string outputFile, uint16_t port, bool bigEndian)
 {
 
-    std::ifstream ifs (outputFile.c_str(), std::ifstream::binary | std::ifstream::in);
+    cclient::data::streams::MappedInputStream *stream = new cclient::data::streams::MappedInputStream(outputFile);
 
+    // the mapped stream reads integers in network order, as they are written
 
-    cclient::data::streams::InputStream *stream = new cclient::data::streams::InputStream(&ifs,0);
 
-    if (bigEndian)
-    {
-        // stream = new EndianInputStream(stream);
-    }
-
-
-    std::fstream::pos_type size = filesize(outputFile.c_str());
-    cclient::data::RFile *newRFile = new cclient::data::RFile (stream, size);
+    cclient::data::RFile *newRFile = new cclient::data::RFile (stream, stream->getLength());
     std::vector<uint8_t*> cf;
     cclient::data::streams::StreamSeekable *seekable = new cclient::data::streams::StreamSeekable(new cclient::data::Range(),cf,false);
 
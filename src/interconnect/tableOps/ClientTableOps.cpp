@@ -56,6 +56,15 @@ AccumuloTableOperations::createWriter (cclient::data::security::Authorizations *
 
 }
 
+std::unique_ptr<cclient::data::TabletPartitionedWriter>
+AccumuloTableOperations::createBulkWriter (std::string dir, cclient::data::compression::Compressor *compressor,
+                                           uint64_t memoryBudget, uint16_t threads)
+{
+	if (!exists())
+	  throw cclient::exceptions::ClientException(TABLE_NOT_FOUND);
+	// split points come from the locator's cache of the table's tablets
+	return std::unique_ptr<cclient::data::TabletPartitionedWriter>(new cclient::data::TabletPartitionedWriter (dir, listSplits(), compressor, memoryBudget, threads));
+}
 
 void
 AccumuloTableOperations::loadTableOps (bool force)
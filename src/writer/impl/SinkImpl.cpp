@@ -94,14 +94,17 @@ void Writer::flush(bool override) {
 
       std::shared_ptr<cclient::data::Key> key = kv.at(i)->getKey();
       std::shared_ptr<cclient::data::Value> value = kv.at(i)->getValue();
+      std::pair<char*, size_t> cf = key->getColFamily();
+      std::pair<char*, size_t> cq = key->getColQualifier();
+      std::pair<char*, size_t> cv = key->getColVisibility();
       if (NULL != prevMutation) {
         std::pair<char*, size_t> row = key->getRow();
         if (row.second > 0) {
-          std::string rowStr = std::string(row.first, row.second);
-          if (prevMutation->getRow() == rowStr) {
+          if (prevMutation->getRow().compare(0, std::string::npos, row.first,
+                                             row.second) == 0) {
 
-            prevMutation->put(key->getColFamilyStr(), key->getColQualifierStr(),
-                              key->getColVisibilityStr(), key->getTimeStamp(),
+            prevMutation->put(cf.first, cf.second, cq.first, cq.second,
+                              cv.first, cv.second, key->getTimeStamp(),
                               key->isDeleted(), value->data(), value->size());
             continue;
           }
@@ -110,10 +113,10 @@ void Writer::flush(bool override) {
 
       }
       cclient::data::Mutation *m = new cclient::data::Mutation(
-          key->getRowStr());
-      m->put(key->getColFamilyStr(), key->getColQualifierStr(),
-             key->getColVisibilityStr(), key->getTimeStamp(), key->isDeleted(),
-             value->data(), value->size());
+          key->getRowStr(), &mutationPool);
+      m->put(cf.first, cf.second, cq.first, cq.second, cv.first, cv.second,
+             key->getTimeStamp(), key->isDeleted(), value->data(),
+             value->size());
       prevMutation = m;
       mutation->push_back(m);
 
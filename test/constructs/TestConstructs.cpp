@@ -25,6 +25,10 @@ using namespace std;
 #include "../../include/data/constructs/value.h"
 #include "../../include/data/constructs/KeyValue.h"
 #include "../../include/data/constructs/rkey.h"
+#include "../../include/data/constructs/ScanArena.h"
+#include "../../include/data/constructs/Mutation.h"
+#include "../../include/data/streaming/input/BufferedReader.h"
+#include "../../include/data/streaming/ByteOutputStream.h"
 #include <sys/time.h>
 //#include <snappy.h>
 
@@ -185,3 +189,306 @@ TEST_CASE("Test IterInfo", "[createAndSet]") {
 
 
 }
+
+TEST_CASE("Test arena backed key values", "[arena]") {
+
+	std::weak_ptr<ScanArena> released;
+	std::shared_ptr<KeyValue> kv;
+	{
+		std::shared_ptr<ScanArena> arena = std::make_shared<ScanArena>(64);
+		released = arena;
+		ArenaAllocator<char> allocator(arena);
+
+		std::shared_ptr<KeyValue> first;
+		for (int i = 0; i < 1000; i++) {
+			std::string row = "row" + std::to_string(i);
+			char *rowBytes = arena->copy(row.c_str(), row.size());
+			char *cf = arena->copy("cf", 2);
+			char *cq = arena->copy("cq", 2);
+			char *cv = arena->copy("", 0);
+			REQUIRE((void*) cv != nullptr);
+			std::shared_ptr<Key> key = std::allocate_shared<Key>(allocator, rowBytes, row.size(), cf, 2, cq, 2, cv, 0, i, false, FieldView());
+			std::shared_ptr<Value> value = std::allocate_shared<Value>(allocator, (const uint8_t*) arena->copy("value", 5), 5, FieldView());
+			std::shared_ptr<KeyValue> entry = std::allocate_shared<KeyValue>(allocator, key, value);
+			if (i == 0)
+				first = entry;
+			if (i == 500)
+				kv = entry;
+		}
+
+		REQUIRE(arena->getCapacity() > 1000 * (sizeof(Key) + sizeof(Value)));
+		REQUIRE(first->getKey()->getRowStr() == "row0");
+		// keys remain usable as stream interfaces
+		REQUIRE(first->getKey()->getStream().get() == first->getKey().get());
+
+		// modifying a key copies its fields out of the arena
+		first->getKey()->setColFamily("family");
+		REQUIRE(first->getKey()->getRowStr() == "row0");
+		REQUIRE(first->getKey()->getColFamilyStr() == "family");
+		REQUIRE(first->getKey()->getColQualifierStr() == "cq");
+		first->getValue()->append((uint8_t*) "s", 1);
+		REQUIRE(std::string((char*) first->getValue()->data(), first->getValue()->size()) == "values");
+	}
+
+	// a single entry holds the arena
+	REQUIRE(released.lock() != nullptr);
+	REQUIRE(kv->getKey()->getRowStr() == "row500");
+	REQUIRE(kv->getKey()->getTimeStamp() == 500);
+	REQUIRE(std::string((char*) kv->getValue()->data(), kv->getValue()->size()) == "value");
+
+	kv = nullptr;
+	REQUIRE(released.lock() == nullptr);
+}
+
+static void checkKey(Key &key, const std::string *expected) {
+	REQUIRE(key.getRowStr() == expected[0]);
+	REQUIRE(key.getColFamilyStr() == expected[1]);
+	REQUIRE(key.getColQualifierStr() == expected[2]);
+	REQUIRE(key.getColVisibilityStr() == expected[3]);
+}
+
+TEST_CASE("Test key fields spill from the inline buffer", "[keyStorage]") {
+
+	srand(7);
+	Key key;
+	std::string expected[4];
+	for (int i = 0; i < 2000; i++) {
+		int field = rand() % 4;
+		// mostly short fields, occasionally exceeding the inline buffer
+		std::string data(rand() % 8 == 0 ? 20 + rand() % 100 : rand() % 16, 'a' + rand() % 26);
+		switch (field) {
+		case 0:
+			key.setRow(data.c_str(), data.size());
+			break;
+		case 1:
+			key.setColFamily(data.c_str(), data.size());
+			break;
+		case 2:
+			if (rand() % 2 == 0 && !expected[2].empty()) {
+				uint32_t offset = rand() % expected[2].size();
+				key.setColQualifier(data.c_str(), data.size(), offset);
+				data = expected[2].substr(0, offset) + data;
+			} else
+				key.setColQualifier(data.c_str(), data.size());
+			break;
+		case 3:
+			key.setColVisibility(data.c_str(), data.size());
+			break;
+		}
+		expected[field] = data;
+		checkKey(key, expected);
+	}
+
+	key.setTimeStamp(42);
+	Key copy(key);
+	checkKey(copy, expected);
+	REQUIRE(copy == key);
+
+	Key moved(std::move(copy));
+	checkKey(moved, expected);
+	REQUIRE(moved.getTimeStamp() == 42);
+
+	// spilled fields are taken rather than copied
+	Key spilled;
+	std::string longRow(200, 'r');
+	spilled.setRow(longRow);
+	const char *storage = spilled.getRow().first;
+	Key taken(std::move(spilled));
+	REQUIRE((const void*) taken.getRow().first == (const void*) storage);
+	REQUIRE(taken.getRowStr() == longRow);
+	REQUIRE(spilled.getRowStr().empty());
+
+	// fields may be set from the key's own storage
+	std::pair<char*, size_t> cf = moved.getColFamily();
+	moved.setRow(cf.first, cf.second);
+	expected[0] = expected[1];
+	checkKey(moved, expected);
+
+	Key small;
+	small.setFields("row", 3, "cf", 2, "cq", 2, "", 0);
+	moved = small;
+	REQUIRE(moved.getRowStr() == "row");
+	REQUIRE(moved.getColQualifierStr() == "cq");
+
+	// views are copied out of the arena once modified
+	Key view("r1", 2, "f", 1, "q", 1, "v", 1, 5, false, FieldView());
+	view.setColQualifier("qualifier", 9);
+	REQUIRE(view.getRowStr() == "r1");
+	REQUIRE(view.getColQualifierStr() == "qualifier");
+	REQUIRE(view.getColVisibilityStr() == "v");
+}
+
+TEST_CASE("Test keys with empty fields round trip", "[keyStorage]") {
+
+	Key key;
+	key.setFields("row", 3, "cf", 2, "cq", 2, "vis", 3);
+	key.setTimeStamp(7);
+	key.setRow("", 0);
+	key.setColFamily("", 0);
+	key.setColQualifier("", 0);
+	key.setColVisibility("", 0);
+	std::string expected[4];
+	checkKey(key, expected);
+
+	// a preserved prefix longer than the field is clamped to the field
+	key.setColQualifier("", 0, 5);
+	checkKey(key, expected);
+	key.setColQualifier("q", 1, 5);
+	expected[2] = "q";
+	checkKey(key, expected);
+	key.setColQualifier("", 0);
+	expected[2] = "";
+
+	ByteOutputStream out(64);
+	key.write(&out);
+	BufferedReader reader(out.getByteArray(), out.getPos());
+	Key copy;
+	copy.setFields("other", 5, "f", 1, "q", 1, "v", 1);
+	copy.read(&reader);
+	checkKey(copy, expected);
+	REQUIRE(copy.getTimeStamp() == 7);
+	REQUIRE(copy == key);
+}
+
+TEST_CASE("Test values slice shared buffers", "[valueSlice]") {
+
+	// two serialized values: a small one followed by a large one
+	std::string large(100000, 'x');
+	std::shared_ptr<std::vector<char>> block = std::make_shared<std::vector<char>>();
+	std::string small = "small";
+	for (const std::string *v : { &small, &large }) {
+		uint32_t len = htonl(v->size());
+		block->insert(block->end(), (char*) &len, (char*) &len + 4);
+		block->insert(block->end(), v->begin(), v->end());
+	}
+	std::weak_ptr<std::vector<char>> released = block;
+
+	Value value;
+	Value other;
+	{
+		std::shared_ptr<void> owner = block;
+		BufferedReader reader(block->data(), block->size());
+
+		value.read(&reader, owner);
+		REQUIRE_FALSE(value.isSlice());
+		REQUIRE(std::string((char*) value.data(), value.size()) == small);
+
+		value.read(&reader, owner);
+		REQUIRE(value.isSlice());
+		REQUIRE((const void*) value.data() == (const void*) (block->data() + block->size() - large.size()));
+		REQUIRE(std::string((char*) value.data(), value.size()) == large);
+
+		// shared rather than copied across hops
+		other.share(value);
+		REQUIRE(other.isSlice());
+		REQUIRE((const void*) other.data() == (const void*) value.data());
+		REQUIRE(other == value);
+
+		Value constructed(owner, (const uint8_t*) block->data() + 4, small.size());
+		REQUIRE(constructed.isSlice());
+		REQUIRE(std::string((char*) constructed.data(), constructed.size()) == small);
+	}
+	block = nullptr;
+	REQUIRE(released.lock() != nullptr);
+
+	other.materialize();
+	REQUIRE_FALSE(other.isSlice());
+	REQUIRE(std::string((char*) other.data(), other.size()) == large);
+
+	// replacing a slice releases the buffer
+	value.setValue((uint8_t*) "abc", 3);
+	REQUIRE_FALSE(value.isSlice());
+	REQUIRE(std::string((char*) value.data(), value.size()) == "abc");
+	REQUIRE(released.lock() == nullptr);
+}
+
+TEST_CASE("Test construct APIs taking ownership of buffers", "[ownership]") {
+
+	// updates written from spans match those written from strings
+	Mutation fromStrings("row");
+	fromStrings.put("cf", "cq", "vis", 5, false, (uint8_t*) "value", 5);
+	fromStrings.put("cf2", "", "", 6, true);
+	Mutation fromSpans(std::string("row"));
+	fromSpans.put("cf", 2, "cq", 2, "vis", 3, 5, false, (const uint8_t*) "value", 5);
+	fromSpans.put("cf2", 3, "", 0, "", 0, 6, true);
+	REQUIRE(fromSpans.getRow() == "row");
+	REQUIRE(fromSpans.size() == 2);
+	REQUIRE(fromSpans.getDataStr() == fromStrings.getDataStr());
+
+	// packed fields are adopted rather than copied
+	char *fields = new char[128];
+	memcpy(fields, "rowcfcqvis", 10);
+	Key key;
+	key.adoptFields(fields, 128, 3, 2, 2, 3);
+	REQUIRE((const void*) key.getRow().first == (const void*) fields);
+	REQUIRE(key.getRowStr() == "row");
+	REQUIRE(key.getColFamilyStr() == "cf");
+	REQUIRE(key.getColQualifierStr() == "cq");
+	REQUIRE(key.getColVisibilityStr() == "vis");
+	std::unique_ptr<char[]> small(new char[4]);
+	REQUIRE_THROWS(key.adoptFields(small.get(), 4, 3, 2, 0, 0));
+	REQUIRE(key.getRowStr() == "row");
+
+	std::vector<uint8_t> bytes(1000, 'v');
+	const uint8_t *moved = bytes.data();
+	Value value;
+	value.setValue(std::move(bytes));
+	REQUIRE((const void*) value.data() == (const void*) moved);
+	REQUIRE(value.size() == 1000);
+
+	uint8_t *buffer = new uint8_t[3];
+	memcpy(buffer, "abc", 3);
+	value.adopt(buffer, 3);
+	REQUIRE_FALSE(value.isSlice());
+	REQUIRE((const void*) value.data() == (const void*) buffer);
+	REQUIRE(std::string((char*) value.data(), value.size()) == "abc");
+}
+
+TEST_CASE("Test mutations serialize into a single buffer", "[mutation]") {
+
+	std::string large(5000, 'v');
+	ByteOutputStream expected(1024);
+	for (int64_t ts : { (int64_t) 5, (int64_t) 1234567890123LL, (int64_t) -200 }) {
+		expected.writeVLong(2);
+		expected.write("cf", 2);
+		expected.writeVLong(2);
+		expected.write("cq", 2);
+		expected.writeVLong(3);
+		expected.write("vis", 3);
+		expected.writeBoolean(true);
+		expected.writeVLong(ts);
+		expected.writeBoolean(ts < 0);
+		expected.writeVLong(large.size());
+		expected.write(large.data(), large.size());
+	}
+	std::string expectedData(expected.getByteArray(), expected.getPos());
+
+	MutationBufferPool pool;
+	const void *buffer = NULL;
+	{
+		Mutation mutation("row", &pool);
+		for (int64_t ts : { (int64_t) 5, (int64_t) 1234567890123LL, (int64_t) -200 }) {
+			mutation.put("cf", "cq", "vis", ts, ts < 0, (uint8_t*) large.data(), large.size());
+		}
+		REQUIRE(mutation.size() == 3);
+		REQUIRE(mutation.getDataStr() == expectedData);
+		REQUIRE(mutation.getData().second == expectedData.size());
+
+		// the buffer is moved out and back rather than copied
+		buffer = mutation.getData().first;
+		std::string released = mutation.releaseData();
+		REQUIRE((const void*) released.data() == buffer);
+		REQUIRE(released == expectedData);
+		REQUIRE(mutation.getData().second == 0);
+		mutation.restoreData(std::move(released));
+		REQUIRE((const void*) mutation.getData().first == buffer);
+		REQUIRE(mutation.getDataStr() == expectedData);
+	}
+
+	// a later mutation of a similar size reuses the released buffer
+	Mutation reused("row2", &pool);
+	reused.put("cf", "cq", "vis", 5, false, (uint8_t*) large.data(), large.size());
+	reused.put("cf", "cq", "vis", 5, false, (uint8_t*) large.data(), large.size());
+	reused.put("cf", "cq", "vis", 5, false, (uint8_t*) large.data(), large.size());
+	REQUIRE((const void*) reused.getData().first == buffer);
+}
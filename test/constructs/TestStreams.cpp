@@ -18,6 +18,11 @@ using namespace std;
 #include "../../include/data/streaming/NetworkOrderStream.h"
 #include "../../include/data/streaming/input/ByteInputStream.h"
 #include "../../include/data/streaming/input/NetworkOrderInputStream.h"
+#include "../../include/data/streaming/input/MappedInputStream.h"
+#include "../../include/data/streaming/input/BufferedReader.h"
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 
 #define CATCH_CONFIG_MAIN
@@ -76,3 +81,120 @@ TEST_CASE("TestEndianStream", "[testSerDer]") {
 	delete byte;
 	
 }
+
+
+TEST_CASE("TestMappedStream", "[testSerDer]") {
+
+	// integers are read in network order
+	ByteOutputStream *byte = new BigEndianByteStream(1024);
+
+	byte->writeInt(5);
+	byte->writeString("Hello world");
+	byte->writeLong(1445105294261L);
+
+	std::ofstream ofs("/tmp/mapped_stream.bin", std::ofstream::out | std::ofstream::binary);
+	ofs.write(byte->getByteArray(), byte->getPos());
+	ofs.close();
+
+	MappedInputStream *inVerification = new MappedInputStream("/tmp/mapped_stream.bin");
+
+	REQUIRE(byte->getPos() == inVerification->getLength());
+	REQUIRE(5 == inVerification->readInt());
+	REQUIRE("Hello world" == inVerification->readString());
+
+	// a duplicate shares the mapping, but not the position
+	MappedInputStream *duplicate = inVerification->duplicate();
+	REQUIRE(0 == duplicate->getPos());
+	REQUIRE(5 == duplicate->readInt());
+
+	REQUIRE(1445105294261L == inVerification->readLong());
+	REQUIRE(0 == inVerification->bytesAvailable());
+
+	uint8_t positional[4];
+	inVerification->readAt(0, positional, 4);
+	REQUIRE(0 == memcmp(positional, byte->getByteArray(), 4));
+	REQUIRE(0 == memcmp(inVerification->getSpan(4, 1), byte->getByteArray() + 4, 1));
+
+	REQUIRE_THROWS(inVerification->readByte());
+
+	delete duplicate;
+
+	delete inVerification;
+
+	delete byte;
+
+}
+
+TEST_CASE("TestMappedIdentity", "[testSerDer]") {
+	std::ofstream ofs("/tmp/mapped_identity.bin", std::ofstream::out | std::ofstream::binary);
+	ofs.write("identity", 8);
+	ofs.close();
+
+	// rewrites within the same second are told apart
+	struct timespec times[2];
+	times[0].tv_sec = times[1].tv_sec = 1500000000;
+	times[0].tv_nsec = times[1].tv_nsec = 1000;
+	REQUIRE(0 == utimensat(AT_FDCWD, "/tmp/mapped_identity.bin", times, 0));
+	MappedRegion first("/tmp/mapped_identity.bin");
+	MappedRegion same("/tmp/mapped_identity.bin");
+	REQUIRE(first.getIdentity() == same.getIdentity());
+
+	times[0].tv_nsec = times[1].tv_nsec = 2000;
+	REQUIRE(0 == utimensat(AT_FDCWD, "/tmp/mapped_identity.bin", times, 0));
+	MappedRegion modified("/tmp/mapped_identity.bin");
+	REQUIRE(first.getIdentity() != modified.getIdentity());
+}
+
+TEST_CASE("TestBufferedReader", "[testSerDer]") {
+	BigEndianByteStream *byte = new BigEndianByteStream(1024);
+	byte->writeInt(5);
+	byte->writeVLong(7);
+	byte->writeVLong(300);
+	byte->writeVLong(-1000);
+	byte->writeVLong(-5);
+	byte->writeBytes("abc", 3);
+	byte->writeBoolean(true);
+
+	BufferedReader reader((const char*) byte->getByteArray(), byte->getPos());
+	EndianInputStream stream((char*) byte->getByteArray(), byte->getPos());
+	REQUIRE(5 == reader.readInt());
+	REQUIRE(5 == stream.readInt());
+	REQUIRE(7 == reader.readEncodedLong());
+	REQUIRE(300 == reader.readEncodedLong());
+	REQUIRE(-1000 == reader.readEncodedLong());
+	REQUIRE(-5 == reader.readEncodedLong());
+	REQUIRE(7 == stream.readEncodedLong());
+	REQUIRE(300 == stream.readEncodedLong());
+	REQUIRE(-1000 == stream.readEncodedLong());
+	REQUIRE(0 == memcmp(reader.read(3), "abc", 3));
+	REQUIRE(reader.readBoolean());
+	REQUIRE(0 == reader.remaining());
+	REQUIRE(byte->getPos() == reader.getPos());
+	REQUIRE_THROWS(reader.readByte());
+
+	delete byte;
+}
+
+TEST_CASE("TestVLongEncoding", "[testSerDer]") {
+	std::vector<int64_t> values = { 0, 1, -1, 127, 128, -112, -113, -32, -33,
+			300, -1000, 65535, 1L << 20, -(1L << 27), 1L << 35, -(1L << 43),
+			1L << 50, INT64_MAX, INT64_MIN };
+
+	BigEndianByteStream *byte = new BigEndianByteStream(1);
+	for (int64_t value : values) {
+		byte->writeVLong(value);
+		byte->writeEncodedLong(value);
+	}
+
+	BufferedReader reader((const char*) byte->getByteArray(), byte->getPos());
+	EndianInputStream stream((char*) byte->getByteArray(), byte->getPos());
+	for (int64_t value : values) {
+		REQUIRE(value == reader.readEncodedLong());
+		REQUIRE(value == reader.readHadoopLong());
+		REQUIRE(value == stream.readEncodedLong());
+		REQUIRE(value == stream.readHadoopLong());
+	}
+	REQUIRE(0 == reader.remaining());
+
+	delete byte;
+}
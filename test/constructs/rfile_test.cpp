@@ -15,16 +15,34 @@
 #include <fstream>
 #include <string>
 #include <set>
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
 #include <netinet/in.h>
+#include <zlib.h>
 #include <stdint.h>
 #include "../../include/data/constructs/compressor/compressor.h"
 #include "../../include/data/constructs/compressor/zlibCompressor.h"
+#include "../../include/data/constructs/compressor/zstdCompressor.h"
+#include "../../include/data/constructs/compressor/compression_algorithm.h"
 #include "../../include/data/constructs/rfile/RFile.h"
+#include "../../include/data/constructs/rfile/BulkRFileBuilder.h"
+#include "../../include/data/constructs/rfile/TabletPartitionedWriter.h"
+#include "../../include/data/constructs/rfile/LocalRFile.h"
+#include "../../include/data/constructs/rfile/ParallelScan.h"
+#include "../../include/data/constructs/rfile/meta/IndexWriter.h"
+#include "../../include/data/constructs/rfile/meta/IndexBlock.h"
+#include "../../include/data/streaming/input/NetworkOrderInputStream.h"
+#include "../../include/data/streaming/input/MappedInputStream.h"
+#include "../../include/data/streaming/accumulo/StreamSeekable.h"
 
 #include "../../include/data/constructs/Key.h"
 #include "../../include/data/constructs/value.h"
 #include "../../include/data/constructs/KeyValue.h"
+#include "../../include/data/constructs/KeyValueBatch.h"
 #include "../../include/data/constructs/rkey.h"
+#include "../../include/data/constructs/ByteCompare.h"
 #include <sys/time.h>
 
 
@@ -133,3 +151,1058 @@ TEST_CASE("Create rfile", "[CreateRfile]") {
 	}
 
 }
+
+/**
+ * Writes an RFile holding rows 0 to rows - 1, each with a single key.
+ */
+static std::string writeSortedRFile(int rows) {
+	cclient::data::compression::ZLibCompressor compressor(1024);
+	cclient::data::BlockCompressedFile bcFile(&compressor);
+	cclient::data::streams::BigEndianByteStream outStream(16 * 1024 * 1024);
+	cclient::data::RFile rfile(&outStream, &bcFile);
+	rfile.addLocalityGroup();
+	char rw[13];
+	for (int i = 0; i < rows; i++) {
+		std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+		sprintf(rw, "%08d", i);
+		k->setRow((const char*) rw, 8);
+		k->setColFamily((const char*) rw, 3);
+		k->setColQualifier((const char*) rw, 8);
+		std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared<cclient::data::KeyValue>();
+		kv->setKey(k, true);
+		kv->setValue(std::make_shared<cclient::data::Value>());
+		rfile.append(kv);
+	}
+	rfile.close();
+	return std::string(outStream.getByteArray(), outStream.getPos());
+}
+
+static void writeFile(const std::string &name, const std::string &contents) {
+	std::ofstream out(name, std::ofstream::binary | std::ofstream::trunc);
+	out.write(contents.data(), contents.size());
+}
+
+static std::vector<std::string> scanRows(cclient::data::RFile *rfile, cclient::data::Range *range = NULL) {
+	cclient::data::Range infinite;
+	cclient::data::streams::StreamSeekable seekable(NULL == range ? &infinite : range, std::vector<uint8_t*>(), false);
+	rfile->relocate(&seekable);
+	std::vector<std::string> rows;
+	while (rfile->hasNext()) {
+		rows.push_back((**rfile).first->getRowStr());
+		rfile->next();
+	}
+	return rows;
+}
+
+TEST_CASE("Mapped streams read written RFiles", "[MappedRFile]") {
+	// a single data block
+	writeFile("/tmp/mapped.rf", writeSortedRFile(200));
+
+	cclient::data::streams::MappedInputStream stream("/tmp/mapped.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	std::vector<std::string> rows = scanRows(&rfile);
+	REQUIRE(rows.size() == 200);
+	REQUIRE(rows.front() == "00000000");
+	REQUIRE(rows.back() == "00000199");
+	REQUIRE(std::is_sorted(rows.begin(), rows.end()));
+
+	// positional reads leave the stream where it was
+	char magic[4];
+	stream.seek(10);
+	REQUIRE(stream.readAt(0, (uint8_t*) magic, 4) == 4);
+	REQUIRE(stream.getPos() == 10);
+}
+
+TEST_CASE("Unmapped streams read data blocks positionally", "[MappedRFile]") {
+	writeFile("/tmp/unmapped.rf", writeSortedRFile(5000));
+
+	std::ifstream in("/tmp/unmapped.rf", std::ifstream::binary);
+	in.seekg(0, std::ifstream::end);
+	long length = in.tellg();
+	in.seekg(0);
+	cclient::data::streams::InputStream file(&in, 0);
+	// reads integers in network order
+	cclient::data::streams::EndianInputStream stream(&file);
+	cclient::data::RFile rfile(&stream, length);
+	std::vector<std::string> rows = scanRows(&rfile);
+	REQUIRE(rows.size() == 5000);
+	REQUIRE(rows.front() == "00000000");
+	REQUIRE(rows.back() == "00004999");
+
+	// positional reads leave the stream where it was
+	char magic[4];
+	stream.seek(10);
+	REQUIRE(stream.readAt(0, (uint8_t*) magic, 4) == 4);
+	REQUIRE(stream.getPos() == 10);
+	REQUIRE(in.tellg() == 10);
+}
+
+TEST_CASE("Block cache evicts least recently used blocks", "[BlockCache]") {
+	// single shard so that eviction order is deterministic
+	cclient::data::BlockCache cache(3 * 1024, 1);
+
+	for (uint64_t offset = 0; offset < 3; offset++) {
+		cache.put(1, offset, std::make_shared<cclient::data::DecompressedBlock>(1024));
+	}
+	REQUIRE(cache.getSize() == 3 * 1024);
+
+	// touch the oldest block so that the second is evicted
+	REQUIRE(cache.get(1, 0) != nullptr);
+	cache.put(1, 3, std::make_shared<cclient::data::DecompressedBlock>(1024));
+
+	REQUIRE(cache.get(1, 1) == nullptr);
+	REQUIRE(cache.get(1, 0) != nullptr);
+	REQUIRE(cache.get(1, 3) != nullptr);
+	// blocks are keyed by file as well as offset
+	REQUIRE(cache.get(2, 0) == nullptr);
+	REQUIRE(cache.getEvictionCount() == 1);
+	REQUIRE(cache.getHitCount() == 3);
+	REQUIRE(cache.getMissCount() == 2);
+
+	cache.setMaxSize(1024);
+	REQUIRE(cache.getSize() <= 1024);
+
+	std::shared_ptr<cclient::data::DecompressedBlock> block = std::make_shared<cclient::data::DecompressedBlock>(4);
+	block->at(0) = 0x01;
+	cache.put(3, 0, block);
+	cache.clear();
+	REQUIRE(cache.getSize() == 0);
+
+	// readers keep evicted blocks alive
+	cclient::data::CachedBlockInputStream stream(block);
+	REQUIRE(stream.readByte() == 0x01);
+}
+
+TEST_CASE("Index block cache shares the first parsed block", "[IndexBlockCache]") {
+	cclient::data::IndexBlockCache cache;
+	REQUIRE(cache.get(100) == nullptr);
+
+	std::shared_ptr<cclient::data::IndexBlock> first = std::make_shared<cclient::data::IndexBlock>(7);
+	std::shared_ptr<cclient::data::IndexBlock> second = std::make_shared<cclient::data::IndexBlock>(7);
+	REQUIRE(cache.put(100, first) == first);
+	// a concurrent load of the same block yields the cached copy
+	REQUIRE(cache.put(100, second) == first);
+	REQUIRE(cache.get(100) == first);
+	REQUIRE(cache.size() == 1);
+}
+
+TEST_CASE("Index traversal crosses data blocks", "[IndexTraversal]") {
+	writeFile("/tmp/blocks.rf", writeSortedRFile(5000));
+
+	cclient::data::streams::MappedInputStream stream("/tmp/blocks.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	std::vector<std::string> rows = scanRows(&rfile);
+	REQUIRE(rows.size() == 5000);
+	char rw[13];
+	for (int i = 0; i < 5000; i++) {
+		sprintf(rw, "%08d", i);
+		REQUIRE(rows.at(i) == rw);
+	}
+}
+
+TEST_CASE("Key index searches serialized keys", "[KeyIndex]") {
+	cclient::data::streams::ByteOutputStream outStream(1024);
+	std::vector<int> offsets;
+	char rw[9];
+	for (int i = 0; i < 10; i++) {
+		cclient::data::Key k;
+		sprintf(rw, "row%05d", i * 2);
+		k.setRow(rw, 8);
+		k.setColFamily("cf", 2);
+		k.setColQualifier("cq", 2);
+		k.setTimeStamp(i);
+		offsets.push_back(outStream.getPos());
+		k.write(&outStream);
+	}
+
+	cclient::data::KeyIndex index(offsets, (uint8_t*) outStream.getByteArray(), outStream.getPos());
+
+	std::shared_ptr<cclient::data::Key> read = index.get(3);
+	REQUIRE(read->getRowStr() == "row00006");
+	REQUIRE(read->getColFamilyStr() == "cf");
+	REQUIRE(read->getColQualifierStr() == "cq");
+	REQUIRE(read->getTimeStamp() == 3);
+	REQUIRE(index.binary_search(read) == 3);
+
+	// absent keys yield -(insertion point) - 1
+	std::shared_ptr<cclient::data::Key> search = std::make_shared<cclient::data::Key>();
+	search->setRow("row00007", 8);
+	REQUIRE(index.binary_search(search) == -5);
+	search->setRow("row", 3);
+	REQUIRE(index.binary_search(search) == -1);
+	search->setRow("row99999", 8);
+	REQUIRE(index.binary_search(search) == -11);
+
+	// newer timestamps sort first
+	search->setRow("row00006", 8);
+	search->setColFamily("cf", 2);
+	search->setColQualifier("cq", 2);
+	search->setTimeStamp(4);
+	REQUIRE(index.compare(3, *search) < 0);
+	search->setTimeStamp(2);
+	REQUIRE(index.compare(3, *search) > 0);
+}
+
+TEST_CASE("Seeks land within a data block", "[KeyIndex]") {
+	writeFile("/tmp/blocks.rf", writeSortedRFile(5000));
+
+	cclient::data::streams::MappedInputStream stream("/tmp/blocks.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	char rw[13];
+	for (int row = 0; row < 5000; row += 499) {
+		sprintf(rw, "%08d", row);
+		std::shared_ptr<cclient::data::Key> start = std::make_shared<cclient::data::Key>();
+		start->setRow(rw, 8);
+		cclient::data::Range range(start, true, nullptr, false);
+		std::vector<std::string> rows = scanRows(&rfile, &range);
+		REQUIRE(rows.size() == 5000 - row);
+		REQUIRE(rows.front() == rw);
+		REQUIRE(rows.back() == "00004999");
+	}
+}
+
+static std::string describe(const std::shared_ptr<cclient::data::Key> &k, cclient::data::Value *v) {
+	return k->getRowStr() + "|" + k->getColFamilyStr() + "|" + k->getColQualifierStr() + "|"
+			+ k->getColVisibilityStr() + "|" + std::to_string(k->getTimeStamp()) + "="
+			+ std::string((char*) v->data(), v->size());
+}
+
+static std::vector<std::string> scanRFile(cclient::data::RFile *rfile, cclient::data::Range *range = NULL,
+		std::vector<std::string> families = std::vector<std::string>(), bool inclusive = false) {
+	cclient::data::Range infinite;
+	cclient::data::streams::StreamSeekable seekable(NULL == range ? &infinite : range, families, inclusive);
+	rfile->relocate(&seekable);
+	std::vector<std::string> entries;
+	while (rfile->hasNext()) {
+		entries.push_back(describe((**rfile).first, rfile->getTopValue()));
+		rfile->next();
+	}
+	return entries;
+}
+
+typedef std::pair<std::string, std::vector<std::string> > GroupFamilies;
+
+/**
+ * Writes an RFile with a locality group per entry of groups, each holding
+ * every row with each of the group's column families.
+ */
+static std::string writeGroupedRFile(const std::vector<GroupFamilies> &groups, int rows, int rowStep = 1) {
+	cclient::data::compression::ZLibCompressor compressor(1024);
+	cclient::data::BlockCompressedFile bcFile(&compressor);
+	cclient::data::streams::BigEndianByteStream outStream(16 * 1024 * 1024);
+	cclient::data::RFile rfile(&outStream, &bcFile);
+	char rw[13];
+	for (size_t g = 0; g < groups.size(); g++) {
+		rfile.addLocalityGroup(groups.at(g).first);
+		for (int i = 0; i < rows; i++) {
+			// groups hold interleaved rows when a step is given
+			sprintf(rw, "%08d", (int) (i * rowStep + g % rowStep));
+			for (const std::string &family : groups.at(g).second) {
+				std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+				k->setRow((const char*) rw, 8);
+				k->setColFamily(family);
+				k->setColQualifier("cq");
+				std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared<cclient::data::KeyValue>();
+				kv->setKey(k, true);
+				kv->setValue((uint8_t*) family.data(), family.size());
+				rfile.append(kv);
+			}
+		}
+	}
+	rfile.close();
+	return std::string(outStream.getByteArray(), outStream.getPos());
+}
+
+TEST_CASE("Named locality groups record their column families", "[LocalityGroups]") {
+	std::vector<GroupFamilies> groups;
+	groups.push_back(GroupFamilies("meta", { "a", "b" }));
+	groups.push_back(GroupFamilies("", { "c" }));
+	writeFile("/tmp/groups.rf", writeGroupedRFile(groups, 2000));
+
+	cclient::data::streams::MappedInputStream stream("/tmp/groups.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	REQUIRE(rfile.getLocalityGroups().size() == 2);
+	cclient::data::LocalityGroupMetaData *named = rfile.getLocalityGroups().front();
+	REQUIRE(named->getName() == "meta");
+	REQUIRE(named->hasColumnFamilies());
+	REQUIRE(named->getColumnFamilies().size() == 2);
+	REQUIRE(named->getColumnFamilies().at("a") == 2000);
+	REQUIRE(named->getColumnFamilies().at("b") == 2000);
+	REQUIRE_FALSE(rfile.getLocalityGroups().back()->hasColumnFamilies());
+
+	// a full scan reads every group
+	std::vector<std::string> entries = scanRFile(&rfile);
+	REQUIRE(entries.size() == 6000);
+	REQUIRE(std::is_sorted(entries.begin(), entries.end()));
+
+	entries = scanRFile(&rfile, NULL, { "b" }, true);
+	REQUIRE(entries.size() == 2000);
+	for (const std::string &entry : entries)
+		REQUIRE(entry.substr(8, 3) == "|b|");
+
+	entries = scanRFile(&rfile, NULL, { "a", "b" }, false);
+	REQUIRE(entries.size() == 2000);
+	for (const std::string &entry : entries)
+		REQUIRE(entry.substr(8, 3) == "|c|");
+
+	entries = scanRFile(&rfile, NULL, { "a" }, false);
+	REQUIRE(entries.size() == 4000);
+}
+
+TEST_CASE("Locality groups merge into key order", "[LocalityGroupMerger]") {
+	// each group holds every third row
+	std::vector<GroupFamilies> groups;
+	groups.push_back(GroupFamilies("first", { "x" }));
+	groups.push_back(GroupFamilies("second", { "y" }));
+	groups.push_back(GroupFamilies("", { "z" }));
+	writeFile("/tmp/merged.rf", writeGroupedRFile(groups, 3000, 3));
+
+	cclient::data::streams::MappedInputStream stream("/tmp/merged.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	std::vector<std::string> entries = scanRFile(&rfile);
+	REQUIRE(entries.size() == 9000);
+	char rw[13];
+	for (int i = 0; i < 9000; i++) {
+		sprintf(rw, "%08d", i);
+		REQUIRE(entries.at(i).substr(0, 8) == rw);
+		REQUIRE(entries.at(i).substr(8, 3) == (i % 3 == 0 ? "|x|" : i % 3 == 1 ? "|y|" : "|z|"));
+	}
+
+	// seeking positions each group at the start of the range
+	std::shared_ptr<cclient::data::Key> start = std::make_shared<cclient::data::Key>();
+	start->setRow("00004000", 8);
+	std::shared_ptr<cclient::data::Key> stop = std::make_shared<cclient::data::Key>();
+	stop->setRow("00004100", 8);
+	cclient::data::Range range(start, true, stop, false);
+	entries = scanRFile(&rfile, &range);
+	REQUIRE(entries.size() == 100);
+	REQUIRE(entries.front().substr(0, 8) == "00004000");
+	REQUIRE(entries.back().substr(0, 8) == "00004099");
+	REQUIRE(std::is_sorted(entries.begin(), entries.end()));
+}
+
+static std::vector<std::string> scanBatches(cclient::data::RFile *rfile, size_t batchSize,
+		cclient::data::Range *range = NULL) {
+	cclient::data::Range infinite;
+	cclient::data::streams::StreamSeekable seekable(NULL == range ? &infinite : range, std::vector<std::string>(),
+			false);
+	rfile->relocate(&seekable);
+	std::vector<std::string> entries;
+	cclient::data::KeyValueBatch batch;
+	while (rfile->nextBatch(&batch, batchSize) > 0) {
+		REQUIRE(batch.size() <= batchSize);
+		for (size_t i = 0; i < batch.size(); i++) {
+			cclient::data::Value value(batch.getValues().getString(i));
+			entries.push_back(describe(batch.getKey(i), &value));
+		}
+	}
+	return entries;
+}
+
+TEST_CASE("Batches hold the entries returned by next", "[KeyValueBatch]") {
+	std::shared_ptr<cclient::data::Key> start = std::make_shared<cclient::data::Key>();
+	start->setRow("00001234", 8);
+	std::shared_ptr<cclient::data::Key> stop = std::make_shared<cclient::data::Key>();
+	stop->setRow("00003210", 8);
+	cclient::data::Range range(start, true, stop, false);
+
+	SECTION("a single locality group") {
+		writeFile("/tmp/batches.rf", writeSortedRFile(5000));
+	}
+	SECTION("merged locality groups") {
+		std::vector<GroupFamilies> groups;
+		groups.push_back(GroupFamilies("first", { "x" }));
+		groups.push_back(GroupFamilies("", { "y" }));
+		writeFile("/tmp/batches.rf", writeGroupedRFile(groups, 2500, 2));
+	}
+
+	cclient::data::streams::MappedInputStream stream("/tmp/batches.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	std::vector<std::string> expected = scanRFile(&rfile);
+	REQUIRE(expected.size() == 5000);
+	REQUIRE(scanBatches(&rfile, 333) == expected);
+	REQUIRE(scanBatches(&rfile, 1) == expected);
+
+	expected = scanRFile(&rfile, &range);
+	REQUIRE(expected.size() == 1976);
+	REQUIRE(scanBatches(&rfile, 100, &range) == expected);
+}
+
+TEST_CASE("Parallel scans return the entries of a sequential scan", "[ParallelScan]") {
+	writeFile("/tmp/parallel.rf", writeSortedRFile(5000));
+	cclient::data::streams::MappedInputStream stream("/tmp/parallel.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	std::vector<std::string> expected = scanRFile(&rfile);
+	REQUIRE(expected.size() == 5000);
+
+	cclient::data::ParallelScan scan("/tmp/parallel.rf", 4, 3);
+	REQUIRE(scan.getPartitionCount() == 4);
+
+	std::vector<std::string> ordered;
+	std::vector<uint32_t> partitions;
+	REQUIRE(scan.scan([&](uint32_t partition, std::shared_ptr<cclient::data::Key> key,
+			std::shared_ptr<cclient::data::Value> value) {
+		ordered.push_back(describe(key, value.get()));
+		partitions.push_back(partition);
+	}, true) == 5000);
+	REQUIRE(ordered == expected);
+	REQUIRE(std::is_sorted(partitions.begin(), partitions.end()));
+	REQUIRE(partitions.back() == 3);
+
+	std::mutex lock;
+	std::vector<std::string> unordered;
+	REQUIRE(scan.scan([&](uint32_t partition, std::shared_ptr<cclient::data::Key> key,
+			std::shared_ptr<cclient::data::Value> value) {
+		std::lock_guard<std::mutex> guard(lock);
+		unordered.push_back(describe(key, value.get()));
+	}, false) == 5000);
+	std::sort(unordered.begin(), unordered.end());
+	REQUIRE(unordered == expected);
+
+	// a failing callback stops the readers blocked behind it
+	int calls = 0;
+	REQUIRE_THROWS(scan.scan([&](uint32_t partition, std::shared_ptr<cclient::data::Key> key,
+			std::shared_ptr<cclient::data::Value> value) {
+		if (++calls == 10)
+			throw std::runtime_error("stop");
+	}, true));
+	REQUIRE(calls == 10);
+}
+
+TEST_CASE("Read ahead returns blocks in request order", "[ReadAhead]") {
+	std::atomic<int> loads(0);
+	cclient::data::BlockReadAhead readAhead([&loads](uint32_t block) {
+		loads++;
+		return std::make_shared<cclient::data::DecompressedBlock>(block + 1, (char) block);
+	}, 2, 1024);
+
+	REQUIRE(readAhead.prefetch(1, 2));
+	REQUIRE(readAhead.prefetch(2, 3));
+	// the depth is exhausted
+	REQUIRE_FALSE(readAhead.prefetch(3, 4));
+
+	std::shared_ptr<cclient::data::DecompressedBlock> block = readAhead.take(1);
+	REQUIRE(block->size() == 2);
+	REQUIRE(block->at(0) == 1);
+	REQUIRE(readAhead.take(5) == nullptr);
+
+	// skipped blocks are discarded
+	REQUIRE(readAhead.prefetch(3, 4));
+	block = readAhead.take(3);
+	REQUIRE(block->size() == 4);
+	REQUIRE(readAhead.take(2) == nullptr);
+
+	// a single block may exceed the budget, but none may join it
+	REQUIRE(readAhead.prefetch(4, 2048));
+	REQUIRE_FALSE(readAhead.prefetch(5, 1));
+	readAhead.cancel();
+	REQUIRE(readAhead.take(4) == nullptr);
+	REQUIRE(loads <= 4);
+}
+
+TEST_CASE("Key value batch stores fields in columns", "[KeyValueBatch]") {
+	cclient::data::KeyValueBatch batch;
+	char rw[9];
+	for (int i = 0; i < 3; i++) {
+		cclient::data::Key k;
+		sprintf(rw, "row%05d", i);
+		k.setRow(rw, 8);
+		k.setColFamily("cf", 2);
+		k.setColQualifier("cq", 2);
+		k.setTimeStamp(i);
+		k.setDeleted(i == 1);
+		cclient::data::Value v("value" + std::to_string(i));
+		batch.append(&k, &v);
+	}
+
+	REQUIRE(batch.size() == 3);
+	REQUIRE(batch.getRows().getString(2) == "row00002");
+	REQUIRE(batch.getRows().getBytes().size() == 24);
+	REQUIRE(batch.getColumnFamilies().getOffsets().back() == 6);
+	REQUIRE(batch.getValues().getString(1) == "value1");
+	REQUIRE(batch.getTimestamps().at(2) == 2);
+	REQUIRE(batch.getDeleted().at(1) == 1);
+
+	std::shared_ptr<cclient::data::Key> key = batch.getKey(1);
+	REQUIRE(key->getRowStr() == "row00001");
+	REQUIRE(key->isDeleted());
+
+	batch.clear();
+	REQUIRE(batch.empty());
+	REQUIRE(batch.getRows().getOffsets().size() == 1);
+}
+
+TEST_CASE("Relative keys decode into a reused key", "[RelativeKey]") {
+	cclient::data::streams::ByteOutputStream outStream(64 * 1024);
+	std::string longRow(200, 'r');
+	std::vector<std::shared_ptr<cclient::data::Key>> keys;
+	for (int i = 0; i < 4; i++) {
+		std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+		std::string row = longRow + std::to_string(i / 2);
+		k->setRow(row.c_str(), row.size());
+		k->setColFamily("cf", 2);
+		k->setColQualifier("cq" + std::to_string(i));
+		k->setColVisibility(i == 3 ? "" : "vis");
+		k->setTimeStamp(100 + i * 300);
+		k->setDeleted(i == 2);
+		keys.push_back(k);
+	}
+	std::shared_ptr<cclient::data::Key> prev = NULL;
+	for (auto k : keys) {
+		cclient::data::RelativeKey writer(prev, k);
+		writer.write(&outStream);
+		prev = k;
+	}
+
+	cclient::data::streams::ByteInputStream inStream(outStream.getByteArray(), outStream.getPos());
+	cclient::data::RelativeKey reader;
+	std::shared_ptr<cclient::data::Key> first;
+	for (size_t i = 0; i < keys.size(); i++) {
+		reader.read(&inStream);
+		std::pair<char*, size_t> row = reader.getRow();
+		REQUIRE(std::string(row.first, row.second) == keys.at(i)->getRowStr());
+		REQUIRE(reader.getTimeStamp() == keys.at(i)->getTimeStamp());
+		REQUIRE(reader.isDeleted() == keys.at(i)->isDeleted());
+		std::shared_ptr<cclient::data::Key> key = reader.getKey();
+		REQUIRE(key->compare(*keys.at(i)) == 0);
+		REQUIRE(key->getColVisibilityStr() == keys.at(i)->getColVisibilityStr());
+		if (i == 0) {
+			first = reader.copyKey();
+		} else {
+			// the key is reused, unlike its copy
+			REQUIRE(key.get() == reader.getKey().get());
+		}
+	}
+	REQUIRE(first->compare(*keys.at(0)) == 0);
+}
+
+TEST_CASE("Byte comparisons match a bytewise comparison", "[ByteCompare]") {
+	INFO("implementation " << cclient::data::ByteCompare::getImplementation());
+	srand(7);
+	for (int iteration = 0; iteration < 2000; iteration++) {
+		size_t len = rand() % 100;
+		std::string a(len, 0);
+		for (size_t i = 0; i < len; i++)
+			a[i] = (char) (rand() % 256);
+		std::string b = a;
+		size_t expected = len;
+		if (len > 0 && rand() % 4 != 0) {
+			expected = rand() % len;
+			b[expected] = (char) (b[expected] + 1 + rand() % 255);
+		}
+		REQUIRE(cclient::data::ByteCompare::mismatch(a.data(), b.data(), len) == expected);
+		int cmp = cclient::data::ByteCompare::compare(a.data(), a.size(), b.data(), b.size());
+		int reference = a.compare(b);
+		REQUIRE((cmp < 0) == (reference < 0));
+		REQUIRE((cmp > 0) == (reference > 0));
+	}
+	// bytes are unsigned, and prefixes sort first
+	REQUIRE(cclient::data::ByteCompare::compare("\xff", 1, "\x01", 1) > 0);
+	REQUIRE(cclient::data::ByteCompare::compare("ab", 2, "abc", 3) < 0);
+	REQUIRE(cclient::data::ByteCompare::equals("abc", 3, "abc", 3));
+}
+
+TEST_CASE("ZLib compressors reuse their streams across blocks", "[ZLib]") {
+	cclient::data::compression::ZLibCompressor compressor;
+	for (int block = 0; block < 3; block++) {
+		std::string raw;
+		for (int i = 0; i < 1000 * (block + 1); i++)
+			raw += "row" + std::to_string(i % (17 + block));
+
+		cclient::data::streams::ByteOutputStream compressed(16);
+		compressor.setInput(raw.data(), 0, raw.size());
+		compressor.compress(&compressed);
+		REQUIRE(compressor.getCompressedSize() == compressed.getPos());
+		REQUIRE(compressed.getPos() < raw.size());
+
+		// inflate into a caller's buffer
+		cclient::data::compression::ZLibCompressor inflater;
+		std::vector<char> out(raw.size());
+		inflater.setInput(compressed.getByteArray(), 0, compressed.getPos());
+		REQUIRE(inflater.decompress(out.data(), out.size()) == raw.size());
+		REQUIRE(std::string(out.data(), out.size()) == raw);
+
+		// and through an output stream
+		cclient::data::streams::ByteOutputStream stream(16);
+		inflater.setInput(compressed.getByteArray(), 0, compressed.getPos());
+		inflater.decompress(&stream);
+		REQUIRE(std::string(stream.getByteArray(), stream.getPos()) == raw);
+
+		// a buffer that is too small is rejected
+		inflater.setInput(compressed.getByteArray(), 0, compressed.getPos());
+		REQUIRE_THROWS(inflater.decompress(out.data(), out.size() / 2));
+	}
+}
+
+#ifdef HAVE_LIBDEFLATE
+TEST_CASE("Whole blocks deflated by zlib inflate with libdeflate", "[ZLib]") {
+	std::string raw;
+	for (int i = 0; raw.size() < 300 * 1024; i++)
+		raw += "row" + std::to_string(i) + "cf" + std::to_string(i % 7);
+
+	// stored, fastest and best compression produce different block types
+	for (int level : { Z_NO_COMPRESSION, Z_BEST_SPEED, Z_BEST_COMPRESSION }) {
+		INFO("level " << level);
+		std::vector<char> compressed(compressBound(raw.size()));
+		uLongf compressedSize = compressed.size();
+		REQUIRE(compress2((Bytef*) compressed.data(), &compressedSize, (const Bytef*) raw.data(), raw.size(), level) == Z_OK);
+
+		cclient::data::compression::ZLibCompressor inflater;
+		std::vector<char> out(raw.size());
+		inflater.setInput(compressed.data(), 0, compressedSize);
+		REQUIRE(inflater.decompress(out.data(), out.size()) == raw.size());
+		REQUIRE(std::string(out.data(), out.size()) == raw);
+
+		// one byte short of the raw size
+		inflater.setInput(compressed.data(), 0, compressedSize);
+		REQUIRE_THROWS_WITH(inflater.decompress(out.data(), out.size() - 1),
+				"Decompressed data exceeds its expected size");
+
+		// and the inflater is still usable afterwards
+		std::fill(out.begin(), out.end(), 0);
+		inflater.setInput(compressed.data(), 0, compressedSize);
+		REQUIRE(inflater.decompress(out.data(), out.size()) == raw.size());
+		REQUIRE(std::string(out.data(), out.size()) == raw);
+	}
+}
+#endif
+
+TEST_CASE("ZLib compressors reject truncated and corrupt blocks", "[ZLib]") {
+	std::string raw;
+	for (int i = 0; raw.size() < 64 * 1024; i++)
+		raw += "row" + std::to_string(i) + "cf" + std::to_string(i % 7);
+	cclient::data::compression::ZLibCompressor compressor;
+	cclient::data::streams::ByteOutputStream compressed(16);
+	compressor.setInput(raw.data(), 0, raw.size());
+	compressor.compress(&compressed);
+
+	cclient::data::compression::ZLibCompressor inflater;
+	std::vector<char> out(raw.size() + 1);
+	// the block ends early
+	size_t truncated = compressed.getPos() / 2;
+	inflater.setInput(compressed.getByteArray(), 0, truncated);
+	REQUIRE_THROWS_WITH(inflater.decompress(out.data(), raw.size()), "Failure during decompression");
+	cclient::data::streams::ByteOutputStream stream(16);
+	inflater.setInput(compressed.getByteArray(), 0, truncated);
+	REQUIRE_THROWS(inflater.decompress(&stream));
+
+	// the block holds fewer bytes than expected
+	inflater.setInput(compressed.getByteArray(), 0, compressed.getPos());
+	REQUIRE_THROWS_WITH(inflater.decompress(out.data(), out.size()),
+			"Decompressed data is shorter than its expected size");
+
+	// corrupt input is rejected rather than partially inflated
+	std::vector<char> garbage(64, 'x');
+	inflater.setInput(garbage.data(), 0, garbage.size());
+	REQUIRE_THROWS_WITH(inflater.decompress(out.data(), out.size()), "Failure during decompression");
+	inflater.setInput(garbage.data(), 0, garbage.size());
+	REQUIRE_THROWS(inflater.decompress(&stream));
+
+	// and the inflater is still usable afterwards
+	inflater.setInput(compressed.getByteArray(), 0, compressed.getPos());
+	REQUIRE(inflater.decompress(out.data(), raw.size()) == raw.size());
+	REQUIRE(std::string(out.data(), raw.size()) == raw);
+}
+
+#ifdef HAVE_ZSTD
+TEST_CASE("Zstd compressors reject truncated and short blocks", "[Zstd]") {
+	std::string raw;
+	for (int i = 0; raw.size() < 64 * 1024; i++)
+		raw += "row" + std::to_string(i) + "cf" + std::to_string(i % 7);
+	cclient::data::compression::ZstdCompressor compressor;
+	cclient::data::streams::ByteOutputStream compressed(16);
+	compressor.setInput(raw.data(), 0, raw.size());
+	compressor.compress(&compressed);
+
+	cclient::data::compression::ZstdCompressor inflater;
+	std::vector<char> out(raw.size() + 1);
+	// the frame ends early
+	size_t truncated = compressed.getPos() / 2;
+	inflater.setInput(compressed.getByteArray(), 0, truncated);
+	REQUIRE_THROWS_WITH(inflater.decompress(out.data(), raw.size()), "Compressed data is truncated");
+	cclient::data::streams::ByteOutputStream stream(16);
+	inflater.setInput(compressed.getByteArray(), 0, truncated);
+	REQUIRE_THROWS(inflater.decompress(&stream));
+
+	// the block holds fewer bytes than expected
+	inflater.setInput(compressed.getByteArray(), 0, compressed.getPos());
+	REQUIRE_THROWS_WITH(inflater.decompress(out.data(), out.size()),
+			"Decompressed data is shorter than its expected size");
+
+	// bytes after the last frame are not a frame
+	std::string trailing(compressed.getByteArray(), compressed.getPos());
+	trailing.append(16, 'x');
+	inflater.setInput(trailing.data(), 0, trailing.size());
+	REQUIRE_THROWS(inflater.decompress(out.data(), raw.size()));
+
+	inflater.setInput(compressed.getByteArray(), 0, compressed.getPos());
+	REQUIRE(inflater.decompress(out.data(), raw.size()) == raw.size());
+	REQUIRE(std::string(out.data(), raw.size()) == raw);
+}
+#endif
+
+TEST_CASE("Compression algorithms round trip blocks", "[Compression]") {
+	std::vector<std::string> algorithms = { "gz", "none" };
+#ifdef HAVE_SNAPPY
+	algorithms.push_back("snappy");
+#endif
+#ifdef HAVE_LZ4
+	algorithms.push_back("lz4");
+#endif
+#ifdef HAVE_ZSTD
+	algorithms.push_back("zstd");
+#endif
+	// larger than a single chunk of the framed codecs
+	std::string raw;
+	for (int i = 0; raw.size() < 600 * 1024; i++)
+		raw += "row" + std::to_string(i) + "cf" + std::to_string(i % 13);
+
+	for (const std::string &name : algorithms) {
+		INFO("algorithm " << name);
+		cclient::data::compression::CompressionAlgorithm algorithm(name);
+		std::unique_ptr<cclient::data::compression::Compressor> compressor(algorithm.create());
+		REQUIRE(compressor->getAlgorithm().getName() == name);
+
+		cclient::data::streams::ByteOutputStream compressed(16);
+		compressor->setInput(raw.data(), 0, raw.size());
+		compressor->compress(&compressed);
+		REQUIRE(compressor->getCompressedSize() == compressed.getPos());
+
+		std::unique_ptr<cclient::data::compression::Compressor> decompressor(compressor->newInstance());
+		std::vector<char> out(raw.size());
+		decompressor->setInput(compressed.getByteArray(), 0, compressed.getPos());
+		REQUIRE(decompressor->decompress(out.data(), out.size()) == raw.size());
+		REQUIRE(std::string(out.data(), out.size()) == raw);
+
+		cclient::data::streams::ByteOutputStream stream(16);
+		decompressor->setInput(compressed.getByteArray(), 0, compressed.getPos());
+		decompressor->decompress(&stream);
+		REQUIRE(std::string(stream.getByteArray(), stream.getPos()) == raw);
+
+		decompressor->setInput(compressed.getByteArray(), 0, compressed.getPos());
+		REQUIRE_THROWS(decompressor->decompress(out.data(), out.size() - 1));
+	}
+
+	cclient::data::compression::CompressionAlgorithm unknown("lzo");
+	REQUIRE_THROWS(unknown.create());
+}
+
+static std::string writeRFile(uint16_t compressionThreads, uint32_t indexBlockSize = 128 * 1024) {
+	cclient::data::compression::ZLibCompressor compressor(1024);
+	cclient::data::BlockCompressedFile bcFile(&compressor);
+	cclient::data::streams::BigEndianByteStream outStream(16 * 1024 * 1024);
+	cclient::data::RFile rfile(&outStream, &bcFile);
+	rfile.setCompressionThreads(compressionThreads, 2);
+	rfile.setMaxIndexBlockSize(indexBlockSize);
+	rfile.addLocalityGroup();
+	char rw[13];
+	for (int i = 0; i < 5000; i++) {
+		std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+		sprintf(rw, "%08d", i);
+		k->setRow((const char*) rw, 8);
+		k->setColFamily((const char*) rw, 3);
+		k->setColQualifier((const char*) rw, 8);
+		std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared<cclient::data::KeyValue>();
+		kv->setKey(k, true);
+		kv->setValue(std::make_shared<cclient::data::Value>());
+		rfile.append(kv);
+	}
+	rfile.close();
+	return std::string(outStream.getByteArray(), outStream.getPos());
+}
+
+TEST_CASE("Pipelined compression writes the same file", "[CompressionPipeline]") {
+	std::string expected = writeRFile(0);
+	REQUIRE(expected.size() > 0);
+	REQUIRE(writeRFile(1) == expected);
+	REQUIRE(writeRFile(4) == expected);
+}
+
+TEST_CASE("Index writer spills levels into index blocks", "[IndexWriter]") {
+	std::vector<std::string> blocks;
+	int syncs = 0;
+	cclient::data::IndexWriter writer([&blocks](const char *data, size_t size, cclient::data::BlockRegion *region) {
+		region->setOffset(blocks.size());
+		region->setCompressedSize(size);
+		region->setRawSize(size);
+		blocks.push_back(std::string(data, size));
+	}, [&syncs]() {
+		syncs++;
+	}, 256);
+
+	std::vector<cclient::data::BlockRegion> regions(50);
+	char rw[13];
+	for (int i = 0; i < 50; i++) {
+		std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+		sprintf(rw, "%08d", i);
+		k->setRow((const char*) rw, 8);
+		writer.add(k, 10, &regions.at(i));
+	}
+	REQUIRE(writer.getSize() == 50);
+
+	cclient::data::streams::BigEndianByteStream outStream(1024);
+	cclient::data::streams::DataOutputStream out(&outStream);
+	writer.write(&out);
+	REQUIRE(writer.getLevels() > 2);
+	REQUIRE(blocks.size() > 1);
+	REQUIRE(syncs > 0);
+
+	cclient::data::streams::EndianInputStream rootStream(outStream.getByteArray(), outStream.getPos());
+	REQUIRE(rootStream.readInt() == 50);
+	cclient::data::IndexBlock root(7);
+	root.read(&rootStream);
+	REQUIRE(root.getLevel() == (int) writer.getLevels() - 1);
+	REQUIRE_FALSE(root.hasNextKey());
+
+	// leaves hold every data block, in order
+	size_t leafEntries = 0;
+	for (std::string &block : blocks) {
+		cclient::data::streams::EndianInputStream blockStream((char*) block.data(), block.size());
+		cclient::data::IndexBlock indexBlock(7);
+		indexBlock.read(&blockStream);
+		if (indexBlock.getLevel() == 0) {
+			REQUIRE(indexBlock.getOffset() == (int) leafEntries);
+			leafEntries += indexBlock.getIndex()->size();
+			REQUIRE(indexBlock.hasNextKey() == (leafEntries < 50));
+		}
+	}
+	REQUIRE(leafEntries == 50);
+	REQUIRE_THROWS(writer.add(std::make_shared<cclient::data::Key>(), 1, &regions.front()));
+}
+
+TEST_CASE("Multi-level indexes are written with pipelined compression", "[IndexWriter]") {
+	std::string expected = writeRFile(0, 256);
+	REQUIRE(expected.size() > writeRFile(0).size());
+	REQUIRE(writeRFile(4, 256) == expected);
+}
+
+TEST_CASE("Multi-level indexes are read back and seeked", "[IndexWriter]") {
+	writeFile("/tmp/multilevel.rf", writeRFile(0, 256));
+	cclient::data::streams::MappedInputStream stream("/tmp/multilevel.rf");
+	cclient::data::RFile rfile(&stream, stream.getLength());
+	REQUIRE(rfile.getLocalityGroups().size() == 1);
+	std::shared_ptr<cclient::data::IndexManager> manager = rfile.getLocalityGroups().front()->getIndexManager();
+	std::shared_ptr<cclient::data::IndexBlock> root = manager->getRootIndexBlock();
+	REQUIRE(root->getLevel() > 0);
+	REQUIRE(root->getIndex()->size() > 1);
+
+	// walk the lowest level across its leaves
+	std::shared_ptr<cclient::data::Key> first = std::make_shared<cclient::data::Key>();
+	first->setRow("", 0);
+	std::shared_ptr<cclient::data::SerializedIndex> index = manager->lookup(first);
+	REQUIRE(index->getPreviousIndex() == 0);
+	REQUIRE_FALSE(index->hasPrevious());
+	std::vector<std::shared_ptr<cclient::data::Key>> blockKeys;
+	blockKeys.push_back(index->get()->getKey());
+	while (index->hasNext()) {
+		blockKeys.push_back(index->next()->getKey());
+		REQUIRE(index->getPreviousIndex() == blockKeys.size() - 1);
+		REQUIRE(blockKeys.at(blockKeys.size() - 2)->compare(*blockKeys.back()) < 0);
+	}
+	REQUIRE(blockKeys.size() > root->getIndex()->size());
+	REQUIRE(blockKeys.back()->getRowStr() == "00004999");
+
+	char rw[13];
+	for (int i = 0; i < 5000; i += 211) {
+		INFO("row " << i);
+		sprintf(rw, "%08d", i);
+		std::shared_ptr<cclient::data::Key> key = std::make_shared<cclient::data::Key>();
+		key->setRow((const char*) rw, 8);
+
+		// the entry found is the first block which may hold the key
+		index = manager->lookup(key);
+		uint32_t position = index->getPreviousIndex();
+		REQUIRE(position < blockKeys.size());
+		REQUIRE(index->get()->getKey()->compare(*blockKeys.at(position)) == 0);
+		REQUIRE(blockKeys.at(position)->compare(*key) >= 0);
+		if (position > 0) {
+			REQUIRE(index->hasPrevious());
+			REQUIRE(index->getPrevious()->getKey()->compare(*blockKeys.at(position - 1)) == 0);
+			REQUIRE(blockKeys.at(position - 1)->compare(*key) < 0);
+		}
+
+		cclient::data::Range range(key, true, nullptr, false);
+		std::vector<std::string> entries = scanRFile(&rfile, &range);
+		REQUIRE(entries.size() == (size_t) (5000 - i));
+		REQUIRE(entries.front().substr(0, 9) == std::string(rw) + "|");
+	}
+}
+
+static std::string readFile(const std::string &name) {
+	std::ifstream in(name, std::ifstream::binary);
+	return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static std::vector<std::string> buildRFiles(const std::string &prefix, uint64_t memoryBudget, uint64_t targetFileSize,
+		uint32_t *runs) {
+	cclient::data::compression::ZLibCompressor compressor(1024);
+	cclient::data::BulkRFileBuilder builder(prefix, "/tmp", &compressor, memoryBudget, 2);
+	builder.setTargetFileSize(targetFileSize);
+	builder.setMergeFanIn(3);
+	std::vector<int> order;
+	for (int i = 0; i < 20000; i++)
+		order.push_back(i);
+	std::random_shuffle(order.begin(), order.end());
+	char rw[13];
+	for (int i : order) {
+		std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+		sprintf(rw, "%08d", i / 2);
+		k->setRow((const char*) rw, 8);
+		sprintf(rw, "%08d", i);
+		k->setColQualifier((const char*) rw, 8);
+		std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared<cclient::data::KeyValue>();
+		kv->setKey(k, true);
+		kv->setValue((uint8_t*) rw, 8);
+		builder.append(kv);
+	}
+	std::vector<std::string> files = builder.close();
+	*runs = builder.getRunCount();
+	return files;
+}
+
+static std::vector<std::vector<std::string>> scanRFiles(const std::vector<std::string> &names) {
+	std::vector<std::vector<std::string>> entries;
+	for (const std::string &name : names) {
+		cclient::data::streams::MappedInputStream stream(name);
+		cclient::data::RFile rfile(&stream, stream.getLength());
+		entries.push_back(scanRFile(&rfile));
+	}
+	return entries;
+}
+
+/**
+ * Joins the entries of consecutive files, requiring that no row spans
+ * two files.
+ */
+static std::vector<std::string> joinRows(const std::vector<std::vector<std::string>> &files) {
+	std::vector<std::string> entries;
+	for (const std::vector<std::string> &file : files) {
+		REQUIRE_FALSE(file.empty());
+		if (!entries.empty()) {
+			std::string lastRow = entries.back().substr(0, entries.back().find('|'));
+			REQUIRE(lastRow < file.front().substr(0, file.front().find('|')));
+		}
+		entries.insert(entries.end(), file.begin(), file.end());
+	}
+	return entries;
+}
+
+TEST_CASE("Bulk builder sorts unsorted entries into RFiles", "[BulkRFileBuilder]") {
+	uint32_t runs = 0;
+	std::vector<std::string> inMemory = buildRFiles("/tmp/bulk-memory", 256 * 1024 * 1024, 1024 * 1024 * 1024, &runs);
+	REQUIRE(inMemory.size() == 1);
+	REQUIRE(runs == 0);
+
+	std::vector<std::string> spilled = buildRFiles("/tmp/bulk-spilled", 256 * 1024, 1024 * 1024 * 1024, &runs);
+	REQUIRE(spilled.size() == 1);
+	// more runs than the merge fan in
+	REQUIRE(runs > 3);
+	REQUIRE(readFile(spilled.front()) == readFile(inMemory.front()));
+
+	std::vector<std::string> rolled = buildRFiles("/tmp/bulk-rolled", 256 * 1024, 8 * 1024, &runs);
+	REQUIRE(rolled.size() > 2);
+	std::vector<std::vector<std::string>> rolledEntries = scanRFiles(rolled);
+	REQUIRE(joinRows(rolledEntries) == scanRFiles(inMemory).front());
+	REQUIRE(joinRows(rolledEntries).size() == 20000);
+}
+
+TEST_CASE("Bulk builder keeps equal keys in the order they were added", "[BulkRFileBuilder]") {
+	// small blocks, so that the size of each file grows often
+	cclient::data::compression::ZLibCompressor compressor(128);
+	cclient::data::BulkRFileBuilder builder("/tmp/bulk-equal", "/tmp", &compressor, 64 * 1024, 2);
+	builder.setTargetFileSize(4 * 1024);
+	builder.setMergeFanIn(3);
+	std::vector<std::string> expected;
+	char rw[13];
+	for (int i = 0; i < 5000; i++) {
+		std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+		sprintf(rw, "%05d", (i * 7919) % 50);
+		k->setRow((const char*) rw, 5);
+		k->setColFamily("cf", 2);
+		sprintf(rw, "%03d", (i * 31) % 10);
+		k->setColQualifier((const char*) rw, 3);
+		sprintf(rw, "%08d", i);
+		std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared<cclient::data::KeyValue>();
+		kv->setKey(k, true);
+		kv->setValue((uint8_t*) rw, 8);
+		expected.push_back(describe(k, kv->getValue().get()));
+		builder.append(kv);
+	}
+	std::vector<std::string> files = builder.close();
+	// enough runs for intermediate runs to be merged in a second pass
+	REQUIRE(builder.getRunCount() > 9);
+	REQUIRE(files.size() > 2);
+
+	// values ascend with the order in which equal keys were added
+	std::sort(expected.begin(), expected.end());
+	REQUIRE(joinRows(scanRFiles(files)) == expected);
+}
+
+TEST_CASE("Local RFiles are only kept once closed", "[LocalRFile]") {
+	char rw[13];
+	for (bool close : { true, false }) {
+		INFO("closed " << close);
+		cclient::data::compression::ZLibCompressor compressor(128);
+		{
+			// a buffer smaller than the file, so that blocks reach the file
+			cclient::data::LocalRFile rfile("/tmp/local.rf", &compressor, 1024);
+			for (int i = 0; i < 2000; i++) {
+				std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+				sprintf(rw, "%08d", i);
+				k->setRow((const char*) rw, 8);
+				std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared<cclient::data::KeyValue>();
+				kv->setKey(k, true);
+				kv->setValue((uint8_t*) rw, 8);
+				rfile.append(kv);
+			}
+			REQUIRE(readFile("/tmp/local.rf").size() > 0);
+			if (close) {
+				rfile.close();
+				REQUIRE(rfile.getSize() == readFile("/tmp/local.rf").size());
+			}
+		}
+		std::ifstream in("/tmp/local.rf");
+		REQUIRE(in.good() == close);
+		if (close)
+			REQUIRE(scanRFiles({ "/tmp/local.rf" }).front().size() == 2000);
+	}
+}
+
+TEST_CASE("Partitioned writer writes a file set per tablet", "[TabletPartitionedWriter]") {
+	std::vector<std::string> splits = { "00006000", "", "00002000" };
+	cclient::data::compression::ZLibCompressor compressor(1024);
+	cclient::data::TabletPartitionedWriter writer("/tmp", splits, &compressor, 1024 * 1024, 3);
+	writer.setTargetFileSize(256 * 1024);
+	REQUIRE(writer.getTabletCount() == 3);
+	REQUIRE(writer.getTablet("00002000", 8) == 0);
+	REQUIRE(writer.getTablet("000020000", 9) == 1);
+	REQUIRE(writer.getTablet("9", 1) == 2);
+
+	std::vector<int> order;
+	for (int i = 0; i < 10000; i++)
+		order.push_back(i);
+	std::random_shuffle(order.begin(), order.end());
+	char rw[13];
+	for (int i : order) {
+		std::shared_ptr<cclient::data::Key> k = std::make_shared<cclient::data::Key>();
+		sprintf(rw, "%08d", i);
+		k->setRow((const char*) rw, 8);
+		std::shared_ptr<cclient::data::KeyValue> kv = std::make_shared<cclient::data::KeyValue>();
+		kv->setKey(k, true);
+		kv->setValue(std::make_shared<cclient::data::Value>());
+		writer.append(kv);
+	}
+
+	std::vector<cclient::data::BulkFile> files = writer.close();
+	std::vector<uint64_t> entries(3);
+	for (const cclient::data::BulkFile &file : files) {
+		entries.at(file.tablet) += file.entries;
+		REQUIRE(file.size == readFile(file.file).size());
+		REQUIRE(file.prevEndRow == (file.tablet == 0 ? "" : file.tablet == 1 ? "00002000" : "00006000"));
+		REQUIRE(file.endRow == (file.tablet == 0 ? "00002000" : file.tablet == 1 ? "00006000" : ""));
+	}
+	REQUIRE(files.size() > 3);
+	REQUIRE(entries.at(0) == 2001);
+	REQUIRE(entries.at(1) == 4000);
+	REQUIRE(entries.at(2) == 3999);
+}